@@ -180,6 +180,15 @@ enum DaoCtypeWrapOptions
 	DAO_CTYPE_UNITHREAD  = 2
 };
 
+/*
+// Leaf functions: a function prototype in DaoFunctionEntry can be prefixed
+// with "@leaf", for example, "@leaf size( invar self: list<@T> ) => int".
+//
+// A leaf function is called directly on the caller's registers without
+// pushing a stack frame. It must not modify its primitive parameters,
+// call back into the VM (code sections, DaoProcess_Call() etc.), suspend
+// the process, or access the top stack frame.
+*/
 
 
 /*
@@ -568,6 +577,15 @@ DAO_DLL DaoVmSpace* DaoInit( const char *command );
 */
 DAO_DLL void DaoQuit();
 
+/*
+// DaoSetAffinity() sets the CPUs on which the tasklet threads and the
+// GC thread will be placed (in round-robin order), as a list of CPU
+// numbers and ranges such as "0-3,8". It should be called before any
+// tasklet is started, and is equivalent to the "--affinity" option.
+// Return the number of CPUs in the list, or -1 for an invalid list.
+*/
+DAO_DLL int DaoSetAffinity( const char *cpus );
+
 
 
 /*
@@ -1185,6 +1203,7 @@ DAO_DLL int DaoVmSpace_AddVirtualModules( DaoVmSpace *self, DaoVirtualModule mod
 DAO_DLL void DaoVmSpace_AddVirtualModule( DaoVmSpace *self, DaoVirtualModule *module );
 DAO_DLL void DaoVmSpace_SetPath( DaoVmSpace *self, const char *path );
 DAO_DLL void DaoVmSpace_AddPath( DaoVmSpace *self, const char *path );
+DAO_DLL void DaoVmSpace_SetCacheDir( DaoVmSpace *self, const char *path );
 DAO_DLL void DaoVmSpace_DelPath( DaoVmSpace *self, const char *path );
 DAO_DLL const char* DaoVmSpace_CurrentWorkingPath( DaoVmSpace *self );
 DAO_DLL const char* DaoVmSpace_CurrentLoadingPath( DaoVmSpace *self );
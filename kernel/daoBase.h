@@ -82,6 +82,8 @@ struct DaoConfig
 	short optimize;  /* enable optimization */
 	short iscgi;     /* is CGI script */
 	short tabspace;  /* number of spaces counted for a tab */
+	short mailbox;   /* number of actor calls run in a row by a thread */
+	short tasklog;   /* interval in seconds for printing tasklet states */
 };
 
 extern DaoConfig daoConfig;
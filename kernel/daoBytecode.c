@@ -132,6 +132,7 @@ DaoByteCoder* DaoByteCoder_New( DaoVmSpace *vms )
 	self->caches = DList_New(0);
 	self->stack = DList_New(0);
 	self->lines = DList_New(0);
+	self->loads = DList_New(0);
 	self->ivalues = DList_New(0);
 	self->iblocks = DList_New(0);
 	self->indices = DList_New(0);
@@ -184,6 +185,19 @@ void DaoByteCoder_Reset( DaoByteCoder *self )
 	DMap_Reset( self->valueDataBlocks );
 	DMap_Reset( self->valueObjectBlocks );
 }
+static void DaoByteBlock_CollectLoads( DaoByteBlock *self, DList *modules )
+{
+	DaoByteBlock *it;
+	if( self->type == DAO_ASM_LOAD && self->value && self->value->type == DAO_NAMESPACE ){
+		DList_Append( modules, self->value );
+	}
+	for(it=self->first; it; it=it->next) DaoByteBlock_CollectLoads( it, modules );
+}
+/* Collect the modules loaded by the encoded module: */
+void DaoByteCoder_CollectLoads( DaoByteCoder *self, DList *modules )
+{
+	if( self->top ) DaoByteBlock_CollectLoads( self->top, modules );
+}
 void DaoByteCoder_Delete( DaoByteCoder *self )
 {
 	int i, n;
@@ -195,6 +209,7 @@ void DaoByteCoder_Delete( DaoByteCoder *self )
 	DList_Delete( self->caches );
 	DList_Delete( self->stack );
 	DList_Delete( self->lines );
+	DList_Delete( self->loads );
 	DList_Delete( self->ivalues );
 	DList_Delete( self->iblocks );
 	DList_Delete( self->indices );
@@ -2651,6 +2666,20 @@ static void DaoByteCoder_DecodeRoutineTypes( DaoByteCoder *self, DaoByteBlock *b
 	DList_Erase( self->indices, offset1, -1 );
 	DList_Erase( self->iblocks, offset2, -1 );
 }
+/*
+// The field names and the names of the named values in the routine constants
+// are interned, so that they share the buffers of the interned names as those
+// added by the parser (see DaoVmSpace_Intern()):
+*/
+static void DaoByteCoder_InternConstant( DaoByteCoder *self, DaoRoutine *routine, int index )
+{
+	DList *consts = routine->routConsts->value;
+	DString *name;
+
+	if( index >= consts->size || consts->items.pValue[index]->type != DAO_STRING ) return;
+	name = consts->items.pValue[index]->xString.value;
+	DString_Assign( name, DaoVmSpace_Intern( self->vmspace, name ) );
+}
 static void DaoByteCoder_DecodeRoutineCode( DaoByteCoder *self, DaoByteBlock *block )
 {
 	DaoByteBlock *pb = block->first;
@@ -2660,7 +2689,7 @@ static void DaoByteCoder_DecodeRoutineCode( DaoByteCoder *self, DaoByteBlock *bl
 	int defline = DaoByteCoder_DecodeUInt16( block->end );
 	int offset1 = self->lines->size;
 	int offset2 = self->indices->size;
-	int i, k, m, useGlobal = 0;
+	int i, k, m, useGlobal = 0, loads = 0;
 
 	if( block->parent == NULL || block->parent->type != DAO_ASM_ROUTINE ){
 		DaoByteCoder_Error( self, block, "Invalid context for the block!" );
@@ -2725,6 +2754,20 @@ static void DaoByteCoder_DecodeRoutineCode( DaoByteCoder *self, DaoByteBlock *bl
 			lookupTable = routine->nameSpace->lookupTable;
 			useGlobal = 1;
 			break;
+		case DVM_GETF :
+		case DVM_SETF :
+			DaoByteCoder_InternConstant( self, routine, vmc.b );
+			break;
+		case DVM_NAMEVA :
+			DaoByteCoder_InternConstant( self, routine, vmc.a );
+			break;
+		case DVM_MAIN :
+			if( loads >= self->loads->size ){
+				DaoByteCoder_Error( self, block, "Invalid module initialization!" );
+				break;
+			}
+			vmc.a = self->loads->items.pInt[ loads++ ];
+			break;
 		}
 		if( lookupTable != NULL ){
 			DaoByteBlock *pb = DaoByteCoder_LookupStringBlock( self, block, vmc.b );
@@ -2927,6 +2970,10 @@ static void DaoByteCoder_LoadModule( DaoByteCoder *self, DaoByteBlock *block )
 
 	GC_Assign( & block->value, ns );
 
+	/* The module for DVM_MAIN, see DaoParser_ParseLoadStatement(): */
+	DList_Append( self->loads, IntToPointer( self->nspace->constants->size ) );
+	DList_Append( self->nspace->constants, DaoConstant_New( (DaoValue*) ns, DAO_GLOBAL_CONSTANT ) );
+
 	if( mod == NULL ){
 		if( DaoNamespace_AddParent( self->nspace, ns ) == 0 ){
 			DaoByteCoder_Error( self, block, "Cyclic loading!" );
@@ -3109,6 +3156,7 @@ int DaoByteCoder_Build( DaoByteCoder *self, DaoNamespace *nspace )
 	self->iblocks->size = 0;
 	self->indices->size = 0;
 	self->routines->size = 0;
+	self->loads->size = 0;
 	self->nspace = nspace;
 	DaoByteCoder_DecodeBlock( self, self->top );
 	for(i=0; i<self->routines->size && self->error == 0; i++){
@@ -424,6 +424,7 @@ struct DaoByteCoder
 	DList_(DaoValue*)      *ivalues;
 	DList_(daoint)         *indices;
 	DList_(daoint)         *lines;
+	DList_(daoint)         *loads;  /* constant indices of loaded modules; */
 
 	DList_(DaoRoutine*)    *routines;
 
@@ -431,6 +432,8 @@ struct DaoByteCoder
 	DaoVmSpace    *vmspace;
 };
 
+uint_t DaoRotatingHash( DString *text );
+
 DaoByteBlock* DaoByteBlock_New( DaoByteCoder *coder );
 void DaoByteBlock_Delete( DaoByteBlock *self );
 
@@ -438,6 +441,7 @@ DaoByteCoder* DaoByteCoder_New( DaoVmSpace *vms );
 void DaoByteCoder_Delete( DaoByteCoder *self );
 
 void DaoByteCoder_Reset( DaoByteCoder *self );
+void DaoByteCoder_CollectLoads( DaoByteCoder *self, DList *modules );
 
 DaoByteBlock* DaoByteCoder_Init( DaoByteCoder *self );
 DaoByteBlock* DaoByteCoder_NewBlock( DaoByteCoder *self, int type );
@@ -53,6 +53,7 @@ DaoClass* DaoClass_New( DaoNamespace *nspace )
 	GC_IncRC( self->nameSpace );
 
 	self->lookupTable = DHash_New( DAO_DATA_STRING, 0 );
+	self->symbolTable = DHash_New( DAO_DATA_VOID2, 0 );
 	self->methSignatures = DHash_New( DAO_DATA_STRING, 0 );
 	self->constants   = DList_New( DAO_DATA_VALUE );
 	self->variables   = DList_New( DAO_DATA_VALUE );
@@ -87,6 +88,7 @@ void DaoClass_Delete( DaoClass *self )
 	GC_DecRC( self->nameSpace );
 	GC_DecRC( self->clsType );
 	DMap_Delete( self->lookupTable );
+	DMap_Delete( self->symbolTable );
 	DMap_Delete( self->methSignatures );
 	DList_Delete( self->constants );
 	DList_Delete( self->variables );
@@ -105,6 +107,39 @@ void DaoClass_Delete( DaoClass *self )
 	dao_free( self );
 }
 
+/*
+// All the updates of the lookup indices go through DaoClass_SetLookup(),
+// so that DaoClass::symbolTable is kept consistent with DaoClass::lookupTable.
+*/
+static void DaoClass_SetLookup( DaoClass *self, DString *name, daoint index )
+{
+	void *key[2];
+	name = DaoVmSpace_Intern( self->nameSpace->vmSpace, name );
+	key[0] = name->chars;
+	key[1] = IntToPointer( name->size );
+	MAP_Insert( self->lookupTable, name, index );
+	MAP_Insert( self->symbolTable, key, index );
+}
+static void DaoClass_EraseLookup( DaoClass *self, DNode *node )
+{
+	void *key[2];
+	DString *name = DaoVmSpace_Intern( self->nameSpace->vmSpace, node->key.pString );
+	key[0] = name->chars;
+	key[1] = IntToPointer( name->size );
+	MAP_Erase( self->symbolTable, key );
+	DMap_EraseNode( self->lookupTable, node );
+}
+static DNode* DaoClass_FindLookup( DaoClass *self, DString *name )
+{
+	void *key[2];
+	DNode *node;
+	key[0] = name->chars;
+	key[1] = IntToPointer( name->size );
+	node = MAP_Find( self->symbolTable, key );
+	if( node != NULL ) return node;
+	return MAP_Find( self->lookupTable, name );
+}
+
 void DaoClass_AddReference( DaoClass *self, void *reference )
 {
 	if( reference == NULL ) return;
@@ -512,7 +547,7 @@ static int DaoClass_MixIn( DaoClass *self, DaoClass *mixin, DMap *mixed, DaoMeth
 			DNode *it2 = MAP_Find( idmap, LOOKUP_BIND( st, 0, 0, id ) );
 			if( it2 ) id = LOOKUP_ID( it2->value.pInt ); /* map index; */
 		}
-		MAP_Insert( self->lookupTable, it->key.pString, LOOKUP_BIND( st, pm, up+1, id ) );
+		DaoClass_SetLookup( self, it->key.pString, LOOKUP_BIND( st, pm, up+1, id ) );
 		if( st != DAO_CLASS_CONSTANT ) continue;
 		cst = self->constants->items.pConst[id]->value;
 		if( cst->type != DAO_ROUTINE ) continue;
@@ -803,7 +838,7 @@ int DaoClass_DeriveClassData( DaoClass *self )
 			case DAO_OBJECT_VARIABLE : continue;
 			}
 			id = LOOKUP_BIND( st, pm, up+1, id );
-			DMap_Insert( self->lookupTable, it->key.pString, (void*)id );
+			DaoClass_SetLookup( self, it->key.pString, id );
 		}
 	}else if( self->parent && self->parent->type == DAO_CTYPE ){
 		DaoCtype *ctype = (DaoCtype*) self->parent;
@@ -828,7 +863,7 @@ int DaoClass_DeriveClassData( DaoClass *self )
 			if( DMap_Find( self->lookupTable, it->key.pString ) ) continue;
 			id = self->constants->size;
 			id = LOOKUP_BIND( DAO_CLASS_CONSTANT, DAO_PERM_PUBLIC, 1, id );
-			DMap_Insert( self->lookupTable, it->key.pString, IntToPointer( id ) );
+			DaoClass_SetLookup( self, it->key.pString, id );
 			DList_Append( self->cstDataName, it->key.pString );
 			DList_Append( self->constants, DaoConstant_New( it->value.pValue, DAO_CLASS_CONSTANT ) );
 		}
@@ -836,7 +871,7 @@ int DaoClass_DeriveClassData( DaoClass *self )
 			if( DMap_Find( self->lookupTable, it->key.pString ) ) continue;
 			id = self->constants->size;
 			id = LOOKUP_BIND( DAO_CLASS_CONSTANT, DAO_PERM_PUBLIC, 1, id );
-			DMap_Insert( self->lookupTable, it->key.pString, IntToPointer( id ) );
+			DaoClass_SetLookup( self, it->key.pString, id );
 			DList_Append( self->cstDataName, it->key.pString );
 			DList_Append( self->constants, DaoConstant_New( it->value.pValue, DAO_CLASS_CONSTANT ) );
 
@@ -922,7 +957,7 @@ void DaoClass_DeriveObjectData( DaoClass *self )
 				search2 = MAP_Find( self->lookupTable, name );
 				if( search2 == NULL ){ /* To not overide data and routine: */
 					index = LOOKUP_BIND( DAO_OBJECT_VARIABLE, perm, i, (offset+idx) );
-					MAP_Insert( self->lookupTable, name, index );
+					DaoClass_SetLookup( self, name, index );
 				}
 			}
 		}
@@ -987,7 +1022,7 @@ void DaoClass_AddBaseClass( DaoClass *self, DaoValue *base )
 }
 int  DaoClass_FindConst( DaoClass *self, DString *name )
 {
-	DNode *node = MAP_Find( self->lookupTable, name );
+	DNode *node = DaoClass_FindLookup( self, name );
 	if( node == NULL || LOOKUP_ST( node->value.pInt ) != DAO_CLASS_CONSTANT ) return -1;
 	return node->value.pInt;
 }
@@ -1007,7 +1042,7 @@ void DaoClass_SetConst( DaoClass *self, int id, DaoValue *data )
 DaoValue* DaoClass_GetData( DaoClass *self, DString *name, DaoClass *hostClass )
 {
 	DaoValue *data = NULL;
-	DNode *node = MAP_Find( self->lookupTable, name );
+	DNode *node = DaoClass_FindLookup( self, name );
 	int st, pm, up, id, child;
 
 	if( ! node ) return NULL;
@@ -1029,7 +1064,7 @@ DaoValue* DaoClass_GetData( DaoClass *self, DString *name, DaoClass *hostClass )
 }
 int DaoClass_GetDataIndex( DaoClass *self, DString *name )
 {
-	DNode *node = MAP_Find( self->lookupTable, name );
+	DNode *node = DaoClass_FindLookup( self, name );
 	if( ! node ) return -1;
 	return node->value.pInt;
 }
@@ -1037,6 +1072,8 @@ int DaoClass_AddObjectVar( DaoClass *self, DString *name, DaoValue *deft, DaoTyp
 {
 	int id;
 	DNode *node = MAP_Find( self->lookupTable, name );
+
+	name = DaoVmSpace_Intern( self->nameSpace->vmSpace, name );
 	if( node && LOOKUP_UP( node->value.pInt ) == 0 ) return -DAO_CTW_WAS_DEFINED;
 
 	id = self->objDataName->size;
@@ -1044,7 +1081,7 @@ int DaoClass_AddObjectVar( DaoClass *self, DString *name, DaoValue *deft, DaoTyp
 		if( s == DAO_PERM_PRIVATE   ) self->attribs |= DAO_CLS_PRIVATE_VAR;
 		if( s == DAO_PERM_PROTECTED ) self->attribs |= DAO_CLS_PROTECTED_VAR;
 	}
-	MAP_Insert( self->lookupTable, name, LOOKUP_BIND( DAO_OBJECT_VARIABLE, s, 0, id ) );
+	DaoClass_SetLookup( self, name, LOOKUP_BIND( DAO_OBJECT_VARIABLE, s, 0, id ) );
 	DList_Append( self->objDataName, (void*)name );
 	DList_Append( self->instvars, DaoVariable_New( deft, t, DAO_OBJECT_VARIABLE ) );
 	DaoValue_MarkConst( self->instvars->items.pVar[ id ]->value );
@@ -1067,7 +1104,8 @@ static int DaoClass_AddConst2( DaoClass *self, DString *name, DaoValue *data, in
 			data = (DaoValue*) routs;
 		}
 	}
-	MAP_Insert( self->lookupTable, name, id );
+	name = DaoVmSpace_Intern( ns->vmSpace, name );
+	DaoClass_SetLookup( self, name, id );
 	DaoClass_AddConst3( self, name, data );
 	return id;
 }
@@ -1103,27 +1141,28 @@ int DaoClass_AddConst( DaoClass *self, DString *name, DaoValue *data, int s )
 		pm = LOOKUP_PM( node->value.pInt );
 		id = LOOKUP_ID( node->value.pInt );
 		if( sto != DAO_CLASS_CONSTANT ){ /* override inherited variable: */
-			DMap_EraseNode( self->lookupTable, node );
+			DaoClass_EraseLookup( self, node );
 			return DaoClass_AddConst( self, name, data, s );
 		}
-		node->value.pInt = LOOKUP_BIND( sto, pm, 0, id );
+		DaoClass_SetLookup( self, name, LOOKUP_BIND( sto, pm, 0, id ) );
 		dest = self->constants->items.pConst[id];
 		if( dest->value->type == DAO_ROUTINE && data->type == DAO_ROUTINE ){
 			/* Add the inherited routine(s) for overloading: */
 			DaoRoutine *routs = DaoRoutines_New( ns, self->objType, (DaoRoutine*)dest->value );
 			DaoConstant *cst = DaoConstant_New( (DaoValue*) routs, DAO_CLASS_CONSTANT );
 			routs->trait |= DAO_VALUE_CONST;
-			node->value.pInt = LOOKUP_BIND( sto, pm, 0, self->constants->size );
+			DaoClass_SetLookup( self, name, LOOKUP_BIND( sto, pm, 0, self->constants->size ) );
 			DList_Append( self->cstDataName, (void*) name );
 			DList_Append( self->constants, cst );
 			return DaoClass_AddConst( self, name, data, s );
 		}else{
 			/* Add the new constant: */
 			DaoConstant *cst = DaoConstant_New( data, DAO_CLASS_CONSTANT );
-			node->value.pInt = LOOKUP_BIND( sto, pm, 0, self->constants->size );
+			id = LOOKUP_BIND( sto, pm, 0, self->constants->size );
+			DaoClass_SetLookup( self, name, id );
 			DList_Append( self->cstDataName, (void*) name );
 			DList_Append( self->constants, cst );
-			return node->value.pInt;
+			return id;
 		}
 	}else if( node ){
 		sto = LOOKUP_ST( node->value.pInt );
@@ -1133,7 +1172,7 @@ int DaoClass_AddConst( DaoClass *self, DString *name, DaoValue *data, int s )
 		dest = self->constants->items.pConst[id];
 		value = dest->value;
 		if( value->type != DAO_ROUTINE || data->type != DAO_ROUTINE ) return -DAO_CTW_WAS_DEFINED;
-		if( s > pm ) node->value.pInt = LOOKUP_BIND( sto, s, 0, id );
+		if( s > pm ) DaoClass_SetLookup( self, name, LOOKUP_BIND( sto, s, 0, id ) );
 		if( value->xRoutine.overloads == NULL || value->xRoutine.routHost != self->objType ){
 			DaoRoutine *routs = DaoRoutines_New( ns, self->objType, (DaoRoutine*) value );
 			routs->trait |= DAO_VALUE_CONST;
@@ -1163,7 +1202,8 @@ int DaoClass_AddGlobalVar( DaoClass *self, DString *name, DaoValue *data, DaoTyp
 	DNode *node = MAP_Find( self->lookupTable, name );
 	if( node && LOOKUP_UP( node->value.pInt ) ) return -DAO_CTW_WAS_DEFINED;
 	if( data == NULL && t ) data = t->value;
-	MAP_Insert( self->lookupTable, name, id );
+	name = DaoVmSpace_Intern( self->nameSpace->vmSpace, name );
+	DaoClass_SetLookup( self, name, id );
 	DList_Append( self->variables, DaoVariable_New( NULL, t, DAO_CLASS_VARIABLE ) );
 	DList_Append( self->glbDataName, (void*)name );
 	if( data && DaoValue_Move( data, & self->variables->items.pVar[size]->value, t ) ==0 )
@@ -1374,7 +1414,7 @@ static int DaoClass_CheckSetField( DaoType *self, DaoString *name, DaoType *valu
 static int DaoClass_DoSetField( DaoValue *self, DaoString *name, DaoValue *value, DaoProcess *proc )
 {
 	DaoClass *klass = (DaoClass*) self;
-	DNode *node = DMap_Find( klass->lookupTable, name->value );
+	DNode *node = DaoClass_FindLookup( klass, name->value );
 	if( node && LOOKUP_ST( node->value.pInt ) == DAO_CLASS_VARIABLE ){
 		int up = LOOKUP_UP( node->value.pInt );
 		int id = LOOKUP_ID( node->value.pInt );
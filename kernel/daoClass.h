@@ -41,7 +41,10 @@
 // -- DaoClass::objType: for the instance objects of the class;
 //
 // The class members can be looked up by DaoClass::lookupTable, which maps
-// the member names to lookup indices.
+// the member names to lookup indices. DaoClass::symbolTable maps the same
+// members by their names interned in the vm space (see DaoVmSpace_Intern()),
+// so that the names sharing the buffers of the interned names can be found
+// without hashing and comparing their chars.
 //
 // Bit structure for the lookup indices: EEPPSSSSUUUUUUUUIIIIIIIIIIIIIIII.
 // Where:
@@ -111,6 +114,7 @@ struct DaoClass
 	DaoType  *objType; /* GC handled in constants; */
 
 	DHash_(DString*,size_t)  *lookupTable;  /* member lookup table; */
+	DHash_(void*[2],size_t)  *symbolTable;  /* member lookup table by interned names; */
 
 	DList_(DaoConstant*)  *constants; /* constants; */
 	DList_(DaoVariable*)  *variables; /* static variables (types and init values); */
@@ -203,7 +203,8 @@ enum DaoProcessPauseType
 	DAO_PAUSE_CHANNEL_SEND ,    /* channel::send(); */
 	DAO_PAUSE_CHANNEL_RECEIVE , /* channel::send(); */
 	DAO_PAUSE_CHANFUT_SELECT ,  /* mt::select(); */
-	DAO_PAUSE_COROUTINE_YIELD   /* coroutine; */
+	DAO_PAUSE_COROUTINE_YIELD , /* coroutine; */
+	DAO_PAUSE_STREAM_WAIT       /* stream reading or writing, retried on resuming; */
 };
 
 enum DaoFieldPermission
@@ -237,7 +238,8 @@ enum DaoRoutineAttrib
 	DAO_ROUT_MAIN      = (1<<10),  /* main function */
 	DAO_ROUT_PRIVATE   = (1<<11),  /* private method */
 	DAO_ROUT_PROTECTED = (1<<12),  /* protected method */
-	DAO_ROUT_REUSABLE  = (1<<13)   /* stack data for the routine is reusable */
+	DAO_ROUT_REUSABLE  = (1<<13),  /* stack data for the routine is reusable */
+	DAO_ROUT_LEAF      = (1<<14)   /* leaf C function callable without frame */
 };
 
 enum DaoConstEvalMode
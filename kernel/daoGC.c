@@ -673,7 +673,7 @@ void DaoCGC_Start()
 	gcWorker.finalizing = 0;
 	gcWorker.fullgc = 0;
 	gcWorker.cycle = 0;
-	if( DThread_Start( & gcWorker.thread, DaoCGC_Recycle, NULL ) == 0 ){
+	if( DThread_StartPlaced( & gcWorker.thread, DaoCGC_Recycle, NULL ) == 0 ){
 		dao_abort( "failed to create the GC thread" );
 	}
 #endif
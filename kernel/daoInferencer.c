@@ -1607,8 +1607,7 @@ int DaoInferencer_HandleGetField( DaoInferencer *self, DaoInode *inode, DMap *de
 		ct = at->core->CheckGetField( at, field, self->routine );
 		if( ct == NULL ) goto InvalidField;
 
-		node = MAP_Find( at->mapNames, name );
-		k = node->value.pInt;
+		k = DaoType_FindName( at, name );
 		if( k < 0xffff ){
 			if( ct->tid >= DAO_BOOLEAN && ct->tid <= DAO_COMPLEX ){
 				vmc->code = DVM_GETF_TB + ( ct->tid - DAO_BOOLEAN );
@@ -1962,8 +1961,7 @@ int DaoInferencer_HandleSetField( DaoInferencer *self, DaoInode *inode, DMap *de
 		K = ct->core->CheckSetField( ct, field, at, self->routine );
 		if( K ) goto InvalidField;
 
-		node = MAP_Find( ct->mapNames, name );
-		k = node->value.pInt;
+		k = DaoType_FindName( ct, name );
 		if( k <0 || k >= (int)ct->args->size ) goto InvalidField;
 
 		ct = ct->args->items.pType[ k ];
@@ -2459,6 +2457,28 @@ static DaoRoutine* DaoInferencer_Specialize( DaoInferencer *self, DaoRoutine *ro
 	}
 	return rout;
 }
+/*
+// Precompile the constant pattern of a call to the regex methods of string,
+// and pin it in the VM space cache, so that it is compiled only once:
+*/
+static void DaoInferencer_PinRegex( DaoInferencer *self, DaoRoutine *rout, DaoType **tp, DaoValue **pp )
+{
+	static const char *const methods[] = { "match", "change", "capture", "scan", "extract", "fetch" };
+	DaoVmSpace *vmspace = self->routine->nameSpace->vmSpace;
+	DString *pattern;
+	int i;
+
+	if( rout->pFunc == NULL || tp[0]->tid != DAO_STRING ) return;
+	if( pp[1] == NULL || pp[1]->type != DAO_STRING ) return;
+	for(i=0; i<6; ++i) if( strcmp( rout->routName->chars, methods[i] ) == 0 ) break;
+	if( i >= 6 ) return;
+
+	pattern = DString_Copy( pp[1]->xString.value );
+	DString_Trim( pattern, 1, 1, 0 );
+	if( pattern->size ) DaoRegexCache_Pin( vmspace->regexCache, pattern );
+	DString_Delete( pattern );
+}
+
 int DaoInferencer_HandleCall( DaoInferencer *self, DaoInode *inode, int i, DMap *defs )
 {
 	int code = inode->code;
@@ -2725,6 +2745,7 @@ int DaoInferencer_HandleCall( DaoInferencer *self, DaoInode *inode, int i, DMap
 		/*
 		   printf( "ct2 = %s\n", ct ? ct->name->chars : "" );
 		 */
+		if( code == DVM_MCALL && argc > 1 ) DaoInferencer_PinRegex( self, rout, tp, pp );
 	}
 	k = routine->routType->attrib & ct->attrib;
 	if( at->tid != DAO_CLASS && ! ctchecked ) ct = & ct->aux->xType;
@@ -801,7 +801,7 @@ dao_integer DaoToken_ToInteger( DaoToken *self )
 	switch( self->name ){
 	case DTOK_NUMBER_DEC : case DTOK_NUMBER_SCI :
 	case DTOK_NUMBER_IMG :
-		value = strtod( chars, NULL );
+		value = Dao_ParseFloat( chars );
 		break;
 	case DTOK_DIGITS_DEC :
 		value = sizeof(dao_integer) == 4 ? strtol(chars, 0, 10) : strtoll(chars, 0, 10);
@@ -819,7 +819,7 @@ dao_float DaoToken_ToFloat( DaoToken *self )
 	switch( self->name ){
 	case DTOK_NUMBER_DEC : case DTOK_NUMBER_SCI :
 	case DTOK_NUMBER_IMG :
-		value = strtod( chars, NULL );
+		value = Dao_ParseFloat( chars );
 		break;
 	case DTOK_DIGITS_DEC :
 		value = sizeof(dao_integer) == 4 ? strtol(chars, 0, 10) : strtoll(chars, 0, 10);
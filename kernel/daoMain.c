@@ -39,6 +39,10 @@
 #include "daoVmspace.h"
 #endif
 
+#ifdef DAO_WITH_CONCURRENT
+#include "daoTasklet.h"
+#endif
+
 #ifdef DAO_USE_READLINE
 #include"readline/readline.h"
 #include"readline/history.h"
@@ -105,6 +109,15 @@ static void DaoSignalHandler( int sig )
 }
 
 
+#if defined(DAO_WITH_CONCURRENT) && defined(UNIX)
+/* Print the states of the tasklets on "kill -USR1 pid": */
+static void DaoTaskletSignalHandler( int sig )
+{
+	DaoVmSpace_RequestTaskletLog( vmSpace );
+}
+#endif
+
+
 #if defined(DAO_WITH_RESTART) && defined(UNIX)
 
 #include <unistd.h>
@@ -313,6 +326,9 @@ int main( int argc, char **argv )
 #endif
 
 	signal( SIGINT, DaoSignalHandler );
+#if defined(DAO_WITH_CONCURRENT) && defined(UNIX)
+	signal( SIGUSR1, DaoTaskletSignalHandler );
+#endif
 
 	/* Start execution. */
 	k = DaoVmSpace_RunMain( vmSpace, DString_GetData( args ) );
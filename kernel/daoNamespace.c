@@ -931,7 +931,7 @@ int DaoNamespace_AddConst( DaoNamespace *self, DString *name, DaoValue *value, i
 	if( node ) return -DAO_CTW_WAS_DEFINED;
 
 	id = LOOKUP_BIND( DAO_GLOBAL_CONSTANT, pm, 0, self->constants->size );
-	MAP_Insert( self->lookupTable, name, id );
+	MAP_Insert( self->lookupTable, DaoVmSpace_Intern( self->vmSpace, name ), id );
 	DList_Append( self->constants, (dest = DaoConstant_New( value, DAO_GLOBAL_CONSTANT )) );
 	DaoValue_MarkConst( dest->value );
 	return id;
@@ -991,7 +991,7 @@ int DaoNamespace_AddVariable( DaoNamespace *self, DString *name, DaoValue *value
 		return -1;
 	}else{
 		id = LOOKUP_BIND( DAO_GLOBAL_VARIABLE, pm, 0, self->variables->size );
-		MAP_Insert( self->lookupTable, name, id ) ;
+		MAP_Insert( self->lookupTable, DaoVmSpace_Intern( self->vmSpace, name ), id ) ;
 		DList_Append( self->variables, DaoVariable_New( value, dectype, DAO_GLOBAL_VARIABLE ) );
 	}
 	return id;
@@ -1553,6 +1553,7 @@ DaoType* DaoNamespace_MakeType( DaoNamespace *self, const char *name,
 			GC_Assign( & type->aux, aux );
 		}else if( tid == DAO_PAR_NAMED || tid == DAO_PAR_DEFAULT ){
 			DString_SetChars( type->fname, name );
+			DString_Assign( type->fname, DaoVmSpace_Intern( self->vmSpace, type->fname ) );
 		}
 		DaoType_CheckAttributes( type );
 		type = DaoNamespace_AddType( self, type->name, type );
@@ -1592,6 +1593,10 @@ DaoType* DaoNamespace_MakeRoutType( DaoNamespace *self, DaoType *routype,
 		if( newtype->mapNames ) DMap_Delete( newtype->mapNames );
 		newtype->mapNames = DMap_Copy( routype->mapNames );
 	}
+	if( routype->mapSymbols ){
+		if( newtype->mapSymbols ) DMap_Delete( newtype->mapSymbols );
+		newtype->mapSymbols = DMap_Copy( routype->mapSymbols );
+	}
 
 	DString_AppendChars( newtype->name, "routine<" );
 	for(i=0; i<routype->args->size; i++){
@@ -1663,6 +1668,11 @@ DaoRoutine* DaoNamespace_ParseSignature( DaoNamespace *self, const char *proto,
 	GC_IncRC( parser->hostType );
 	func->routHost = parser->hostType;
 	if( ! DaoLexer_Tokenize( defparser->lexer, proto, 0 ) ) goto Error;
+	if( defparser->tokens->size && strcmp( defparser->tokens->items.pToken[0]->string.chars, "@leaf" ) == 0 ){
+		/* "@leaf" before the function name marks a leaf function (see dao.h): */
+		DList_Erase( defparser->tokens, 0, 1 );
+		func->attribs |= DAO_ROUT_LEAF;
+	}
 	if( defparser->tokens->size < 3 ) goto Error;
 
 	parser->routine = (DaoRoutine*) func; /* safe to parse params only */
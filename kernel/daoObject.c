@@ -233,23 +233,22 @@ void DaoObject_AddData( DaoObject *self, DString *name, DaoValue *data )
 
 int DaoObject_SetData( DaoObject *self, DString *name, DaoValue *data, DaoObject *hostObject )
 {
-	DNode *node;
 	DaoType *type;
 	DaoValue **value ;
 	DaoClass *klass = self->defClass;
 	DaoObject *null = (DaoObject*) klass->objType->value;
 	int child = hostObject && DaoObject_ChildOf( hostObject, (DaoValue*) self );
-	int id, st, up, pm, access;
+	int index, id, st, up, pm, access;
 
 	if( self == null ) return DAO_ERROR;
 
-	node = DMap_Find( self->defClass->lookupTable, name );
-	if( node == NULL ) return DAO_ERROR_FIELD_ABSENT;
+	index = DaoClass_GetDataIndex( self->defClass, name );
+	if( index < 0 ) return DAO_ERROR_FIELD_ABSENT;
 
-	pm = LOOKUP_PM( node->value.pInt );
-	st = LOOKUP_ST( node->value.pInt );
-	up = LOOKUP_UP( node->value.pInt );
-	id = LOOKUP_ID( node->value.pInt );
+	pm = LOOKUP_PM( index );
+	st = LOOKUP_ST( index );
+	up = LOOKUP_UP( index );
+	id = LOOKUP_ID( index );
 	if( self == null && st == DAO_OBJECT_VARIABLE ) return DAO_ERROR_FIELD_HIDDEN;
 	access = hostObject == self || pm == DAO_PERM_PUBLIC || (child && pm >= DAO_PERM_PROTECTED);
 	if( access == 0 ) return DAO_ERROR_FIELD_HIDDEN;
@@ -270,21 +269,20 @@ int DaoObject_SetData( DaoObject *self, DString *name, DaoValue *data, DaoObject
 }
 int DaoObject_GetData( DaoObject *self, DString *name, DaoValue **data, DaoObject *hostObject )
 {
-	DNode *node;
 	DaoValue *p = NULL;
 	DaoClass *klass = self->defClass;
 	DaoObject *null = (DaoObject*) klass->objType->value;
 	int child = hostObject && DaoObject_ChildOf( hostObject, (DaoValue*) self );
-	int id, st, up, pm, access;
+	int index, id, st, up, pm, access;
 
 	*data = NULL;
-	node = DMap_Find( self->defClass->lookupTable, name );
-	if( node == NULL ) return DAO_ERROR_FIELD_ABSENT;
+	index = DaoClass_GetDataIndex( self->defClass, name );
+	if( index < 0 ) return DAO_ERROR_FIELD_ABSENT;
 
-	pm = LOOKUP_PM( node->value.pInt );
-	st = LOOKUP_ST( node->value.pInt );
-	up = LOOKUP_UP( node->value.pInt );
-	id = LOOKUP_ID( node->value.pInt );
+	pm = LOOKUP_PM( index );
+	st = LOOKUP_ST( index );
+	up = LOOKUP_UP( index );
+	id = LOOKUP_ID( index );
 	if( self == null && st == DAO_OBJECT_VARIABLE ) return DAO_ERROR_FIELD_HIDDEN;
 	access = hostObject == self || pm == DAO_PERM_PUBLIC || (child && pm >= DAO_PERM_PROTECTED);
 	if( access == 0 ) return DAO_ERROR_FIELD_HIDDEN;
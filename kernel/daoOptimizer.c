@@ -1520,6 +1520,129 @@ static void DaoOptimizer_DCE( DaoOptimizer *self, DaoRoutine *routine )
 	DaoInodes_Clear( inodes );
 	DList_Delete( inodes );
 }
+/*
+// Check if the result of the i-th instruction is a temporary used only by a later
+// instruction in the same straight-line code, and return the index of the use.
+// Only constant loadings and moves may appear in between.
+*/
+static int DaoOptimizer_GetTempUse( DaoOptimizer *self, int i )
+{
+	DaoVmCodeX **codes = self->routine->body->annotCodes->items.pVmc;
+	DaoCnode *use, *node = self->nodes->items.pCnode[i];
+	int k;
+
+	if( node->lvalue == 0xffff || node->uses->size != 1 ) return -1;
+	if( DaoRoutine_IsVolatileParameter( self->routine, node->lvalue ) ) return -1;
+	use = node->uses->items.pCnode[0];
+	if( use->index <= i ) return -1;
+	if( DaoCnode_CountDefinitions( use, node->lvalue ) != 1 ) return -1;
+	for(k=i+1; k<use->index; ++k){
+		switch( DaoVmCode_GetOpcodeType( (DaoVmCode*) codes[k] ) ){
+		case DAO_CODE_GETC : case DAO_CODE_MOVE : break;
+		default : return -1;
+		}
+	}
+	return use->index;
+}
+static int DaoOptimizer_IsTouched( DaoOptimizer *self, int first, int last, int reg )
+{
+	DaoVmCodeX **codes = self->routine->body->annotCodes->items.pVmc;
+	int k;
+	for(k=first; k<=last; ++k){
+		DaoVmCodeX *vmc = codes[k];
+		if( vmc->code == DVM_ADD_SSS ) continue;  /* Checked separately; */
+		if( vmc->c == reg ) return 1;
+		if( DaoVmCode_GetOpcodeType( (DaoVmCode*) vmc ) == DAO_CODE_MOVE && vmc->a == reg ) return 1;
+	}
+	return 0;
+}
+/*
+// String Concatenation:
+// Rewrite chains of string additions to append to the final destination in place,
+// so that the accumulated string is not copied for each intermediate result:
+//   t1 = a + b;  t2 = t1 + c;  s = t2;   =>   s = a + b;  s = s + c;
+//   t1 = b + c;  s = s + t1;             =>   s = s + b;  s = s + c;
+*/
+static void DaoOptimizer_StringConcat( DaoOptimizer *self, DaoRoutine *routine )
+{
+	DList *chain = self->array2;
+	DList *done = self->array3;
+	DaoVmCodeX *last, *next, **codes = routine->body->annotCodes->items.pVmc;
+	daoint i, j, k, N = routine->body->annotCodes->size;
+	int dest, append, modified = 0;
+
+	for(i=0,j=0,k=0; i<N; ++i){
+		j += codes[i]->code == DVM_ADD_SSS;
+		k += codes[i]->code == DVM_MOVE_SS;
+	}
+	if( j == 0 || (j == 1 && k == 0) ) return;
+
+	self->routine = routine;
+	DaoOptimizer_LinkDU( self, routine );
+	DList_Resize( done, N, 0 );
+	for(i=0; i<N; ++i) done->items.pInt[i] = 0;
+	for(i=0; i<N; ++i){
+		if( codes[i]->code != DVM_ADD_SSS || done->items.pInt[i] ) continue;
+		chain->size = 0;
+		DList_Append( chain, IntToPointer(i) );
+		next = NULL;
+		while(1){
+			last = codes[ chain->items.pInt[chain->size-1] ];
+			j = DaoOptimizer_GetTempUse( self, chain->items.pInt[chain->size-1] );
+			if( j < 0 || done->items.pInt[j] ) break;
+			next = codes[j];
+			if( next->code != DVM_ADD_SSS || next->a != last->c ) break;
+			DList_Append( chain, IntToPointer(j) );
+			next = NULL;
+		}
+		dest = last->c;
+		append = 0;
+		if( next != NULL ){
+			if( next->code == DVM_MOVE_SS && next->a == last->c ){
+				dest = next->c;
+			}else if( next->code == DVM_ADD_SSS && next->b == last->c && next->a == next->c ){
+				dest = next->c;
+				append = 1;
+			}else{
+				next = NULL;
+			}
+		}
+		if( next == NULL && chain->size == 1 ) continue;
+
+		/* Appending a string to itself may reallocate the source: */
+		for(k=1; k<chain->size; ++k) if( codes[chain->items.pInt[k]]->b == dest ) break;
+		j = next ? j : chain->items.pInt[chain->size-1];
+		if( k < chain->size || DaoOptimizer_IsTouched( self, i+1, j-1, dest ) ) continue;
+		if( codes[i]->b == dest && (append || codes[i]->a == dest) ) continue;
+		if( append ){
+			if( codes[i]->a == dest ) continue;
+			/* The right operands will be read later: */
+			for(k=0; k<chain->size; ++k){
+				int reg = codes[chain->items.pInt[k]]->b;
+				if( DaoOptimizer_IsTouched( self, i+1, j-1, reg ) ) break;
+			}
+			if( k < chain->size ) continue;
+
+			next->b = last->b;
+			for(k=chain->size-1; k>0; --k){
+				DaoVmCodeX *vmc = codes[chain->items.pInt[k]];
+				vmc->b = codes[chain->items.pInt[k-1]]->b;
+			}
+			codes[i]->b = codes[i]->a;
+		}else if( next != NULL ){
+			next->code = DVM_UNUSED;
+		}
+		for(k=0; k<chain->size; ++k){
+			DaoVmCodeX *vmc = codes[chain->items.pInt[k]];
+			if( k || append ) vmc->a = dest;
+			vmc->c = dest;
+			done->items.pInt[chain->items.pInt[k]] = 1;
+		}
+		if( next ) done->items.pInt[j] = 1;
+		modified = 1;
+	}
+	if( modified ) DaoRoutine_UpdateCodes( routine );
+}
 /* Simple remapping the used registers to remove the unused ones: */
 static void DaoOptimizer_RemapRegister( DaoOptimizer *self, DaoRoutine *routine )
 {
@@ -1757,6 +1880,8 @@ void DaoOptimizer_Optimize( DaoOptimizer *self, DaoRoutine *routine )
 	/* Do not perform optimization if it may take too much memory: */
 	if( (routine->body->vmCodes->size * routine->body->regCount) > 1000000 ) return;
 
+	DaoOptimizer_StringConcat( self, routine );
+
 	if( routine->body->simpleVariables->size < routine->body->regCount / 2 ) return;
 	for(i=0,k=0; i<routine->body->simpleVariables->size; i++){
 		type = types[ routine->body->simpleVariables->items.pInt[i] ];
@@ -5724,7 +5724,7 @@ static int DaoParser_AddFieldConst( DaoParser *self, DString *field )
 	DString_Append( self->string, field );
 	if( MAP_Find( self->allConsts, self->string )==NULL ){
 		DaoString str = {DAO_STRING,0,0,0,0,NULL};
-		str.value = field;
+		str.value = DaoVmSpace_Intern( self->vmSpace, field );
 		MAP_Insert( self->allConsts, self->string, self->routine->routConsts->value->size );
 		DaoRoutine_AddConstant( self->routine, (DaoValue*) & str );
 	}
@@ -6496,7 +6496,7 @@ static DaoEnode DaoParser_ParsePrimary( DaoParser *self, int stop, int eltype )
 		DaoValue *value = (DaoValue*) & ds;
 		DString *field = & tokens[start]->string;
 
-		ds.value = field;
+		ds.value = DaoVmSpace_Intern( self->vmSpace, field );
 		self->curToken += 2;
 		if( type && type->tid == DAO_PAR_NAMED ) type = (DaoType*) type->aux;
 		if( type ) DList_PushFront( self->enumTypes, type );
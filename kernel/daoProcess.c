@@ -183,22 +183,40 @@ DaoVmSpace* DaoProcess_GetVmSpace( DaoProcess *self )
 }
 
 
+static void DaoProcess_ExpandStack( DaoProcess *self, daoint N )
+{
+	daoint offset = self->activeValues - self->stackValues;
+
+	if( N <= self->stackSize ) return;
+	self->stackValues = (DaoValue**)dao_realloc( self->stackValues, N*sizeof(DaoValue*) );
+	self->paramValues = self->stackValues + 1;
+	memset( self->stackValues + self->stackSize, 0, (N-self->stackSize)*sizeof(DaoValue*) );
+	if( self->activeValues ) self->activeValues = self->stackValues +  offset;
+	self->stackSize = N;
+}
+static void DaoProcess_InvalidateFrames( DaoProcess *self, DaoStackFrame *frame )
+{
+	/*
+	// Check and reset frames that have the stack values invalidated for reusing.
+	// A frame is invalidated if the range of its stack values is partially covered
+	// by this frame.
+	*/
+	DaoStackFrame *f = frame->next;
+	while( f && f->stackBase < self->stackTop ){
+		f->stackBase = self->stackTop;
+		f->varCount = 0; /* To make sure this frame is re-initialized; */
+		f = f->next;
+	}
+}
 DaoStackFrame* DaoProcess_PushFrame( DaoProcess *self, int size )
 {
-	daoint i, N = self->stackTop + size;
-	DaoStackFrame *f, *frame = self->topFrame->next;
+	daoint N = self->stackTop + size;
+	DaoStackFrame *frame = self->topFrame->next;
 	DaoProfiler *profiler = self->vmSpace->profiler;
 
 	if( profiler && self->topFrame ) profiler->LeaveFrame( profiler, self, self->topFrame, 0 );
 
-	if( N > self->stackSize ){
-		daoint offset = self->activeValues - self->stackValues;
-		self->stackValues = (DaoValue**)dao_realloc( self->stackValues, N*sizeof(DaoValue*) );
-		self->paramValues = self->stackValues + 1;
-		memset( self->stackValues + self->stackSize, 0, (N-self->stackSize)*sizeof(DaoValue*) );
-		if( self->activeValues ) self->activeValues = self->stackValues +  offset;
-		self->stackSize = N;
-	}
+	DaoProcess_ExpandStack( self, N );
 	if( frame == NULL ){
 		frame = DaoStackFrame_New();
 		frame->prev = self->topFrame;
@@ -242,17 +260,41 @@ DaoStackFrame* DaoProcess_PushFrame( DaoProcess *self, int size )
 	self->topFrame = frame;
 	self->stackTop += size;
 
-	/*
-	// Check and reset frames that have the stack values invalidated for reusing.
-	// A frame is invalidated if the range of its stack values is partially covered
-	// by this frame.
-	*/
-	f = frame->next;
-	while( f && f->stackBase < self->stackTop ){
-		f->stackBase = self->stackTop;
-		f->varCount = 0; /* To make sure this frame is re-initialized; */
-		f = f->next;
+	DaoProcess_InvalidateFrames( self, frame );
+	return frame;
+}
+/*
+// Reset the top frame in place for a tail call, so that it can be used by
+// the called routine without popping it and pushing a new one. The frame
+// keeps its stack base, returning mode and returning register, as well as
+// the bases for defers and exceptions.
+*/
+static DaoStackFrame* DaoProcess_ReuseFrame( DaoProcess *self, int size )
+{
+	DaoStackFrame *frame = self->topFrame;
+	DaoProfiler *profiler = self->vmSpace->profiler;
+
+	if( profiler ) profiler->LeaveFrame( profiler, self, frame, 1 );
+
+	DaoProcess_ExpandStack( self, frame->stackBase + size );
+	if( frame->routine ){
+		int reusable = frame->routine->attribs & DAO_ROUT_REUSABLE;
+		if( reusable == 0 || frame->varCount != size ){
+			GC_DecRC( frame->routine );
+			frame->routine = NULL;
+		}
 	}
+	GC_DecRC( frame->object );
+	frame->object = NULL;
+	frame->outer = NULL;
+	frame->host = NULL;
+	frame->varCount = size;
+	frame->entry = 0;
+	frame->state = 0;
+	frame->parCount = 0;
+	self->stackTop = frame->stackBase + size;
+
+	DaoProcess_InvalidateFrames( self, frame );
 	return frame;
 }
 void DaoProcess_PopFrame( DaoProcess *self )
@@ -386,7 +428,11 @@ static void DaoProcess_PushRoutineMode( DaoProcess *self, DaoRoutine *routine, D
 	}
 	if( routine->attribs & DAO_ROUT_STATIC ) object = NULL;
 
-	frame = DaoProcess_PushFrame( self, routine->body->regCount );
+	if( mode & DAO_CALL_TAIL ){
+		frame = DaoProcess_ReuseFrame( self, routine->body->regCount );
+	}else{
+		frame = DaoProcess_PushFrame( self, routine->body->regCount );
+	}
 	DaoProcess_InitTopFrame( self, routine, object );
 	frame->active = frame;
 	self->status = DAO_PROCESS_STACKED;
@@ -525,6 +571,14 @@ DaoRoutine* DaoProcess_PassParams( DaoProcess *self, DaoRoutine *routine, DaoTyp
 		if( need_self && parindex == 0 ){
 			/* To avoid copying: */
 			partype = DaoType_GetInvarType( partype );
+			if( argvalue->type == DAO_STRING && partype->tid == DAO_STRING && (routine->attribs & DAO_ROUT_LEAF) ){
+				/*
+				// Leaf functions do not modify their primitive parameters,
+				// pass the string itself to keep its cached char index:
+				*/
+				GC_Assign( & dest[parindex], argvalue );
+				continue;
+			}
 		}
 		if( DaoValue_Move2( argvalue, & dest[parindex], partype, defs ) == 0 ) goto ReturnNull;
 		if( defs && (partype->tid == DAO_UDT || partype->tid == DAO_THT) ){
@@ -760,6 +814,19 @@ DaoValue* DaoProcess_Eval( DaoProcess *self, DaoNamespace *nspace, const char *s
 	if( nspace->mainRoutine->routType->aux->xType.tid != DAO_NONE ) return self->stackValues[0];
 	return dao_none_value;
 }
+/*
+// Methods of C types with DAO_CLS_UNITHREAD must be called from the thread
+// designated by the user handler:
+*/
+static int DaoProcess_NeedMigration( DaoProcess *self, DaoRoutine *routine )
+{
+	DaoType *hostype = routine->routHost;
+	if( self->vmSpace->handler == NULL || self->vmSpace->handler->MigrateCall == NULL ) return 0;
+	if( hostype && (hostype->tid == DAO_CSTRUCT || hostype->tid == DAO_CDATA) ){
+		return hostype->aux->xCtype.attribs & DAO_CLS_UNITHREAD;
+	}
+	return 0;
+}
 int DaoProcess_Call( DaoProcess *self, DaoRoutine *M, DaoValue *O, DaoValue *P[], int N )
 {
 	int migrate = 0;
@@ -767,12 +834,7 @@ int DaoProcess_Call( DaoProcess *self, DaoRoutine *M, DaoValue *O, DaoValue *P[]
 	if( ret ) goto Done;
 	/* no return value to the previous stack frame */
 	DaoProcess_InterceptReturnValue( self );
-	if( self->vmSpace->handler && self->vmSpace->handler->MigrateCall ){
-		DaoType *hostype = self->topFrame->routine->routHost;
-		if( hostype && (hostype->tid == DAO_CSTRUCT || hostype->tid == DAO_CDATA) ){
-			migrate = hostype->aux->xCtype.attribs & DAO_CLS_UNITHREAD;
-		}
-	}
+	migrate = DaoProcess_NeedMigration( self, self->topFrame->routine );
 	if( migrate ){
 		ret = self->vmSpace->handler->MigrateCall( self->vmSpace->handler, self );
 	}else{
@@ -784,6 +846,21 @@ Done:
 	return ret;
 }
 
+/*
+// Set the result register of the calling instruction to none,
+// when a C function returns without putting any value:
+*/
+static void DaoProcess_PutDefaultReturn( DaoProcess *self )
+{
+	int opc = self->activeCode->c;
+	int optype = DaoVmCode_GetOpcodeType( self->activeCode );
+	int ret = (optype >= DAO_CODE_GETC) & (optype <= DAO_CODE_GETM);
+	ret |= (optype >= DAO_CODE_MOVE) & (optype <= DAO_CODE_YIELD);
+	if( ret ){
+		DaoProcess_SetValue( self, opc, dao_none_value );
+		self->stackReturn = opc + (self->activeValues - self->stackValues);
+	}
+}
 static void DaoProcess_CallNativeFunction( DaoProcess *self )
 {
 	DaoStackFrame *frame = self->topFrame;
@@ -797,12 +874,7 @@ static void DaoProcess_CallNativeFunction( DaoProcess *self )
 
 	self->stackReturn = -1;
 
-	if( self->vmSpace->handler && self->vmSpace->handler->MigrateCall ){
-		DaoType *hostype = self->topFrame->routine->routHost;
-		if( hostype && (hostype->tid == DAO_CSTRUCT || hostype->tid == DAO_CDATA) ){
-			migrate = hostype->aux->xCtype.attribs & DAO_CLS_UNITHREAD;
-		}
-	}
+	migrate = DaoProcess_NeedMigration( self, frame->routine );
 	if( migrate ){
 		self->vmSpace->handler->MigrateCall( self->vmSpace->handler, self );
 	}else{
@@ -812,14 +884,7 @@ static void DaoProcess_CallNativeFunction( DaoProcess *self )
 		if( frame->retmode == DVM_RET_PROCESS ){
 			GC_Assign( self->stackValues, dao_none_value );
 		}else if( frame->retmode == DVM_RET_FRAME ){
-			int opc = self->activeCode->c;
-			int optype = DaoVmCode_GetOpcodeType( self->activeCode );
-			int ret = (optype >= DAO_CODE_GETC) & (optype <= DAO_CODE_GETM);
-			ret |= (optype >= DAO_CODE_MOVE) & (optype <= DAO_CODE_YIELD);
-			if( ret ){
-				DaoProcess_SetValue( self, opc, dao_none_value );
-				self->stackReturn = opc + (self->activeValues - self->stackValues);
-			}
+			DaoProcess_PutDefaultReturn( self );
 		}
 	}
 	/*
@@ -835,6 +900,31 @@ static void DaoProcess_CallNativeFunction( DaoProcess *self )
 	self->stackReturn = cur;
 }
 
+/*
+// Call a leaf C function (DAO_ROUT_LEAF) without pushing a stack frame.
+// The function runs with the caller's frame active, so that its result
+// goes directly to the result register of the calling instruction.
+// The return type of the caller's frame (DaoStackFrame::retype, which is
+// also used by tail calls) is set aside during the call, so that a return
+// type queried by DaoProcess_GetReturnType() applies to the leaf call only.
+*/
+static void DaoProcess_CallLeafFunction( DaoProcess *self, DaoRoutine *func, DaoValue *P[], int N )
+{
+	DaoStackFrame *frame = self->topFrame;
+	DaoType *retype = frame->retype;
+	daoint m = self->factory->size;
+	daoint cur = self->stackReturn;
+
+	frame->retype = NULL;
+	self->stackReturn = -1;
+	func->pFunc( self, P, N );
+	if( self->stackReturn == -1 ) DaoProcess_PutDefaultReturn( self );
+	if( self->factory->size > m ) DList_Erase( self->factory, m, -1 );
+	self->stackReturn = cur;
+	GC_DecRC( frame->retype );
+	frame->retype = retype;
+}
+
 int DaoProcess_ExecuteCall( DaoProcess *self )
 {
 #ifdef DEBUG
@@ -1365,7 +1455,8 @@ CallEntry:
 			break;
 		default: break;
 		}
-		vmc ++;
+		/* The stream has become ready, call the method again: */
+		if( self->pauseType != DAO_PAUSE_STREAM_WAIT ) vmc ++;
 	}
 	topFrame->state |= DVM_FRAME_RUNNING;
 	self->status = DAO_PROCESS_RUNNING;
@@ -1936,14 +2027,7 @@ CallEntry:
 		}OPNEXT() OPCASE( ADD_SSS ){
 			vA = locVars[vmc->a];  vB = locVars[vmc->b];
 			vC = locVars[vmc->c];
-			if( vmc->a == vmc->c ){
-				DString_Append( vA->xString.value, vB->xString.value );
-			}else if( vmc->b == vmc->c ){
-				DString_Insert( vB->xString.value, vA->xString.value, 0, 0, 0 );
-			}else{
-				DString_Assign( vC->xString.value, vA->xString.value );
-				DString_Append( vC->xString.value, vB->xString.value );
-			}
+			DString_Add( vC->xString.value, vA->xString.value, vB->xString.value );
 		}OPNEXT() OPCASE( LT_BSS ){
 			vA = locVars[vmc->a];  vB = locVars[vmc->b];
 			LocalBool(vmc->c) = DString_CompareUTF8( vA->xString.value, vB->xString.value )<0;
@@ -3127,8 +3211,7 @@ void DaoProcess_MakeTuple( DaoProcess *self, DaoTuple *tuple, DaoValue *its[], i
 		DaoValue *val = its[i];
 		if( val->type == DAO_PAR_NAMED ){
 			DaoNameValue *nameva = & val->xNameValue;
-			DNode *node = MAP_Find( ct->mapNames, nameva->name );
-			if( node == NULL || node->value.pInt != i ){
+			if( DaoType_FindName( ct, nameva->name ) != i ){
 				DaoProcess_RaiseError( self, NULL, "name not matched" );
 				return;
 			}
@@ -3219,8 +3302,7 @@ void DaoProcess_DoTuple( DaoProcess *self, DaoVmCode *vmc )
 			if( i >0 ) DString_AppendChars( ct->name, "," );
 			if( tp->tid == DAO_PAR_NAMED ){
 				DaoNameValue *nameva = & val->xNameValue;
-				if( ct->mapNames == NULL ) ct->mapNames = DMap_New( DAO_DATA_STRING, 0 );
-				MAP_Insert( ct->mapNames, nameva->name, i );
+				DaoType_MapName( ct, nameva->name, i );
 				DString_Append( ct->name, nameva->name );
 				DString_AppendChars( ct->name, ":" );
 				DString_Append( ct->name, tp->aux->xType.name );
@@ -3568,6 +3650,23 @@ DaoValue* DaoProcess_DoReturn( DaoProcess *self, DaoVmCode *vmc )
 		int retnull = type == NULL || type->tid == DAO_NONE || type->tid == DAO_UDT;
 		if( retnull || cmdline || (opt1 && opt2) ) retValue = dao_none_value;
 	}
+	if( topFrame->retype && retValue && !(topFrame->routine->attribs & DAO_ROUT_INITOR) ){
+		/*
+		// Return type conversion for tail calls, see DaoProcess_TryTailCall().
+		// Convert to the return type of the current routine first, as it would
+		// be done by moving the value to the result register of the replaced
+		// caller, and then to the return type of that caller.
+		*/
+		DaoType *rettype = (DaoType*) topFrame->routine->routType->aux;
+		DaoValue *values[2] = { NULL, NULL };
+		int moved = DaoValue_Move( retValue, values, rettype );
+		moved = moved && DaoValue_Move( values[0], values + 1, topFrame->retype );
+		moved = moved && DaoValue_Move( values[1], dest, type );
+		GC_DecRC( values[0] );
+		GC_DecRC( values[1] );
+		if( moved == 0 ) goto InvalidReturn;
+		return retValue;
+	}
 	if( DaoValue_Move( retValue, dest, type ) == 0 ) goto InvalidReturn;
 	return retValue;
 InvalidReturn:
@@ -3736,20 +3835,37 @@ static int DaoProcess_InitBase( DaoProcess *self, DaoVmCode *vmc, DaoValue *call
 	}
 	return 0;
 }
+/*
+// Check if a call in tail position can reuse the current frame.
+//
+// A Dao routine called in tail position reuses the current frame in place
+// (see DaoProcess_ReuseFrame()). A leaf C function called in tail position
+// is called after the current frame is popped off, so that its result goes
+// directly to the caller of the current routine.
+//
+// If the called routine returns a type that is different from but safely
+// convertible to the return type of the current routine, the conversion is
+// recorded in DaoStackFrame::retype and done by DaoProcess_DoReturn().
+// Only one such conversion can be pending on a frame.
+*/
 static int DaoProcess_TryTailCall( DaoProcess *self, DaoRoutine *rout, DaoValue *O, DaoVmCode *vmc )
 {
-	int async = vmc->b & DAO_CALL_ASYNC;
+	DaoStackFrame *frame = self->topFrame;
+	DaoType *retype = (DaoType*) rout->routType->aux;
+	DaoType *curtype = (DaoType*) self->activeRoutine->routType->aux;
 	DaoObject *root = NULL;
+	int async = vmc->b & DAO_CALL_ASYNC;
+	int mt;
 
 	/*
-	// No tail call optimization for wrapped C/C++ functions.
-	// Because it is less useful and more inconvenient to setup properly.
+	// No tail call optimization for non-leaf C/C++ functions,
+	// they may run code sections or suspend the current frame:
 	*/
-	if( rout->pFunc != NULL ) return 0;
+	if( rout->pFunc != NULL && !(rout->attribs & DAO_ROUT_LEAF) ) return 0;
 
-	if( !(vmc->b & DAO_CALL_TAIL) || self->topFrame == self->startFrame ) return 0;
+	if( !(vmc->b & DAO_CALL_TAIL) || frame == self->startFrame ) return 0;
 	/* no tail call optimization when there is deferred code blocks: */
-	if( self->defers->size > self->topFrame->deferBase ) return 0;
+	if( self->defers->size > frame->deferBase ) return 0;
 
 	switch( O ? O->type : 0 ){
 	case DAO_CDATA :
@@ -3759,22 +3875,34 @@ static int DaoProcess_TryTailCall( DaoProcess *self, DaoRoutine *rout, DaoValue
 	case DAO_OBJECT  : root = O->xObject.rootObject; break;
 	}
 	/* No tail call optimization for possible asynchronous calls: */
+	if( async || (root && root->isAsync) || daoConfig.optimize == 0 ) return 0;
+
 	/* No tail call optimization in constructors etc.: */
-	/* (self->topFrame->state>>1): get rid of the DVM_FRAME_RUNNING flag: */
-	if( async == 0 && (self->topFrame->state>>1) == 0 && daoConfig.optimize ){
-		/* No optimization if the tail call has a return type different from the current: */
-		if( rout->routType->aux == self->activeRoutine->routType->aux ){
-			DaoProcess_PopFrame( self );
-			return 1;
-		}
+	/* (frame->state>>1): get rid of the DVM_FRAME_RUNNING flag: */
+	if( (frame->state>>1) != 0 || (self->activeRoutine->attribs & DAO_ROUT_INITOR) ) return 0;
+
+	if( retype == curtype ){
+		if( rout->pFunc && frame->retype != NULL ) return 0;
+		return 1;
 	}
-	return 0;
+
+	/* The return value of a C function can only be passed through: */
+	if( rout->pFunc || frame->retype != NULL ) return 0;
+	if( retype == NULL || curtype == NULL ) return 0;
+	if( (retype->attrib | curtype->attrib) & DAO_TYPE_SPEC ) return 0;
+
+	mt = DaoType_MatchTo( retype, curtype, NULL );
+	if( mt < DAO_MT_ANY || mt == DAO_MT_THT ) return 0;
+
+	GC_Assign( & frame->retype, curtype );
+	return 1;
 }
 static void DaoProcess_PrepareCall( DaoProcess *self, DaoRoutine *rout,
 		DaoValue *O, DaoValue *P[], DaoType *T[], int N, DaoVmCode *vmc, int noasync )
 {
 	DaoRoutine *rout2 = rout;
 	int need_self = rout->routType->attrib & DAO_TYPE_SELF;
+	int mode;
 	if( DaoProcess_CheckInvarMethod( self, rout ) == 0 ) return;
 	rout = DaoProcess_PassParams( self, rout, NULL, O, P, T, N, vmc->code );
 	if( rout == NULL ){
@@ -3793,8 +3921,9 @@ static void DaoProcess_PrepareCall( DaoProcess *self, DaoRoutine *rout,
 			return;
 		}
 	}
-	if( noasync == 0 ) DaoProcess_TryTailCall( self, rout, O, vmc );
-	DaoProcess_PushRoutineMode( self, rout, DaoValue_CastObject( O ), vmc->b & 0xff00 );
+	mode = vmc->b & 0xff00 & ~DAO_CALL_TAIL;
+	if( noasync == 0 && DaoProcess_TryTailCall( self, rout, O, vmc ) ) mode |= DAO_CALL_TAIL;
+	DaoProcess_PushRoutineMode( self, rout, DaoValue_CastObject( O ), mode );
 	if( noasync ) return;
 	DaoProcess_TryAsynCall( self, vmc );
 }
@@ -3817,6 +3946,15 @@ static void DaoProcess_DoNativeCall( DaoProcess *self, DaoVmCode *vmc,
 		DaoProcess_ShowCallError( self, rout, selfpar, P, N, callmode );
 		return;
 	}
+	if( (func->attribs & DAO_ROUT_LEAF) && !(vmc->b & DAO_CALL_ASYNC) ){
+		if( DaoProcess_NeedMigration( self, func ) == 0 ){
+			int tail = noasync == 0 && DaoProcess_TryTailCall( self, func, selfpar, vmc );
+			if( tail ) DaoProcess_PopFrame( self );
+			DaoProcess_CallLeafFunction( self, func, self->paramValues, self->parCount );
+			if( tail ) self->status = DAO_PROCESS_STACKED; /* Resume the caller; */
+			return;
+		}
+	}
 	DaoProcess_PushFunction( self, func );
 	if( noasync == 0 && DaoProcess_TryAsynCall( self, vmc ) ) return;
 #if 0
@@ -4082,7 +4220,6 @@ void DaoProcess_DoCall( DaoProcess *self, DaoVmCode *vmc )
 			GC_IncRC( params[i] );
 			parbuf[i] = params[i];
 		}
-		if( rout->pFunc == NULL ) DaoProcess_TryTailCall( self, rout, NULL, vmc );
 		if( rout->pFunc ){
 			DaoStackFrame *frame = DaoProcess_PushFrame( self, rout->parCount );
 			GC_Assign( & frame->routine, rout );
@@ -4097,7 +4234,12 @@ void DaoProcess_DoCall( DaoProcess *self, DaoVmCode *vmc )
 			DaoProcess_PopFrame( self );
 			if( status == DAO_PROCESS_SUSPENDED ) self->status = status;
 		}else{
-			DaoStackFrame *frame = DaoProcess_PushFrame( self, rout->body->regCount );
+			DaoStackFrame *frame = NULL;
+			if( DaoProcess_TryTailCall( self, rout, NULL, vmc ) ){
+				frame = DaoProcess_ReuseFrame( self, rout->body->regCount );
+			}else{
+				frame = DaoProcess_PushFrame( self, rout->body->regCount );
+			}
 			frame->active = frame;
 			self->status = DAO_PROCESS_STACKED;
 			DaoProcess_InitTopFrame( self, rout, NULL );
@@ -4584,7 +4726,6 @@ void DaoProcess_DoPacking( DaoProcess *self, DaoVmCode *vmc )
 	DaoValue **values = self->activeValues + opa + 1;
 	DaoValue *p = self->activeValues[opa];
 	DaoValue *selfobj = NULL;
-	DNode *node;
 
 	if( vmc->code == DVM_MPACK && p->type != DAO_ROUTINE ){
 		selfobj = values[0];
@@ -4613,12 +4754,12 @@ void DaoProcess_DoPacking( DaoProcess *self, DaoVmCode *vmc )
 				p = values[i];
 				if( p->type == DAO_PAR_NAMED ){
 					DaoNameValue *nameva = & p->xNameValue;
-					node = DMap_Find( klass->lookupTable, nameva->name );
-					if( node == NULL || LOOKUP_ST( node->value.pInt ) != DAO_OBJECT_VARIABLE ){
+					int index = DaoClass_GetDataIndex( klass, nameva->name );
+					if( index < 0 || LOOKUP_ST( index ) != DAO_OBJECT_VARIABLE ){
 						DaoProcess_RaiseError( self, "Field::NotExist", "" );
 						break;
 					}
-					k = LOOKUP_ID( node->value.pInt );
+					k = LOOKUP_ID( index );
 					p = nameva->value;
 				}
 				if( DaoValue_Move( p, object->objValues + k, mtype[k]->dtype ) ==0 ){
@@ -5389,45 +5530,73 @@ void* DaoProcess_SetAuxData( DaoProcess *self, void *key, void *value )
 
 
 
-void DaoProcess_FreeRegexCaches( DMap *regexCaches )
+/*
+// Per-process caches of private copies of the compiled patterns.
+//
+// The copies are obtained from the VM space wide cache, which compiles each
+// pattern only once for all the processes. When the current generation of
+// copies is full, it is retired and deleted when the next one is full,
+// so that the patterns returned by the last calls remain valid.
+*/
+typedef struct DaoRegexCopies DaoRegexCopies;
+struct DaoRegexCopies
+{
+	DMap  *current;
+	DMap  *retired;
+};
+
+static void DaoRegexCopies_Clear( DMap *copies )
 {
-	DNode *it = DMap_First( regexCaches );
-	for( ; it !=NULL; it = DMap_Next(regexCaches, it) ) dao_free( it->value.pVoid );
-	DMap_Delete( regexCaches );
+	DNode *it = DMap_First( copies );
+	for( ; it !=NULL; it = DMap_Next(copies, it) ) DaoRegex_Delete( (DaoRegex*) it->value.pVoid );
+	DMap_Reset( copies );
+}
+void DaoProcess_FreeRegexCaches( DaoRegexCopies *regexCaches )
+{
+	DaoRegexCopies_Clear( regexCaches->current );
+	DaoRegexCopies_Clear( regexCaches->retired );
+	DMap_Delete( regexCaches->current );
+	DMap_Delete( regexCaches->retired );
+	dao_free( regexCaches );
 }
 
 DaoRegex* DaoProcess_MakeRegex( DaoProcess *self, DString *src )
 {
-	DMap *regexCaches = NULL;
+	DaoRegexCopies *regexCaches = NULL;
 	DaoRegex *pat = NULL;
 	DNode *node;
+	DMap *swap;
 	char buf[50];
-	int i;
+	int error = 0;
 	DString_Trim( src, 1, 1, 0 );
 	if( src->size ==0 ){
 		if( self->activeRoutine )
 			DaoProcess_RaiseError( self, NULL, "pattern with empty string" );
 		return NULL;
 	}
-	regexCaches = (DMap*) DaoProcess_GetAuxData( self, DaoProcess_FreeRegexCaches );
+	regexCaches = (DaoRegexCopies*) DaoProcess_GetAuxData( self, DaoProcess_FreeRegexCaches );
 	if( regexCaches == NULL ){
-		regexCaches = DHash_New( DAO_DATA_STRING, 0 );
+		regexCaches = (DaoRegexCopies*) dao_malloc( sizeof(DaoRegexCopies) );
+		regexCaches->current = DHash_New( DAO_DATA_STRING, 0 );
+		regexCaches->retired = DHash_New( DAO_DATA_STRING, 0 );
 		DaoProcess_SetAuxData( self, DaoProcess_FreeRegexCaches, regexCaches );
 	}
-	node = DMap_Find( regexCaches, src );
+	node = DMap_Find( regexCaches->current, src );
 	if( node ) return (DaoRegex*) node->value.pVoid;
 
-	pat = DaoRegex_New( src );
-	for( i=0; i<pat->count; i++ ){
-		DaoRgxItem *it = pat->items + i;
-		if( it->type ==0 ){
-			sprintf( buf, "incorrect pattern, at char %i.", it->length );
-			if( self->activeRoutine ) DaoProcess_RaiseError( self, NULL, buf );
-			DaoRegex_Delete( pat );
-			return NULL;
-		}
+	pat = DaoRegexCache_Make( self->vmSpace->regexCache, src, & error );
+	if( pat == NULL ){
+		sprintf( buf, "incorrect pattern, at char %i.", error );
+		if( self->activeRoutine ) DaoProcess_RaiseError( self, NULL, buf );
+		return NULL;
+	}
+	if( regexCaches->current->size >= DAO_REGEX_CACHE ){
+		DaoRegexCopies_Clear( regexCaches->retired );
+		swap = regexCaches->retired;
+		regexCaches->retired = regexCaches->current;
+		regexCaches->current = swap;
 	}
-	DMap_Insert( regexCaches, src, pat );
+	DMap_Insert( regexCaches->current, src, pat );
 	return pat;
 }
 
@@ -34,6 +34,8 @@
 
 #include"daoRegex.h"
 #include"daoValue.h"
+#include"daoMap.h"
+#include"daoThread.h"
 
 #define ALIGN_LEN   sizeof(void*)
 #define ALIGN_MASK  (ALIGN_LEN-1)
@@ -64,7 +66,7 @@ enum DaoRegexConfig
 	PAT_CONFIG_CASEINS = 1,
 	PAT_CONFIG_MIN = 2
 };
-enum { PAT_ALL_FIXED = 1 };
+enum { PAT_ALL_FIXED = 1, PAT_LINEAR = 2, PAT_SKIPPING = 4, PAT_FACTOR = 8 };
 
 const char *names[] =
 { 
@@ -515,6 +517,9 @@ static const int sizepat = sizeof(DaoRegex);
 static const int sizeitm = sizeof(DaoRgxItem);
 static const int sizewch = sizeof(wchar_t);
 
+static int DaoRgxEngine_Count( DaoRegex *regex );
+static void DaoRegex_InitFilters( DaoRegex *self );
+
 static int InitRegex( DaoRegex *self, DString *ds )
 {
 	DaoRgxItem *patt;
@@ -560,11 +565,14 @@ static int InitRegex( DaoRegex *self, DString *ds )
 		self->group = max; /*  restrict capture exporting */
 	}
 	if( fixed ) self->attrib |= PAT_ALL_FIXED;
+	if( DaoRgxEngine_Count( self ) ) self->attrib |= PAT_LINEAR;
+	self->engine = NULL;
 	memmove( self->items + self->count, self->wordbuf, self->wordlen );
 	self->wordbuf = (char*)(self->items + self->count);
 	self->itemlen = self->count * sizeitm;
 	self->length = sizepat + self->itemlen + self->wordlen;
 	self->length = ALIGN( self->length );
+	DaoRegex_InitFilters( self );
 	return self->count;
 }
 
@@ -629,6 +637,8 @@ static int MatchSet( DaoRegex *self, DaoRgxItem *patt, daoint pos )
 				patt->type = chi2.value;
 				matched = (MatchOne( self, patt, pos ) !=0);
 				patt->type = PAT_SET;
+				patt->count -= 1; /* not a repetition; */
+				patt->offset = ch.width;
 				break;
 			case 't' : matched = (ch.value == '\t'); break;
 			case 'n' : matched = (ch.value == '\n'); break;
@@ -814,6 +824,67 @@ int dao_character( uint_t ch )
 	return (ch == '_' || iswalnum(ch) || dao_cjk(ch2));
 #endif
 }
+/*
+// Character classes of the ASCII chars, which are the same for all locales.
+// They are looked up directly, without decoding and calling isw*():
+*/
+enum DaoRgxClassBits
+{
+	RGX_ALPHA  = 1 ,
+	RGX_SPACE  = 2 ,
+	RGX_CNTRL  = 4 ,
+	RGX_PUNCT  = 8 ,
+	RGX_DIGIT  = 16 ,
+	RGX_XDIGIT = 32 ,
+	RGX_LOWER  = 64 ,
+	RGX_UPPER  = 128 ,
+	RGX_WORD   = 256   /* '_' or alphanumeric; */
+};
+static const unsigned short dao_ascii_classes[128] =
+{
+	0x004, 0x004, 0x004, 0x004, 0x004, 0x004, 0x004, 0x004,
+	0x004, 0x006, 0x006, 0x006, 0x006, 0x006, 0x004, 0x004,
+	0x004, 0x004, 0x004, 0x004, 0x004, 0x004, 0x004, 0x004,
+	0x004, 0x004, 0x004, 0x004, 0x004, 0x004, 0x004, 0x004,
+	0x002, 0x008, 0x008, 0x008, 0x008, 0x008, 0x008, 0x008,
+	0x008, 0x008, 0x008, 0x008, 0x008, 0x008, 0x008, 0x008,
+	0x130, 0x130, 0x130, 0x130, 0x130, 0x130, 0x130, 0x130,
+	0x130, 0x130, 0x008, 0x008, 0x008, 0x008, 0x008, 0x008,
+	0x008, 0x1a1, 0x1a1, 0x1a1, 0x1a1, 0x1a1, 0x1a1, 0x181,
+	0x181, 0x181, 0x181, 0x181, 0x181, 0x181, 0x181, 0x181,
+	0x181, 0x181, 0x181, 0x181, 0x181, 0x181, 0x181, 0x181,
+	0x181, 0x181, 0x181, 0x008, 0x008, 0x008, 0x008, 0x108,
+	0x008, 0x161, 0x161, 0x161, 0x161, 0x161, 0x161, 0x141,
+	0x141, 0x141, 0x141, 0x141, 0x141, 0x141, 0x141, 0x141,
+	0x141, 0x141, 0x141, 0x141, 0x141, 0x141, 0x141, 0x141,
+	0x141, 0x141, 0x141, 0x008, 0x008, 0x008, 0x008, 0x004
+};
+static int MatchASCII( int type, int ch )
+{
+	int bits = dao_ascii_classes[ch];
+	switch( type ){
+	case 'a' : return (bits & RGX_ALPHA) != 0;
+	case 's' : return (bits & RGX_SPACE) != 0;
+	case 'k' : return (bits & RGX_CNTRL) != 0;
+	case 'p' : return (bits & RGX_PUNCT) != 0;
+	case 'd' : return (bits & RGX_DIGIT) != 0;
+	case 'x' : return (bits & RGX_XDIGIT) != 0;
+	case 'w' : return (bits & RGX_WORD) != 0;
+	case 'c' : return (bits & RGX_LOWER) != 0;
+	case 'A' : return (bits & RGX_ALPHA) == 0;
+	case 'S' : return (bits & RGX_SPACE) == 0;
+	case 'K' : return (bits & RGX_CNTRL) == 0;
+	case 'P' : return (bits & RGX_PUNCT) == 0;
+	case 'D' : return (bits & RGX_DIGIT) == 0;
+	case 'X' : return (bits & RGX_XDIGIT) == 0;
+	case 'W' : return (bits & RGX_WORD) == 0;
+	case 'C' : return (bits & RGX_UPPER) != 0;
+	case 'e' : return 0;
+	case 'E' : return 1;
+	default : return 0;
+	}
+	return 0;
+}
 static int MatchOne( DaoRegex *self, DaoRgxItem *patt, daoint pos )
 {
 	DCharState st = { 0, 1, 0 };
@@ -853,6 +924,10 @@ static int MatchOne( DaoRegex *self, DaoRgxItem *patt, daoint pos )
 	default : break;
 	}
 	if( pos >= self->end ) return 0;
+	if( (uchar_t) self->source[pos] < 0x80 ){
+		patt->offset = 1;
+		return MatchASCII( patt->type, self->source[pos] );
+	}
 
 	st = DString_DecodeChar( self->source + pos, self->source + self->end );
 	if( st.type == 0 ) return 0;
@@ -908,6 +983,123 @@ static int MatchExpand( DaoRegex *self, DaoRgxItem *patt, daoint pos )
 	return 0;
 }
 
+/*
+// Filters for skipping the positions where no match can start:
+// the literal prefix, or the possible first bytes of the matches;
+// and a required literal for rejecting the subjects without it.
+// They are not used for patterns with ^, whose failure stops the search.
+*/
+static void DaoRegex_AddFirstByte( DaoRegex *self, int ch )
+{
+	self->firstset[ ch >> 5 ] |= 1U << (ch & 31);
+}
+/* Add the possible first bytes of the items from "i", return 1 if they can be empty: */
+static int DaoRegex_AddFirstBytes( DaoRegex *self, int i )
+{
+	DaoRgxItem *patt;
+	char ch, w;
+	int k, empty;
+
+	for(; i<self->count; ++i){
+		patt = self->items + i;
+		switch( patt->type ){
+		case PAT_BEGIN : case PAT_END : case PAT_WBORDER : continue;
+		case PAT_STOP : return 1;
+		case PAT_JOIN : i += patt->next - 1; continue;
+		case PAT_SPLIT :
+			for(k=i, empty=0; ; k+=self->items[k].jump){
+				empty |= DaoRegex_AddFirstBytes( self, k+1 );
+				if( self->items[k].jump == 0 ) break;
+			}
+			return empty;
+		case PAT_WORD :
+			w = self->wordbuf[ patt->word ];
+			for(k=0; k<256; ++k){
+				ch = (char) k;
+				if( patt->config & PAT_CONFIG_CASEINS ){
+					if( tolower( ch ) == w ) DaoRegex_AddFirstByte( self, k );
+				}else if( ch == w ){
+					DaoRegex_AddFirstByte( self, k );
+				}
+			}
+			break;
+		case PAT_START : case PAT_BACKREF : case PAT_PAIR : case PAT_PATPAIR : case PAT_NONE :
+			memset( self->firstset, 0xff, sizeof(self->firstset) );
+			return 1;
+		default : /* PAT_SET, PAT_ANY and character classes; */
+			for(k=0; k<256; ++k){
+				ch = (char) k;
+				self->source = & ch;
+				self->start = 0;
+				self->end = 1;
+				if( k >= 0x80 || MatchOne( self, patt, 0 ) ) DaoRegex_AddFirstByte( self, k );
+			}
+			break;
+		}
+		if( patt->min ) return 0;
+	}
+	return 1;
+}
+static void DaoRegex_InitFilters( DaoRegex *self )
+{
+	DaoRgxItem *patt;
+	int i, count = 0;
+
+	self->prefix = self->factor = self->firstlen = 0;
+	memset( self->firstset, 0, sizeof(self->firstset) );
+	for(i=0; i<self->count; ++i){
+		if( self->items[i].type == PAT_START ) return;
+	}
+	patt = self->items + 1;
+	if( patt->type == PAT_WORD && patt->min && (patt->config & PAT_CONFIG_CASEINS) == 0 ){
+		self->prefix = 1;
+	}
+	for(i=1; i<self->count-1; ++i){
+		patt = self->items + i;
+		if( patt->type == PAT_SPLIT || patt->type == PAT_PATPAIR ) break;
+		if( patt->type != PAT_WORD || patt->min == 0 ) continue;
+		if( patt->config & PAT_CONFIG_CASEINS ) continue;
+		if( self->factor == 0 || patt->length > self->items[self->factor].length ) self->factor = i;
+	}
+	DaoRegex_AddFirstBytes( self, 1 );
+	self->source = NULL;
+	self->start = self->end = 0;
+	for(i=0; i<256; ++i){
+		if( (self->firstset[i>>5] & (1U << (i&31))) == 0 ) continue;
+		if( count < 3 ) self->firsts[count] = (char) i;
+		count += 1;
+	}
+	if( count && count < 256 ) self->firstlen = count;
+	if( self->prefix || self->firstlen ) self->attrib |= PAT_SKIPPING;
+	if( self->factor ) self->attrib |= PAT_FACTOR;
+}
+/* Find the next position from "pos" where a match may start: */
+static daoint DaoRegex_NextStart( DaoRegex *self, daoint pos, daoint to )
+{
+	DString source = DString_WrapBytes( self->source, to );
+	const uchar_t *bytes = (const uchar_t*) self->source;
+
+	if( pos >= to ) return pos;
+	if( self->prefix ){
+		DaoRgxItem *patt = self->items + self->prefix;
+		DString word = DString_WrapBytes( self->wordbuf + patt->word, patt->length );
+		pos = DString_Find( & source, & word, pos );
+	}else if( self->firstlen <= 3 ){
+		pos = DString_FindCharSet( & source, self->firsts, self->firstlen, pos );
+	}else{
+		while( pos < to && (self->firstset[bytes[pos]>>5] & (1U << (bytes[pos]&31))) == 0 ) pos += 1;
+	}
+	return pos == DAO_NULLPOS ? to : pos;
+}
+/* Check if the required literal is in the range: */
+static int DaoRegex_HasFactor( DaoRegex *self, char *src, daoint from, daoint to )
+{
+	DaoRgxItem *patt = self->items + self->factor;
+	DString source = DString_WrapBytes( src + from, to - from );
+	DString word = DString_WrapBytes( self->wordbuf + patt->word, patt->length );
+	return DString_Find( & source, & word, 0 ) != DAO_NULLPOS;
+}
+
 static int DaoRegex_Search( DaoRegex *self, DaoRgxItem *patts, int npatt,
 		void *src, daoint size, daoint *start, daoint *end, int fixed )
 {
@@ -916,6 +1108,8 @@ static int DaoRegex_Search( DaoRegex *self, DaoRgxItem *patts, int npatt,
 	daoint pos, sum, max = 0, min = 0x7fffffff, from = 0, to = size;
 	daoint oldstart = self->start, oldend = self->end;
 	int bl, expand, matched, minmode = ((self->config & PAT_CONFIG_MIN) !=0);
+	int skipping = patts == NULL && (self->attrib & PAT_SKIPPING);
+	int factor = patts == NULL && (self->attrib & PAT_FACTOR);
 	if( patts == NULL ){
 		patts = self->items;
 		npatt = self->count;
@@ -931,10 +1125,12 @@ static int DaoRegex_Search( DaoRegex *self, DaoRgxItem *patts, int npatt,
 	if( start ) from = *start; else start = & s1;
 	if( end ) to = *end; else end = & s2;
 	if( to > size ) to = size;
+	if( factor && (from >= to || DaoRegex_HasFactor( self, src, from, to ) == 0) ) return 0;
 	self->source = src;
 	self->start = from;
 	self->end = to;
 	pos = from;
+	if( skipping ) pos = DaoRegex_NextStart( self, pos, to );
 	patt = patts;
 	patt->pos = 0;
 	patt->from = 0;
@@ -956,6 +1152,7 @@ static int DaoRegex_Search( DaoRegex *self, DaoRgxItem *patts, int npatt,
 			if( patt == patts ){
 				pos += 1;
 				if( fixed ) break;
+				if( skipping ) pos = DaoRegex_NextStart( self, pos, to );
 			}else{
 				pos = patt->pos;
 				patt2 = patt - patt->from;
@@ -1011,6 +1208,547 @@ static int DaoRegex_Search( DaoRegex *self, DaoRgxItem *patts, int npatt,
 	return matched;
 }
 
+
+/*
+// Linear time matching engine.
+//
+// Patterns with variable repetitions can take exponential (or high order
+// polynomial) time to match by backtracking. If such patterns have no
+// capturing groups, back references and balanced pairs (%b and %B), they
+// are matched by simulating an equivalent NFA over the bytes of the subject,
+// in time linear to the length of the subject.
+//
+// The backtracker selects the longest (or the shortest for <min>) non-empty
+// match at the leftmost position. To find the same match, the NFA states
+// are grouped by the starting positions of the matches they represent, and
+// the groups are ordered by the positions. A state reached from more than
+// one starting position is kept only in the group of the leftmost one,
+// which always takes precedence.
+//
+// The ordered groups of NFA states are interned as DFA states. Transitions
+// on ASCII bytes are cached in the DFA states, so most bytes are handled by
+// looking up the cached transitions. Transitions on other bytes depend on
+// the decoded characters, and are computed each time. So are the transitions
+// for patterns with word borders, which depend on the context.
+*/
+
+#define DAO_RGX_NODES   2048  /* maximum number of NFA nodes; */
+#define DAO_RGX_STATES  128   /* maximum number of cached DFA states; */
+
+enum DaoRgxNodeType
+{
+	RGX_SPLIT ,    /* epsilon transitions to "out" and "out2" (if not negative); */
+	RGX_BYTE ,     /* matching one byte of a word; */
+	RGX_CHAR ,     /* matching one character by the pattern item; */
+	RGX_SKIP ,     /* skipping one byte of a multi-byte character; */
+	RGX_END ,      /* end of the subject; */
+	RGX_WBORDER ,  /* word border; */
+	RGX_MATCH
+};
+
+typedef struct DaoRgxNode   DaoRgxNode;
+typedef struct DaoRgxState  DaoRgxState;
+
+struct DaoRgxNode
+{
+	uchar_t  type;
+	uchar_t  caseins;
+	uchar_t  byte;  /* in lowercase for case-insensitive matching; */
+	short    item;  /* pattern item for RGX_CHAR and RGX_WBORDER; */
+	short    out;
+	short    out2;  /* for RGX_CHAR: the skip node for the last byte; */
+};
+
+/*
+// The data of a DFA state is: nostart, count, and for each group: size, nodes.
+// "nostart" indicates that no more groups will be started, because a match
+// has been found.
+*/
+struct DaoRgxState
+{
+	DaoRgxState  *next[128];  /* cached transitions on ASCII bytes; */
+	short        *maps[128];  /* indices of the source groups of the transitions; */
+	uchar_t      *matches;    /* for each group: 1, matching; 2, matching at the end; */
+	short        *data;
+	short         count;
+	uchar_t       nostart;
+	uchar_t       matching;
+};
+
+struct DaoRgxEngine
+{
+	DaoRgxNode  *nodes;
+	short        count;
+	short        entry;
+	uchar_t      anchored;
+	uchar_t      caching;
+	int          mark;
+	int         *marks;
+	short       *stack;
+	short       *buffer;  /* for the data of new DFA states; */
+	short       *map;     /* for the uncached transitions; */
+	int          size;    /* number of the used buffer items; */
+	int          flushes;
+	daoint      *starts;  /* starting positions of the groups; */
+	daoint      *starts2;
+	DMap        *states;
+};
+
+/* Count the nodes of the NFA, return zero if the pattern is not supported: */
+static int DaoRgxEngine_Count( DaoRegex *regex )
+{
+	DaoRgxItem *patt;
+	int i, unit, count = 1;
+
+	if( regex->attrib & PAT_ALL_FIXED ) return 0;
+	for(i=1; i<regex->count-1; ++i){
+		patt = regex->items + i;
+		switch( patt->type ){
+		case PAT_SPLIT :
+			if( patt->gid ) return 0;
+			count += 1;
+			continue;
+		case PAT_JOIN :
+			if( patt->gid ) return 0;
+			continue;
+		case PAT_START :
+			if( i != 1 || patt->min != 1 || patt->max != 1 ) return 0;
+			continue;
+		case PAT_END :
+		case PAT_WBORDER :
+			if( patt->min != 1 || patt->max != 1 ) return 0;
+			count += 1;
+			continue;
+		case PAT_WORD : unit = patt->length; break;
+		case PAT_SET :
+		case PAT_ANY : unit = 4; break;
+		default :
+			if( patt->type <= PAT_ANY ) return 0;
+			unit = 4;
+			break;
+		}
+		if( patt->max < 0 ){
+			count += (patt->min + 1) * unit + 1;
+		}else{
+			count += patt->min * unit + (patt->max - patt->min) * (unit + 1);
+		}
+		if( count > DAO_RGX_NODES ) return 0;
+	}
+	return count;
+}
+
+static int DaoRgxEngine_AddNode( DaoRgxEngine *self, int type, int out )
+{
+	DaoRgxNode *node = self->nodes + self->count;
+	memset( node, 0, sizeof(DaoRgxNode) );
+	node->type = type;
+	node->out = out;
+	node->out2 = -1;
+	return self->count ++;
+}
+/*
+// Add nodes for one repetition of the pattern item, leading to "next".
+// A character is matched by RGX_CHAR at its first byte, and the rest of its
+// bytes are skipped by up to three RGX_SKIP nodes.
+*/
+static int DaoRgxEngine_AddUnit( DaoRgxEngine *self, DaoRegex *regex, int item, int next )
+{
+	DaoRgxItem *patt = regex->items + item;
+	int i, skip;
+
+	if( patt->type == PAT_WORD ){
+		char *w = regex->wordbuf + patt->word;
+		for(i=patt->length-1; i>=0; --i){
+			next = DaoRgxEngine_AddNode( self, RGX_BYTE, next );
+			self->nodes[next].byte = w[i];
+			self->nodes[next].caseins = (patt->config & PAT_CONFIG_CASEINS) != 0;
+		}
+		return next;
+	}
+	skip = DaoRgxEngine_AddNode( self, RGX_SKIP, next );
+	DaoRgxEngine_AddNode( self, RGX_SKIP, skip );
+	DaoRgxEngine_AddNode( self, RGX_SKIP, skip + 1 );
+	next = DaoRgxEngine_AddNode( self, RGX_CHAR, next );
+	self->nodes[next].item = item;
+	self->nodes[next].out2 = skip;
+	return next;
+}
+static int DaoRgxEngine_AddItem( DaoRgxEngine *self, DaoRegex *regex, int item, int next )
+{
+	DaoRgxItem *patt = regex->items + item;
+	int i, split, exit = next;
+
+	switch( patt->type ){
+	case PAT_START : return next;
+	case PAT_END : return DaoRgxEngine_AddNode( self, RGX_END, next );
+	case PAT_WBORDER :
+		next = DaoRgxEngine_AddNode( self, RGX_WBORDER, next );
+		self->nodes[next].item = item;
+		return next;
+	default : break;
+	}
+	if( patt->max < 0 ){
+		next = DaoRgxEngine_AddNode( self, RGX_SPLIT, exit );
+		split = DaoRgxEngine_AddUnit( self, regex, item, next );
+		self->nodes[next].out2 = split;
+	}else{
+		for(i=patt->min; i<patt->max; ++i){
+			split = DaoRgxEngine_AddUnit( self, regex, item, next );
+			next = DaoRgxEngine_AddNode( self, RGX_SPLIT, exit );
+			self->nodes[next].out2 = split;
+		}
+	}
+	for(i=0; i<patt->min; ++i) next = DaoRgxEngine_AddUnit( self, regex, item, next );
+	return next;
+}
+/* Add nodes for the items in [start,end), or the alternatives from PAT_SPLIT: */
+static int DaoRgxEngine_AddItems( DaoRgxEngine *self, DaoRegex *regex, int start, int end, int next )
+{
+	DaoRgxItem *patt = regex->items + start;
+	int i, first, rest;
+
+	if( patt->type == PAT_SPLIT ){
+		i = patt->jump ? start + patt->jump : end;
+		first = DaoRgxEngine_AddItems( self, regex, start + 1, i - 1, next );
+		if( patt->jump == 0 ) return first;
+		rest = DaoRgxEngine_AddItems( self, regex, i, end, next );
+		i = DaoRgxEngine_AddNode( self, RGX_SPLIT, first );
+		self->nodes[i].out2 = rest;
+		return i;
+	}
+	for(i=end-1; i>=start; --i) next = DaoRgxEngine_AddItem( self, regex, i, next );
+	return next;
+}
+
+static DaoRgxEngine* DaoRgxEngine_New( DaoRegex *regex )
+{
+	DaoRgxEngine *self = (DaoRgxEngine*) dao_calloc( 1, sizeof(DaoRgxEngine) );
+	int i, count = DaoRgxEngine_Count( regex );
+
+	self->nodes = (DaoRgxNode*) dao_malloc( count * sizeof(DaoRgxNode) );
+	self->marks = (int*) dao_calloc( count, sizeof(int) );
+	self->stack = (short*) dao_malloc( count * sizeof(short) );
+	self->buffer = (short*) dao_malloc( (2*count + 4) * sizeof(short) );
+	self->map = (short*) dao_malloc( (count + 1) * sizeof(short) );
+	self->starts = (daoint*) dao_malloc( (count + 1) * sizeof(daoint) );
+	self->starts2 = (daoint*) dao_malloc( (count + 1) * sizeof(daoint) );
+	self->states = DHash_New( DAO_DATA_STRING, 0 );
+	self->anchored = regex->items[1].type == PAT_START;
+	self->caching = 1;
+	for(i=1; i<regex->count-1; ++i){
+		if( regex->items[i].type == PAT_WBORDER ) self->caching = 0;
+	}
+	i = DaoRgxEngine_AddNode( self, RGX_MATCH, -1 );
+	self->entry = DaoRgxEngine_AddItems( self, regex, 1, regex->count - 1, i );
+	return self;
+}
+static void DaoRgxEngine_Flush( DaoRgxEngine *self )
+{
+	DNode *it = DMap_First( self->states );
+	int i;
+	for( ; it != NULL; it = DMap_Next( self->states, it ) ){
+		DaoRgxState *state = (DaoRgxState*) it->value.pVoid;
+		for(i=0; i<128; ++i) if( state->maps[i] ) dao_free( state->maps[i] );
+		dao_free( state );
+	}
+	DMap_Reset( self->states );
+	self->flushes += 1;
+}
+static void DaoRgxEngine_Delete( DaoRgxEngine *self )
+{
+	DaoRgxEngine_Flush( self );
+	DMap_Delete( self->states );
+	dao_free( self->nodes );
+	dao_free( self->marks );
+	dao_free( self->stack );
+	dao_free( self->buffer );
+	dao_free( self->map );
+	dao_free( self->starts );
+	dao_free( self->starts2 );
+	dao_free( self );
+}
+static void DaoRgxEngine_NewMark( DaoRgxEngine *self )
+{
+	if( self->mark == 0x7fffffff ){
+		memset( self->marks, 0, self->count * sizeof(int) );
+		self->mark = 0;
+	}
+	self->mark += 1;
+}
+
+#define DaoRgxEngine_Push( self, top, id ) \
+	if( (id) >= 0 && self->marks[id] != self->mark ){ \
+		self->marks[id] = self->mark; \
+		self->stack[top++] = id; \
+	}
+
+/* Append the unmarked nodes of the epsilon closure of node "id" to the buffer: */
+static void DaoRgxEngine_Closure( DaoRgxEngine *self, DaoRegex *regex, int id, daoint pos )
+{
+	DaoRgxNode *node;
+	int top = 0;
+
+	DaoRgxEngine_Push( self, top, id );
+	while( top ){
+		id = self->stack[--top];
+		node = self->nodes + id;
+		switch( node->type ){
+		case RGX_SPLIT :
+			DaoRgxEngine_Push( self, top, node->out2 );
+			DaoRgxEngine_Push( self, top, node->out );
+			break;
+		case RGX_WBORDER :
+			if( MatchOne( regex, regex->items + node->item, pos ) ){
+				DaoRgxEngine_Push( self, top, node->out );
+			}
+			break;
+		default :
+			self->buffer[ self->size ++ ] = id;
+			break;
+		}
+	}
+}
+/* Check if the nodes can reach RGX_MATCH at the end of the subject: */
+static int DaoRgxEngine_MatchEnd( DaoRgxEngine *self, short *nodes, int count )
+{
+	DaoRgxNode *node;
+	int i, top = 0;
+
+	DaoRgxEngine_NewMark( self );
+	for(i=0; i<count; ++i){
+		node = self->nodes + nodes[i];
+		if( node->type == RGX_MATCH ) return 1;
+		if( node->type == RGX_END ) DaoRgxEngine_Push( self, top, node->out );
+	}
+	while( top ){
+		node = self->nodes + self->stack[--top];
+		switch( node->type ){
+		case RGX_SPLIT :
+			DaoRgxEngine_Push( self, top, node->out2 );
+			DaoRgxEngine_Push( self, top, node->out );
+			break;
+		case RGX_END :
+		case RGX_WBORDER :
+			DaoRgxEngine_Push( self, top, node->out );
+			break;
+		case RGX_MATCH : return 1;
+		default : break;
+		}
+	}
+	return 0;
+}
+/* Get the DFA state for the data in the buffer: */
+static DaoRgxState* DaoRgxEngine_Intern( DaoRgxEngine *self )
+{
+	DString key = DString_WrapBytes( (char*) self->buffer, self->size * sizeof(short) );
+	DNode *it = DMap_Find( self->states, & key );
+	DaoRgxState *state;
+	short *data;
+	int i, j, count;
+
+	if( it ) return (DaoRgxState*) it->value.pVoid;
+	if( self->states->size >= DAO_RGX_STATES ) DaoRgxEngine_Flush( self );
+
+	count = self->buffer[1];
+	i = sizeof(DaoRgxState) + self->size * sizeof(short) + count;
+	state = (DaoRgxState*) dao_calloc( 1, i );
+	state->data = (short*) (state + 1);
+	state->matches = (uchar_t*) (state->data + self->size);
+	state->count = count;
+	state->nostart = self->buffer[0];
+	memcpy( state->data, self->buffer, self->size * sizeof(short) );
+	data = state->data + 2;
+	for(i=0; i<count; ++i){
+		int size = *data++;
+		for(j=0; j<size; ++j){
+			if( self->nodes[data[j]].type == RGX_MATCH ) state->matches[i] = 3;
+		}
+		if( state->matches[i] == 0 && DaoRgxEngine_MatchEnd( self, data, size ) ){
+			state->matches[i] = 2;
+		}
+		state->matching |= state->matches[i];
+		data += size;
+	}
+	key = DString_WrapBytes( (char*) state->data, self->size * sizeof(short) );
+	DMap_Insert( self->states, & key, state );
+	return state;
+}
+static int DaoRgxEngine_CompareNodes( const void *p1, const void *p2 )
+{
+	return *(short*)p1 - *(short*)p2;
+}
+/* Close the group starting at "offset" in the buffer, return its size: */
+static int DaoRgxEngine_CloseGroup( DaoRgxEngine *self, int offset )
+{
+	int size = self->size - offset - 1;
+	if( size == 0 ){
+		self->size = offset;
+		return 0;
+	}
+	qsort( self->buffer + offset + 1, size, sizeof(short), DaoRgxEngine_CompareNodes );
+	self->buffer[offset] = size;
+	return size;
+}
+static DaoRgxState* DaoRgxEngine_Start( DaoRgxEngine *self, DaoRegex *regex, daoint pos )
+{
+	DaoRgxEngine_NewMark( self );
+	self->buffer[0] = 0;
+	self->buffer[1] = 1;
+	self->size = 3;
+	DaoRgxEngine_Closure( self, regex, self->entry, pos );
+	if( DaoRgxEngine_CloseGroup( self, 2 ) == 0 ) self->buffer[1] = 0;
+	return DaoRgxEngine_Intern( self );
+}
+/* Get the state with the first "count" groups, and without new groups: */
+static DaoRgxState* DaoRgxEngine_Cut( DaoRgxEngine *self, DaoRgxState *state, int count )
+{
+	short *data = state->data + 2;
+	int i;
+	for(i=0; i<count; ++i) data += *data + 1;
+	self->size = data - state->data;
+	memcpy( self->buffer, state->data, self->size * sizeof(short) );
+	self->buffer[0] = 1;
+	self->buffer[1] = count;
+	return DaoRgxEngine_Intern( self );
+}
+/* Compute the transition on the byte at "pos", and the map of the groups: */
+static DaoRgxState* DaoRgxEngine_Step( DaoRgxEngine *self, DaoRegex *regex,
+		DaoRgxState *state, daoint pos, short *map )
+{
+	DaoRgxNode *node;
+	DaoRgxItem *patt;
+	short *data = state->data + 2;
+	char ch = regex->source[pos];
+	int i, g, offset, count = 0;
+
+	DaoRgxEngine_NewMark( self );
+	self->size = 2;
+	for(g=0; g<state->count; ++g){
+		int size = *data++;
+		offset = self->size ++;
+		for(i=0; i<size; ++i){
+			node = self->nodes + data[i];
+			switch( node->type ){
+			case RGX_BYTE :
+				if( node->caseins ? tolower( ch ) != (char) node->byte : ch != (char) node->byte ) break;
+				DaoRgxEngine_Closure( self, regex, node->out, pos + 1 );
+				break;
+			case RGX_CHAR :
+				patt = regex->items + node->item;
+				if( MatchOne( regex, patt, pos ) == 0 ) break;
+				if( patt->offset <= 1 ){
+					DaoRgxEngine_Closure( self, regex, node->out, pos + 1 );
+				}else{
+					DaoRgxEngine_Closure( self, regex, node->out2 + patt->offset - 2, pos + 1 );
+				}
+				break;
+			case RGX_SKIP :
+				DaoRgxEngine_Closure( self, regex, node->out, pos + 1 );
+				break;
+			default : break;
+			}
+		}
+		data += size;
+		if( DaoRgxEngine_CloseGroup( self, offset ) ) map[count++] = g;
+	}
+	if( state->nostart == 0 && self->anchored == 0 ){
+		offset = self->size ++;
+		DaoRgxEngine_Closure( self, regex, self->entry, pos + 1 );
+		if( DaoRgxEngine_CloseGroup( self, offset ) ) map[count++] = -1;
+	}
+	self->buffer[0] = state->nostart;
+	self->buffer[1] = count;
+	return DaoRgxEngine_Intern( self );
+}
+
+static int DaoRegex_SearchLinear( DaoRegex *self, char *src, daoint size, daoint *start, daoint *end )
+{
+	DaoRgxEngine *engine;
+	DaoRgxState *state, *next;
+	daoint pos, from = 0, to = size, first = -1, last = -1;
+	daoint oldstart = self->start, oldend = self->end;
+	daoint *starts, *starts2, *swap;
+	int g, minmode = ((self->config & PAT_CONFIG_MIN) !=0);
+	short *map;
+
+	if( size == 0 ) return 0;
+	if( start && *start >= size ) return 0;
+	if( start ) from = *start;
+	if( end ) to = *end;
+	if( to > size ) to = size;
+	if( from >= to ) return 0;
+	if( (self->attrib & PAT_FACTOR) && DaoRegex_HasFactor( self, src, from, to ) == 0 ) return 0;
+	if( self->engine == NULL ) self->engine = DaoRgxEngine_New( self );
+	engine = self->engine;
+	starts = engine->starts;
+	starts2 = engine->starts2;
+	self->source = src;
+	self->start = from;
+	self->end = to;
+	pos = from;
+	if( self->attrib & PAT_SKIPPING ) pos = DaoRegex_NextStart( self, pos, to );
+	state = DaoRgxEngine_Start( engine, self, pos );
+	starts[0] = pos;
+	for(; ; ++pos){
+		if( state->matching & (pos == to ? 3 : 1) ){
+			int mask = pos == to ? 3 : 1;
+			for(g=0; g<state->count; ++g){
+				if( (state->matches[g] & mask) && starts[g] < pos ) break;
+			}
+			if( g < state->count ){
+				if( first < 0 || starts[g] < first || minmode == 0 ){
+					first = starts[g];
+					last = pos;
+				}
+				g += minmode == 0;
+				if( g < state->count || state->nostart == 0 ){
+					state = DaoRgxEngine_Cut( engine, state, g );
+				}
+			}
+		}
+		if( pos >= to ) break;
+		if( state->count == 0 && (state->nostart || engine->anchored) ) break;
+		g = (uchar_t) src[pos];
+		next = g < 128 ? state->next[g] : NULL;
+		if( next != NULL ){
+			map = state->maps[g];
+		}else{
+			int flushes = engine->flushes;
+			map = engine->map;
+			next = DaoRgxEngine_Step( engine, self, state, pos, map );
+			if( g < 128 && engine->caching && engine->flushes == flushes ){
+				state->next[g] = next;
+				if( next->count ){
+					state->maps[g] = (short*) dao_malloc( next->count * sizeof(short) );
+					memcpy( state->maps[g], map, next->count * sizeof(short) );
+				}
+			}
+		}
+		if( next->count == 1 && map[0] < 0 && (self->attrib & PAT_SKIPPING) ){
+			/* Only the group started after this byte is left: */
+			daoint skip = DaoRegex_NextStart( self, pos + 1, to );
+			if( skip > pos + 1 ){
+				state = DaoRgxEngine_Start( engine, self, skip );
+				starts[0] = skip;
+				pos = skip - 1;
+				continue;
+			}
+		}
+		for(g=0; g<next->count; ++g) starts2[g] = map[g] < 0 ? pos + 1 : starts[map[g]];
+		swap = starts;  starts = starts2;  starts2 = swap;
+		state = next;
+	}
+	self->start = oldstart;
+	self->end = oldend;
+	if( first < 0 ) return 0;
+	if( start ) *start = first;
+	if( end ) *end = last;
+	self->items[0].posave = first;
+	self->items[self->count-1].posave = last;
+	self->items[self->count-1].fromsave = 0;
+	return 1;
+}
+
 int DaoRegex_CheckSize( DString *src )
 {
 	int n = src->size;
@@ -1049,7 +1787,7 @@ int DString_Match( DString *self, const char *pat, daoint *start, daoint *end )
 	DaoRegex_Init( regex, str );
 	DString_Delete( str );
 	rc = DaoRegex_Match( regex, self, start, end );
-	dao_free( regex );
+	DaoRegex_Delete( regex );
 	return rc;
 }
 
@@ -1066,7 +1804,7 @@ int DString_Change( DString *self, const char *pat, const char *target, int inde
 	DString_Delete( str );
 	rc = DaoRegex_Change( regex, self, tg, index );
 	DString_Delete( tg );
-	dao_free( regex );
+	DaoRegex_Delete( regex );
 	return rc;
 }
 DaoRegex* DaoRegex_New( DString *src )
@@ -1083,12 +1821,32 @@ void DaoRegex_Copy( DaoRegex *self, DaoRegex *src )
 	memcpy( self, src, src->length );
 	self->items = (DaoRgxItem*)(((char*)self) + sizepat);
 	self->wordbuf = ((char*)self) + sizepat + self->itemlen;
+	self->engine = NULL;
+}
+DaoRegex* DaoRegex_Clone( DaoRegex *self )
+{
+	DaoRegex *copy = (DaoRegex*) dao_malloc( self->length );
+	DaoRegex_Copy( copy, self );
+	return copy;
+}
+void DaoRegex_Delete( DaoRegex *self )
+{
+	if( self->engine ) DaoRgxEngine_Delete( self->engine );
+	dao_free( self );
 }
 int DaoRegex_Match( DaoRegex *self, DString *src, daoint *start, daoint *end )
 {
+	if( self->attrib & PAT_LINEAR ){
+		return DaoRegex_SearchLinear( self, src->chars, src->size, start, end );
+	}
 	return DaoRegex_Search( self, 0,0, src->chars, src->size, start, end, 0 );
 }
 
+int DaoRegex_IsAnchored( DaoRegex *self )
+{
+	return self->count > 1 && self->items[1].type == PAT_START;
+}
+
 int DaoRegex_SubMatch( DaoRegex *self, int gid, daoint *start, daoint *end )
 {
 	DaoRgxItem *p = self->items + self->count-1;
@@ -1201,3 +1959,145 @@ int DaoRegex_Change( DaoRegex *self, DString *source, DString *target, int index
 	DString_Delete( input );
 	return count;
 }
+
+
+
+typedef struct DaoRegexEntry  DaoRegexEntry;
+
+struct DaoRegexEntry
+{
+	DaoRegex       *regex;
+	DString        *source;  /* key of the entry in the cache map; */
+	DaoRegexEntry  *prev;    /* the more recently used one; */
+	DaoRegexEntry  *next;    /* the less recently used one; */
+	int             pinned;
+};
+
+struct DaoRegexCache
+{
+	DMap           *entries;  /* <DString*,DaoRegexEntry*>; */
+	DaoRegexEntry  *first;    /* the most recently used unpinned entry; */
+	DaoRegexEntry  *last;     /* the least recently used unpinned entry; */
+	daoint          count;    /* number of unpinned entries; */
+	daoint          limit;
+#ifdef DAO_WITH_THREAD
+	DMutex          mutex;
+#endif
+};
+
+DaoRegexCache* DaoRegexCache_New( int limit )
+{
+	DaoRegexCache *self = (DaoRegexCache*) dao_calloc( 1, sizeof(DaoRegexCache) );
+	self->entries = DHash_New( DAO_DATA_STRING, 0 );
+	self->limit = limit;
+#ifdef DAO_WITH_THREAD
+	DMutex_Init( & self->mutex );
+#endif
+	return self;
+}
+void DaoRegexCache_Delete( DaoRegexCache *self )
+{
+	DNode *it;
+	for(it=DMap_First(self->entries); it; it=DMap_Next(self->entries,it)){
+		DaoRegexEntry *entry = (DaoRegexEntry*) it->value.pVoid;
+		DaoRegex_Delete( entry->regex );
+		dao_free( entry );
+	}
+	DMap_Delete( self->entries );
+#ifdef DAO_WITH_THREAD
+	DMutex_Destroy( & self->mutex );
+#endif
+	dao_free( self );
+}
+static void DaoRegexCache_Unlink( DaoRegexCache *self, DaoRegexEntry *entry )
+{
+	if( entry->prev ) entry->prev->next = entry->next;
+	if( entry->next ) entry->next->prev = entry->prev;
+	if( self->first == entry ) self->first = entry->next;
+	if( self->last == entry ) self->last = entry->prev;
+	entry->prev = entry->next = NULL;
+	self->count -= 1;
+}
+static void DaoRegexCache_LinkFirst( DaoRegexCache *self, DaoRegexEntry *entry )
+{
+	entry->next = self->first;
+	if( self->first ) self->first->prev = entry;
+	self->first = entry;
+	if( self->last == NULL ) self->last = entry;
+	self->count += 1;
+}
+/*
+// Return the cached entry or compile and add a new one,
+// return NULL if the pattern is invalid:
+*/
+static DaoRegexEntry* DaoRegexCache_Find( DaoRegexCache *self, DString *src, int *error )
+{
+	DaoRegexEntry *entry;
+	DaoRegex *regex;
+	DNode *node;
+	int i;
+
+	node = DMap_Find( self->entries, src );
+	if( node ){
+		entry = (DaoRegexEntry*) node->value.pVoid;
+		if( entry->pinned == 0 && self->first != entry ){
+			DaoRegexCache_Unlink( self, entry );
+			DaoRegexCache_LinkFirst( self, entry );
+		}
+		return entry;
+	}
+
+	regex = DaoRegex_New( src );
+	for(i=0; i<regex->count; i++){
+		if( regex->items[i].type == 0 ){
+			if( error ) *error = regex->items[i].length;
+			DaoRegex_Delete( regex );
+			return NULL;
+		}
+	}
+	while( self->count >= self->limit && self->last ){
+		DaoRegexEntry *old = self->last;
+		DaoRegexCache_Unlink( self, old );
+		DMap_Erase( self->entries, old->source );
+		DaoRegex_Delete( old->regex );
+		dao_free( old );
+	}
+	entry = (DaoRegexEntry*) dao_calloc( 1, sizeof(DaoRegexEntry) );
+	entry->regex = regex;
+	node = DMap_Insert( self->entries, src, entry );
+	entry->source = node->key.pString;
+	DaoRegexCache_LinkFirst( self, entry );
+	return entry;
+}
+DaoRegex* DaoRegexCache_Make( DaoRegexCache *self, DString *src, int *error )
+{
+	DaoRegexEntry *entry;
+	DaoRegex *regex = NULL;
+
+#ifdef DAO_WITH_THREAD
+	DMutex_Lock( & self->mutex );
+#endif
+	entry = DaoRegexCache_Find( self, src, error );
+	if( entry ) regex = DaoRegex_Clone( entry->regex );
+#ifdef DAO_WITH_THREAD
+	DMutex_Unlock( & self->mutex );
+#endif
+	return regex;
+}
+int DaoRegexCache_Pin( DaoRegexCache *self, DString *src )
+{
+	DaoRegexEntry *entry;
+
+#ifdef DAO_WITH_THREAD
+	DMutex_Lock( & self->mutex );
+#endif
+	entry = DaoRegexCache_Find( self, src, NULL );
+	if( entry && entry->pinned == 0 ){
+		DaoRegexCache_Unlink( self, entry );
+		entry->pinned = 1;
+	}
+#ifdef DAO_WITH_THREAD
+	DMutex_Unlock( & self->mutex );
+#endif
+	return entry != NULL;
+}
@@ -32,6 +32,7 @@
 #include"daoType.h"
 
 typedef struct DaoRgxItem DaoRgxItem;
+typedef struct DaoRgxEngine DaoRgxEngine;
 
 struct DaoRgxItem
 {
@@ -67,11 +68,19 @@ struct DaoRegex
 	int    itemlen; /* in bytes */
 	int    wordlen; /* in bytes */
 	int    length;
+	short  prefix;      /* item of the literal prefix; */
+	short  factor;      /* item of the longest required literal; */
+	short  firstlen;    /* number of the possible first bytes of the matches; */
+	char   firsts[4];   /* the possible first bytes, if there are at most three; */
+	uint_t firstset[8]; /* bit set of the possible first bytes; */
+
+	DaoRgxEngine  *engine; /* linear time matching engine, built on demand; */
 };
 
 DAO_DLL DaoRegex* DaoRegex_New( DString *src );
-#define DaoRegex_Delete( self ) dao_free( self )
+DAO_DLL void DaoRegex_Delete( DaoRegex *self );
 DAO_DLL void DaoRegex_Copy( DaoRegex *self, DaoRegex *src );
+DAO_DLL DaoRegex* DaoRegex_Clone( DaoRegex *self );
 
 /* compute the number of bytes needed for storing the compiled pattern */
 DAO_DLL int DaoRegex_CheckSize( DString *src );
@@ -79,8 +88,38 @@ DAO_DLL int DaoRegex_CheckSize( DString *src );
 DAO_DLL int DaoRegex_Match( DaoRegex *self, DString *src, daoint *start, daoint *end );
 DAO_DLL int DaoRegex_SubMatch( DaoRegex *self, int gid, daoint *start, daoint *end );
 
+/* check if the pattern can only match at the search start: "^..." */
+DAO_DLL int DaoRegex_IsAnchored( DaoRegex *self );
+
 DAO_DLL int DaoRegex_Change( DaoRegex *self, DString *src, DString *target, int index );
 DAO_DLL int DaoRegex_ChangeExt( DaoRegex *self, DString *input, DString *output,
 		DString *target, int index, daoint *start2, daoint *end2 );
 
+
+
+/*
+// VM space wide cache of compiled patterns.
+//
+// Compiled patterns keep matching states, so they are not shared directly;
+// DaoRegexCache_Make() returns a private copy that is owned by the caller.
+// The cached patterns are evicted in least-recently-used order when their
+// number exceeds the limit, except the pinned ones, which are precompiled
+// from constant patterns at compiling time.
+*/
+#define DAO_REGEX_CACHE  256
+
+typedef struct DaoRegexCache  DaoRegexCache;
+
+DAO_DLL DaoRegexCache* DaoRegexCache_New( int limit );
+DAO_DLL void DaoRegexCache_Delete( DaoRegexCache *self );
+
+/*
+// Return a private copy of the compiled pattern, or NULL if the pattern
+// is invalid, in which case "error" is set to the position of the error;
+*/
+DAO_DLL DaoRegex* DaoRegexCache_Make( DaoRegexCache *self, DString *src, int *error );
+
+/* Compile and pin a constant pattern, return zero if it is invalid: */
+DAO_DLL int DaoRegexCache_Pin( DaoRegexCache *self, DString *src );
+
 #endif
@@ -608,10 +608,10 @@ static DaoValue* DaoInteger_DoConversion( DaoValue *self, DaoType *type, int cop
 	}
 	if( type->tid == DAO_STRING ){
 		DaoValue *res = DaoValue_SimpleCopy( type->value );
-		char chs[100] = {0};
-		sprintf( chs, "%"DAO_I64, (long long) self->xInteger.value );
+		char chs[32];
+		int count = Dao_FormatInteger( chs, self->xInteger.value );
 		DaoProcess_CacheValue( proc, res );
-		DString_SetChars( res->xString.value, chs );
+		DString_SetBytes( res->xString.value, chs, count );
 		return res;
 	}else if( type->tid == DAO_ENUM ){
 		DaoValue *res = DaoValue_SimpleCopy( type->value );
@@ -802,11 +802,11 @@ static DaoValue* DaoFloat_DoConversion( DaoValue *self, DaoType *type, int copy,
 	}
 	if( type->tid == DAO_STRING ){
 		DaoValue *res = DaoValue_SimpleCopy( type->value );
-		char chs[100] = {0};
+		char chs[100];
+		int count = Dao_FormatFloat( chs, self->xFloat.value, 'g' );
 
-		sprintf( chs, "%g", self->xFloat.value );
 		DaoProcess_CacheValue( proc, res );
-		DString_SetChars( res->xString.value, chs );
+		DString_SetBytes( res->xString.value, chs, count );
 		return res;
 	}
 	return NULL;
@@ -1337,6 +1337,11 @@ static DaoValue* DaoString_DoGetItem( DaoValue *self, DaoValue *index[], int N,
 	case DAO_RANGE :
 		range = Dao_CheckRangeIndex( (DaoTuple*) index[0], size, proc );
 		if( range.pos < 0 ) return NULL;
+		if( range.pos == 0 && range.end == size ){
+			/* Share the buffer for the full slice, other slices are copied: */
+			DaoProcess_PutString( proc, self->xString.value );
+			break;
+		}
 		DaoProcess_PutBytes( proc, self->xString.value->chars + range.pos, range.end - range.pos );
 		break;
 	case DAO_ITERATOR :
@@ -1828,6 +1833,45 @@ static void DaoSTR_Split( DaoProcess *proc, DaoValue *p[], int N )
 	DList_Append( list->value, value );
 	DaoString_Delete( (DaoString*) value );
 }
+static void DaoSTR_Split2( DaoProcess *proc, DaoValue *p[], int N )
+{
+	DaoList *list = DaoProcess_PutList( proc );
+	DaoValue *value = (DaoValue*) DaoString_New();
+	DString *self = p[0]->xString.value;
+	DList *seps = p[1]->xList.value;
+	DString *str = value->xString.value;
+	DString *firsts = DString_New();
+	daoint i, last = 0, pos = 0;
+
+	for(i=0; i<seps->size; ++i){
+		DString *sep = seps->items.pValue[i]->xString.value;
+		if( sep->size == 0 || DString_FindChar( firsts, sep->chars[0], 0 ) >= 0 ) continue;
+		DString_AppendChar( firsts, sep->chars[0] );
+	}
+	while( firsts->size ){
+		DString *sep = NULL;
+		pos = DString_FindCharSet( self, firsts->chars, firsts->size, pos );
+		if( pos == DAO_NULLPOS ) break;
+		for(i=0; i<seps->size; ++i){
+			sep = seps->items.pValue[i]->xString.value;
+			if( sep->size && sep->size <= self->size - pos ){
+				if( memcmp( self->chars + pos, sep->chars, sep->size ) == 0 ) break;
+			}
+			sep = NULL;
+		}
+		if( sep == NULL ){
+			pos += 1;
+			continue;
+		}
+		DString_SubString( self, str, last, pos - last );
+		DList_Append( list->value, value );
+		last = pos = pos + sep->size;
+	}
+	DString_SubString( self, str, last, self->size - last );
+	DList_Append( list->value, value );
+	DaoString_Delete( (DaoString*) value );
+	DString_Delete( firsts );
+}
 
 static void DaoSTR_Fetch( DaoProcess *proc, DaoValue *p[], int N )
 {
@@ -1988,6 +2032,12 @@ static void DaoSTR_Scan( DaoProcess *proc, DaoValue *p[], int N )
 	sect = DaoProcess_InitCodeSection( proc, 3 );
 	if( sect == NULL ) return;
 
+	/*
+	// Use a private copy, since the code section may use the same pattern,
+	// or other patterns that could retire the cached copy:
+	*/
+	patt = DaoRegex_Clone( patt );
+
 	denum.etype = DaoNamespace_MakeEnumType( proc->activeNamespace, "unmatched,matched" );
 	denum.subtype = DAO_ENUM_STATE;
 	entry = proc->topFrame->entry;
@@ -2027,6 +2077,7 @@ static void DaoSTR_Scan( DaoProcess *proc, DaoValue *p[], int N )
 		start = offset = end;
 		end = to;
 	}
+	DaoRegex_Delete( patt );
 	DaoProcess_PopFrame( proc );
 }
 
@@ -2115,7 +2166,12 @@ static void DaoSTR_Char( DaoProcess *proc, DaoValue *p[], int N )
 	DString *self = p[0]->xString.value;
 	daoint index = p[1]->xInteger.value;
 	daoint pos = DString_GetByteIndex( self, index );
-	DCharState state = DString_DecodeChar( self->chars + pos, self->chars + self->size );
+	DCharState state;
+	if( pos == DAO_NULLPOS ){
+		DaoProcess_RaiseError( proc, "Index::Range", NULL );
+		return;
+	}
+	state = DString_DecodeChar( self->chars + pos, self->chars + self->size );
 	DaoProcess_PutBytes( proc, self->chars + pos, state.width );
 }
 
@@ -2136,7 +2192,7 @@ static DaoFunctionEntry daoStringMeths[] =
 		*/
 	},
 	{ DaoSTR_Size,
-		"size( invar self: string, utf8 = false ) => int"
+		"@leaf size( invar self: string, utf8 = false ) => int"
 		/*
 		// Return the number of bytes or characters in the string.
 		*/
@@ -2234,6 +2290,14 @@ static DaoFunctionEntry daoStringMeths[] =
 		// If "sep" is empty, split at character boundaries assuming UTF-8 encoding.
 		*/
 	},
+	{ DaoSTR_Split2,
+		"split( invar self: string, invar seps: list<string> ) => list<string>"
+		/*
+		// Split the string by any of the seperators in "seps";
+		// At each position, the first seperator (in the list order) that
+		// matches is used; Empty seperators are ignored.
+		*/
+	},
 	{ DaoSTR_Fetch,
 		"fetch( invar self: string, pattern: string, group = 0, start = 0, end = 0 )"
 			"=> string"
@@ -2315,13 +2379,13 @@ static DaoFunctionEntry daoStringMeths[] =
 	},
 
 	{ DaoSTR_Index,
-		"offset( invar self: string, charIndex: int ) => int"
+		"@leaf offset( invar self: string, charIndex: int ) => int"
 		/*
 		// Get byte offset for the character with index "charIndex";
 		*/
 	},
 	{ DaoSTR_Char,
-		"char( invar self: string, charIndex: int ) => string"
+		"@leaf char( invar self: string, charIndex: int ) => string"
 		/*
 		// Get the character with index "charIndex";
 		*/
@@ -3877,7 +3941,7 @@ static DaoFunctionEntry daoListMeths[] =
 		*/
 	},
 	{ DaoLIST_Size,
-		"size( invar self: list<@T> )=>int"
+		"@leaf size( invar self: list<@T> )=>int"
 		/*
 		// Return the size of the list.
 		*/
@@ -3937,34 +4001,34 @@ static DaoFunctionEntry daoListMeths[] =
 		*/
 	},
 	{ DaoLIST_PushBack,
-		"append( self: list<@T>, item: @T, ... : @T ) => list<@T>"
+		"@leaf append( self: list<@T>, item: @T, ... : @T ) => list<@T>"
 		/*
 		// Append one or more items at the end of the list.
 		// Return the self list;
 		*/
 	},
 	{ DaoLIST_Push,
-		"push( self: list<@T>, item: @T, to: enum<front, back> = $back ) => list<@T>"
+		"@leaf push( self: list<@T>, item: @T, to: enum<front, back> = $back ) => list<@T>"
 		/*
 		// Push an item to the list, either at the front or at the back.
 		// Return the self list;
 		*/
 	},
 	{ DaoLIST_Pop,
-		"pop( self: list<@T>, from: enum<front,back> = $back ) => @T"
+		"@leaf pop( self: list<@T>, from: enum<front,back> = $back ) => @T"
 		/*
 		// Pop off an item from the list, either from the front or from the end.
 		// Return the self list;
 		*/
 	},
 	{ DaoLIST_Front,
-		"front( invar self: list<@T> ) => @T"
+		"@leaf front( invar self: list<@T> ) => @T"
 		/*
 		// Get the front item of the list.
 		*/
 	},
 	{ DaoLIST_Back,
-		"back( invar self: list<@T> ) => @T"
+		"@leaf back( invar self: list<@T> ) => @T"
 		/*
 		// Get the back item of the list.
 		*/
@@ -5014,7 +5078,7 @@ static DaoFunctionEntry daoMapMeths[] =
 		*/
 	},
 	{ DaoMAP_Size,
-		"size( invar self: map<@K,@V> ) => int"
+		"@leaf size( invar self: map<@K,@V> ) => int"
 		/*
 		// Return the number of key-value pairs in map.
 		*/
@@ -5226,11 +5290,9 @@ int  DaoTuple_Size( DaoTuple *self )
 }
 int DaoTuple_GetIndex( DaoTuple *self, DString *name )
 {
-	DaoType *type = self->ctype;
-	DNode *node = NULL;
-	if( type && type->mapNames ) node = MAP_Find( type->mapNames, name );
-	if( node == NULL || node->value.pInt >= self->size ) return -1;
-	return node->value.pInt;
+	int id = self->ctype ? DaoType_FindName( self->ctype, name ) : -1;
+	if( id >= self->size ) return -1;
+	return id;
 }
 int DaoTuple_SetItem( DaoTuple *self, DaoValue *it, int pos )
 {
@@ -5268,10 +5330,9 @@ static int DaoTuple_CheckIndex( DaoTuple *self, DString *field, DaoProcess *proc
 static DaoType* DaoTuple_GetFieldType( DaoType *self, DString *field )
 {
 	DaoType *type;
-	DNode *node = NULL;
-	if( self->mapNames ) node = MAP_Find( self->mapNames, field );
-	if( node == NULL || node->value.pInt >= self->args->size ) return NULL;
-	type = self->args->items.pType[ node->value.pInt ];
+	int id = DaoType_FindName( self, field );
+	if( id < 0 || id >= self->args->size ) return NULL;
+	type = self->args->items.pType[ id ];
 	if( type->tid == DAO_PAR_NAMED || type->tid == DAO_PAR_VALIST ) type = (DaoType*)type->aux;
 	return type;
 }
@@ -36,6 +36,8 @@
 #include"daoNamespace.h"
 #include"daoValue.h"
 #include"daoGC.h"
+#include"daoTasklet.h"
+#include"daoRegex.h"
 
 #define IO_BUF_SIZE  4096
 
@@ -214,23 +216,29 @@ void DaoStream_WriteInt( DaoStream *self, dao_integer val )
 	int count;
 
 	if( self->Write == NULL ) return;
-	if( format == NULL ) format = "%"DAO_I64;
-	count = snprintf( buffer, sizeof(buffer), format, val );
+	if( format == NULL ){
+		count = Dao_FormatInteger( buffer, val );
+	}else{
+		count = snprintf( buffer, sizeof(buffer), format, val );
+	}
 	self->Write( self, buffer, count );
 }
 void DaoStream_WriteFloat( DaoStream *self, double val )
 {
 	const char *format = self->format;
 	const char *iconvs = "diouxXcC";
-	char buffer[100];
+	char buffer[320];
 	int count;
 	if( self->Write == NULL ) return;
 	if( format && strchr( iconvs, format[ strlen(format)-1 ] ) && val ==(dao_integer)val ){
 		DaoStream_WriteInt( self, (dao_integer)val );
 		return;
 	}
-	if( format == NULL ) format = "%f";
-	count = snprintf( buffer, sizeof(buffer), format, val );
+	if( format == NULL ){
+		count = Dao_FormatFloat( buffer, val, 'f' );
+	}else{
+		count = snprintf( buffer, sizeof(buffer), format, val );
+	}
 	self->Write( self, buffer, count );
 }
 void DaoStream_WriteChars( DaoStream *self, const char *chars )
@@ -427,10 +435,28 @@ static void DaoIO_Write0( DaoStream *self, DaoProcess *proc, DaoValue *p[], int
 	}
 	if( cycmap ) DMap_Delete( cycmap );
 }
+/*
+// Suspend the tasklet until the stream becomes ready, if the reading or
+// writing would block. Return 1 if suspended, the method will be called
+// again after the tasklet is resumed.
+*/
+static int DaoIO_WaitStream( DaoStream *self, DaoProcess *proc, int mode, int count )
+{
+#ifdef DAO_WITH_CONCURRENT
+	int fd;
+	if( self->Poll == NULL ) return 0;
+	fd = self->Poll( self, mode, count );
+	if( fd < 0 ) return 0;
+	return DaoVmSpace_AddTaskletPoll( proc->vmSpace, proc, fd, mode );
+#else
+	return 0;
+#endif
+}
 static void DaoIO_Write( DaoProcess *proc, DaoValue *p[], int N )
 {
 	DaoStream *self = & p[0]->xStream;
 	if( DaoIO_CheckMode( self, proc, DAO_STREAM_WRITABLE ) == 0 ) return;
+	if( DaoIO_WaitStream( self, proc, DAO_STREAM_WRITABLE, 0 ) ) return;
 	DaoIO_Write0( self, proc, p+1, N-1 );
 }
 static void DaoIO_Write2( DaoProcess *proc, DaoValue *p[], int N )
@@ -469,6 +495,7 @@ static void DaoIO_Writeln( DaoProcess *proc, DaoValue *p[], int N )
 {
 	DaoStream *self = & p[0]->xStream;
 	if( DaoIO_CheckMode( self, proc, DAO_STREAM_WRITABLE ) == 0 ) return;
+	if( DaoIO_WaitStream( self, proc, DAO_STREAM_WRITABLE, 0 ) ) return;
 	DaoIO_Writeln0( self, proc, p+1, N-1 );
 }
 static void DaoIO_Writeln2( DaoProcess *proc, DaoValue *p[], int N )
@@ -667,6 +694,7 @@ static void DaoIO_Read( DaoProcess *proc, DaoValue *p[], int N )
 			amount = - 1 - p[1]->xEnum.value;
 		}
 	}
+	if( DaoIO_WaitStream( self, proc, DAO_STREAM_READABLE, amount ) ) return;
 	DString_Reset( ds, 0 );
 	self->Read( self, ds, amount );
 	if( self->mode & DAO_STREAM_AUTOCONV ) DString_ToUTF8( ds );
@@ -748,6 +776,101 @@ static void DaoIO_ReadLines( DaoProcess *proc, DaoValue *p[], int N )
 	DaoStream_ReadLines( (DaoStream*) p[0], list, proc, count, chop );
 }
 
+/*
+// Scan the stream for the matches of a pattern, reading it chunk by chunk.
+// Only a window of the input is buffered: a match is reported once at least
+// "maxlen" bytes after its start are available (or the stream has ended),
+// and the bytes before the last "maxlen" ones are dropped when no match is
+// found in the window. So the matches are exactly the ones string.scan()
+// would find on the whole input, as long as they are at most "maxlen" bytes
+// long; longer ones may be cut at the window end.
+//
+// A pattern anchored at the search start ("^...") can only match at the
+// start of the input or right after the previous match, so the scan ends
+// once the window has passed that position. A "^" that does not start the
+// pattern, such as in "a|^b", may still match at the start of the window
+// after bytes are dropped.
+*/
+static void DaoIO_Scan( DaoProcess *proc, DaoValue *p[], int N )
+{
+	DaoStream *self = (DaoStream*) p[0];
+	DString *pt = p[1]->xString.value;
+	daoint maxlen = p[2]->xInteger.value;
+	daoint base = 0, pos = 0, start, end, keep;
+	DaoList *list = DaoProcess_PutList( proc );
+	DaoRegex *patt = DaoProcess_MakeRegex( proc, pt );
+	DaoInteger startpos = {DAO_INTEGER,0,0,0,0,0};
+	DaoInteger endpos = {DAO_INTEGER,0,0,0,0,0};
+	DaoString match = {DAO_STRING,0,0,0,1,NULL};
+	DString *buffer, *chunk, bytes;
+	DaoVmCode *sect;
+	DaoValue *res;
+	ushort_t entry;
+	int eof = 0, anchored;
+
+	if( DaoIO_CheckMode( self, proc, DAO_STREAM_READABLE ) == 0 ) return;
+	if( patt == NULL ) return; /* Error raised by DaoProcess_MakeRegex(); */
+	if( maxlen <= 0 ){
+		DaoProcess_RaiseError( proc, "Param", "invalid maximum match length" );
+		return;
+	}
+
+	sect = DaoProcess_InitCodeSection( proc, 3 );
+	if( sect == NULL ) return;
+
+	patt = DaoRegex_Clone( patt );
+	anchored = DaoRegex_IsAnchored( patt );
+	buffer = DString_New();
+	chunk = DString_New();
+	entry = proc->topFrame->entry;
+	match.value = & bytes;
+
+	while( pos <= buffer->size ){
+		start = pos;
+		end = buffer->size;
+		if( DaoRegex_Match( patt, buffer, & start, & end ) && (eof || buffer->size - start > maxlen) ){
+			startpos.value = base + start;
+			endpos.value = base + end;
+			bytes = DString_WrapBytes( buffer->chars + start, end - start );
+			if( sect->b > 0 ) DaoProcess_SetValue( proc, sect->a, (DaoValue*) & match );
+			if( sect->b > 1 ) DaoProcess_SetValue( proc, sect->a+1, (DaoValue*) & startpos );
+			if( sect->b > 2 ) DaoProcess_SetValue( proc, sect->a+2, (DaoValue*) & endpos );
+			proc->topFrame->entry = entry;
+			DaoProcess_Execute( proc );
+			if( proc->status == DAO_PROCESS_ABORTED ) break;
+			res = proc->stackValues[0];
+			if( res && res->type != DAO_NONE ) DaoList_Append( list, res );
+			pos = end > start ? end : end + 1;
+			continue;
+		}
+		if( eof ) break;
+
+		/*
+		// Drop the bytes that can no longer be part of a match: the ones
+		// before the search start, and the ones before the last "maxlen"
+		// bytes, since a match starting there would have been found.
+		// The search then resumes from the start of the retained bytes.
+		*/
+		keep = buffer->size - maxlen;
+		if( keep < pos ) keep = pos;
+		if( anchored && keep > pos ) break; /* No match at the search start; */
+		if( keep > 0 ){
+			DString_Erase( buffer, 0, keep );
+			base += keep;
+			pos = pos > keep ? pos - keep : 0;
+		}
+		if( DaoStream_Read( self, chunk, IO_BUF_SIZE ) <= 0 ){
+			eof = 1;
+		}else{
+			DString_Append( buffer, chunk );
+		}
+	}
+	DString_Delete( buffer );
+	DString_Delete( chunk );
+	DaoRegex_Delete( patt );
+	DaoProcess_PopFrame( proc );
+}
+
 
 DaoFunctionEntry dao_io_methods[] =
 {
@@ -767,6 +890,7 @@ static DaoFunctionEntry daoStreamMeths[] =
 	{ DaoIO_Read,      "read( self: Stream, count = -1 )=>string" },
 	{ DaoIO_Read,      "read( self: Stream, amount: enum<line,all> = $all )=>string" },
 	{ DaoIO_ReadLines, "readlines( self: Stream, numline=0, chop = false )[line: string=>none|@T]=>list<@T>" },
+	{ DaoIO_Scan,      "scan( self: Stream, pattern: string, maxlen = 4096 )[match: string, start: int, end: int => none|@T] => list<@T>" },
 
 	{ DaoIO_Flush,     "flush( self: Stream )" },
 	{ DaoIO_Enable,    "enable( self: Stream, what: enum<auto_conversion>, state: bool )" },
@@ -87,6 +87,14 @@ struct DaoStream
 	short     mode;
 	char     *format;
 	DString  *buffer;
+
+	/*
+	// Check if reading (mode = DAO_STREAM_READABLE, count as for Read())
+	// or writing (mode = DAO_STREAM_WRITABLE) would block, if supported;
+	// Return the file descriptor to wait on if it would block;
+	// Return -1 otherwise;
+	*/
+	int (*Poll)( DaoStream *self, int mode, int count );
 };
 
 struct DaoStdStream
@@ -30,12 +30,18 @@
 #include<stdlib.h>
 #include<string.h>
 #include<ctype.h>
+#include<math.h>
+#include<float.h>
 #include<wctype.h>
 #include<wchar.h>
 
 #include"daoString.h"
 #include"daoThread.h"
 
+#ifdef __SSE2__
+#include<emmintrin.h>
+#endif
+
 #ifdef DAO_WITH_THREAD
 DMutex  mutex_string_sharing;
 #endif
@@ -70,6 +76,19 @@ static void DStringAux_Delete( DStringAux *self )
 	if( self->counters ) dao_free( self->counters );
 	dao_free( self );
 }
+/* Count the leading ASCII bytes: */
+static daoint DString_CountASCII( const uchar_t *bytes, daoint n )
+{
+	daoint i = 0;
+#ifdef __SSE2__
+	for(; i+16<=n; i+=16){
+		__m128i block = _mm_loadu_si128( (const __m128i*) (bytes + i) );
+		if( _mm_movemask_epi8( block ) ) break;
+	}
+#endif
+	while( i < n && bytes[i] < 0x80 ) i += 1;
+	return i;
+}
 static void DStringAux_Update( DStringAux *self, DString *string )
 {
 	daoint size = 0;
@@ -82,10 +101,15 @@ static void DStringAux_Update( DStringAux *self, DString *string )
 	self->chars = 0;
 	self->visit = 0;
 	while( i < string->size ){
-		daoint pos = DString_LocateChar( string, i, 0 );
-		int width = pos == DAO_NULLPOS ? 1 : DString_UTF8CharSize( bytes[i] );
+		daoint pos, count = DString_CountASCII( bytes + i, string->size - i );
+		int width = 1;
+		if( count == 0 ){
+			pos = DString_LocateChar( string, i, 0 );
+			width = pos == DAO_NULLPOS ? 1 : DString_UTF8CharSize( bytes[i] );
+			count = 1;
+		}
 		if( width == last->width ){
-			last->count += 1;
+			last->count += count;
 		}else{
 			daoint chars = last->chars + last->count;
 			daoint bytes = last->bytes + last->count * last->width;
@@ -95,12 +119,12 @@ static void DStringAux_Update( DStringAux *self, DString *string )
 			}
 			last = self->counters + (size++);
 			last->width = width;
-			last->count = 1;
+			last->count = count;
 			last->chars = chars;
 			last->bytes = bytes;
 		}
-		self->chars += 1;
-		i += width;
+		self->chars += count;
+		i += width * count;
 	}
 	self->size = size; /* set after done, for thread safety; */
 
@@ -121,9 +145,23 @@ static daoint DStringAux_GetByteIndex( DStringAux *self, DString *string, daoint
 
 	if( chindex < 0 ) chindex += self->chars;
 	if( chindex < 0 || chindex >= self->chars ) return DAO_NULLPOS;
-	while( visit >= start && chindex < visit->chars ) visit -= 1;
-	while( visit < end && chindex > visit->chars + visit->count ) visit += 1;
-	if( visit < start || visit >= end ) return DAO_NULLPOS;
+	if( chindex < visit->chars || chindex >= visit->chars + visit->count ){
+		if( visit + 1 < end && chindex >= visit[1].chars && chindex < visit[1].chars + visit[1].count ){
+			visit += 1; /* sequential access; */
+		}else{
+			/* Binary search for the last counter starting at or before the char: */
+			daoint first = 0, last = self->size - 1;
+			while( first < last ){
+				daoint middle = (first + last + 1) / 2;
+				if( start[middle].chars <= chindex ){
+					first = middle;
+				}else{
+					last = middle - 1;
+				}
+			}
+			visit = start + first;
+		}
+	}
 	self->visit = visit - start;
 	return visit->bytes + visit->width * (chindex - visit->chars);
 }
@@ -284,49 +322,80 @@ void DString_Reserve( DString *self, daoint size )
 	int *data = (int*)self->chars - self->sharing;
 	daoint bufsize = size >= self->bufSize ? (1.2*size + 4) : self->bufSize;
 
+	/* Grow geometrically with respect to the current buffer for repeated appending: */
+	if( size >= self->bufSize && bufsize < 1.5*self->bufSize ) bufsize = 1.5*self->bufSize;
 	DString_Detach( self, bufsize );
 	if( size <= self->bufSize ) return;
 	self->bufSize = bufsize;
 	DString_Realloc( self, self->bufSize );
 }
-int DString_IsASCII( DString *self );
-void DString_ToLower( DString *self )
+/* Convert the case of ASCII letters in place, 16 bytes at a time with SSE2: */
+static void DString_MapASCIICase( uchar_t *bytes, daoint n, int upper )
 {
-	daoint i;
-	char *bytes;
-	DArray *wcs;
-
-	DString_Detach( self, self->size );
-	if( DString_IsASCII( self ) ){
-		for(i=0,bytes=self->chars; i<self->size; i++, bytes++) *bytes = tolower( *bytes );
-		return;
+	uchar_t first = upper ? 'a' : 'A';
+	daoint i = 0;
+#ifdef __SSE2__
+	__m128i low = _mm_set1_epi8( first - 1 );
+	__m128i high = _mm_set1_epi8( first + 26 );
+	__m128i flip = _mm_set1_epi8( 0x20 );
+	for(; i+16<=n; i+=16){
+		__m128i block = _mm_loadu_si128( (const __m128i*) (bytes + i) );
+		__m128i mask = _mm_and_si128( _mm_cmpgt_epi8( block, low ), _mm_cmplt_epi8( block, high ) );
+		block = _mm_xor_si128( block, _mm_and_si128( mask, flip ) );
+		_mm_storeu_si128( (__m128i*) (bytes + i), block );
 	}
-	wcs = DArray_New( sizeof(wchar_t) );
-	DString_DecodeUTF8( self, wcs );
-	self->size = 0;
-	for(i=0; i<wcs->size; ++i){
-		DString_AppendWChar( self, towlower( wcs->data.wchars[i] ) );
+#endif
+	for(; i<n; ++i){
+		if( bytes[i] >= first && bytes[i] < first + 26 ) bytes[i] ^= 0x20;
 	}
-	DArray_Delete( wcs );
 }
-void DString_ToUpper( DString *self )
+/*
+// ASCII runs are converted in place. From the first non-ASCII byte on,
+// the result is rebuilt, since the converted chars may have different
+// widths, and invalid bytes are replaced by the replacement character:
+*/
+static void DString_ChangeCase( DString *self, int upper )
 {
-	daoint i;
-	char *bytes;
-	DArray *wcs;
+	uchar_t *bytes;
+	DString *res;
+	daoint pos;
 
 	DString_Detach( self, self->size );
-	if( DString_IsASCII( self ) ){
-		for(i=0,bytes=self->chars; i<self->size; i++, bytes++) *bytes = toupper( *bytes );
-		return;
-	}
-	wcs = DArray_New( sizeof(wchar_t) );
-	DString_DecodeUTF8( self, wcs );
-	self->size = 0;
-	for(i=0; i<wcs->size; ++i){
-		DString_AppendWChar( self, towupper( wcs->data.wchars[i] ) );
+	bytes = (uchar_t*) self->chars;
+	pos = DString_CountASCII( bytes, self->size );
+	DString_MapASCIICase( bytes, pos, upper );
+	if( pos == self->size ) return;
+
+	res = DString_New();
+	DString_Reserve( res, self->size + 4 );
+	DString_AppendBytes( res, self->chars, pos );
+	while( pos < self->size ){
+		DCharState state = DString_DecodeChar( self->chars + pos, self->chars + self->size );
+		if( state.type == 0 ){
+			DString_AppendWChar( res, 0xFFFD );
+			pos += 1;
+		}else if( state.type == 1 ){
+			daoint count = DString_CountASCII( bytes + pos, self->size - pos );
+			DString_AppendBytes( res, self->chars + pos, count );
+			DString_MapASCIICase( (uchar_t*) res->chars + res->size - count, count, upper );
+			pos += count;
+		}else{
+			uint_t ch = state.value;
+			if( sizeof(wchar_t) > 2 || ch <= 0xFFFF ) ch = upper ? towupper( ch ) : towlower( ch );
+			DString_AppendWChar( res, ch );
+			pos += state.width;
+		}
 	}
-	DArray_Delete( wcs );
+	DString_Assign( self, res );
+	DString_Delete( res );
+}
+void DString_ToLower( DString *self )
+{
+	DString_ChangeCase( self, 0 );
+}
+void DString_ToUpper( DString *self )
+{
+	DString_ChangeCase( self, 1 );
 }
 daoint DString_Size( DString *self )
 {
@@ -336,7 +405,12 @@ daoint DString_Size( DString *self )
 void DString_Reset( DString *self, daoint size )
 {
 	if( size <= self->bufSize ){
-		DString_Detach( self, self->bufSize );
+		/*
+		// Detaching with the requested size, not the buffer size, so that
+		// a reused string detached from the previously shared results
+		// does not carry over (and keep growing) its buffer:
+		*/
+		DString_Detach( self, size );
 		self->size = size;
 		self->chars[size] = '\0';
 		return;
@@ -475,33 +549,142 @@ void DString_SubString( DString *self, DString *sub, daoint from, daoint n )
 	}
 	if( n < 0 || n > size ) n = size;
 	if( from+n > size ) n = size-from;
+	if( sub != self ) sub->size = 0; /* No copying of the old content on detaching; */
 	DString_Reset( sub, n );
 	memcpy( sub->chars, self->chars + from, n * sizeof(char) );
 }
-/* TODO: better string searching algorithm */
+
+/*
+// Searching kernels:
+//
+// Single bytes are searched by memchr(), which is vectorized and dispatched
+// by the CPU features at runtime in the common C libraries; Backward scanning
+// and substring searching are vectorized with SSE2 where it is available
+// (it is always available on x86-64).
+//
+// Substrings are located by comparing their first and last bytes with
+// 16 positions at once, and only the candidate positions are fully compared.
+// Long needles in long strings are searched by Boyer-Moore-Horspool instead,
+// which skips up to the needle size for each comparison.
+*/
+#define DSTRING_HORSPOOL_NEEDLE  32
+#define DSTRING_HORSPOOL_STRING  1024
+
+#ifdef __SSE2__
+static int DString_LowestBit( int mask )
+{
+#ifdef __GNUC__
+	return __builtin_ctz( mask );
+#else
+	int i = 0;
+	while( (mask & 1) == 0 ) mask >>= 1, i += 1;
+	return i;
+#endif
+}
+static int DString_HighestBit( int mask )
+{
+#ifdef __GNUC__
+	return 31 - __builtin_clz( mask );
+#else
+	int i = 31;
+	while( (mask & (1<<i)) == 0 ) i -= 1;
+	return i;
+#endif
+}
+#endif
+
+static const char* DString_MemRChr( const char *chars, char ch, daoint n )
+{
+	const char *p = chars + n;
+#ifdef __SSE2__
+	__m128i key = _mm_set1_epi8( ch );
+	while( p - chars >= 16 ){
+		__m128i block = _mm_loadu_si128( (const __m128i*) (p - 16) );
+		int mask = _mm_movemask_epi8( _mm_cmpeq_epi8( block, key ) );
+		if( mask ) return p - 16 + DString_HighestBit( mask );
+		p -= 16;
+	}
+#endif
+	while( p != chars ){
+		p -= 1;
+		if( *p == ch ) return p;
+	}
+	return NULL;
+}
+static daoint DString_Horspool( const char *chars, daoint n, const char *chs, daoint m )
+{
+	const uchar_t *bytes = (const uchar_t*) chars;
+	uchar_t last = (uchar_t) chs[m-1];
+	daoint i, skip[256];
+
+	for(i=0; i<256; ++i) skip[i] = m;
+	for(i=0; i<m-1; ++i) skip[ (uchar_t) chs[i] ] = m - 1 - i;
+	for(i=0; i+m<=n; i+=skip[bytes[i+m-1]]){
+		if( bytes[i+m-1] == last && memcmp( chars + i, chs, m - 1 ) == 0 ) return i;
+	}
+	return DAO_NULLPOS;
+}
+static daoint DString_Search( const char *chars, daoint n, const char *chs, daoint m )
+{
+	const char *p, *end = chars + n - m + 1;
+	char first = chs[0], last = chs[m-1];
+	daoint i = 0;
+
+	if( m == 1 ){
+		p = (const char*) memchr( chars, first, n );
+		return p ? p - chars : DAO_NULLPOS;
+	}
+	if( m >= DSTRING_HORSPOOL_NEEDLE && n >= DSTRING_HORSPOOL_STRING ){
+		return DString_Horspool( chars, n, chs, m );
+	}
+#ifdef __SSE2__
+	if( n >= m + 15 ){
+		__m128i key1 = _mm_set1_epi8( first );
+		__m128i key2 = _mm_set1_epi8( last );
+		for(i=0; i+m+15<=n; i+=16){
+			__m128i block1 = _mm_loadu_si128( (const __m128i*) (chars + i) );
+			__m128i block2 = _mm_loadu_si128( (const __m128i*) (chars + i + m - 1) );
+			__m128i eq1 = _mm_cmpeq_epi8( block1, key1 );
+			__m128i eq2 = _mm_cmpeq_epi8( block2, key2 );
+			int mask = _mm_movemask_epi8( _mm_and_si128( eq1, eq2 ) );
+			while( mask ){
+				daoint k = i + DString_LowestBit( mask );
+				if( memcmp( chars + k + 1, chs + 1, m - 2 ) == 0 ) return k;
+				mask &= mask - 1;
+			}
+		}
+	}
+#endif
+	for(p=chars+i; p<end; ++p){
+		p = (const char*) memchr( p, first, end - p );
+		if( p == NULL ) break;
+		if( p[m-1] == last && memcmp( p + 1, chs + 1, m - 2 ) == 0 ) return p - chars;
+	}
+	return DAO_NULLPOS;
+}
 static daoint DMBString_Find( DString *self, daoint S, const char *chs, daoint M )
 {
-	daoint i, j;
+	daoint pos;
 
+	if( S < 0 ) S = 0;
 	if( M == 0 ) return DAO_NULLPOS;
 	if( M+S > self->size ) return DAO_NULLPOS;
-	for(i=S; i<self->size-M+1; i++){
-		int found = memcmp( self->chars + i, chs, M ) == 0;
-		if( found ) return i;
-	}
-	return DAO_NULLPOS;
+	pos = DString_Search( self->chars + S, self->size - S, chs, M );
+	return pos == DAO_NULLPOS ? pos : S + pos;
 }
 static daoint DMBString_RFind( DString *self, daoint S, const char* chs, daoint M )
 {
-	daoint i, j;
+	const char *p;
+	char last;
 
 	if( S < 0 ) S += self->size;
 	if( M == 0 || self->size == 0 ) return DAO_NULLPOS;
 	if( S >= self->size ) S = self->size-1;
 	if( (S+1) < M || M > self->size ) return DAO_NULLPOS;
-	for( i=S; i>=M-1; i--){
-		int found = memcmp( self->chars + i - M + 1, chs, M ) == 0;
-		if( found ) return i;
+	last = chs[M-1];
+	p = self->chars + S + 1;
+	while( (p = DString_MemRChr( self->chars + M - 1, last, p - self->chars - M + 1 )) ){
+		if( memcmp( p - M + 1, chs, M - 1 ) == 0 ) return p - self->chars;
 	}
 	return DAO_NULLPOS;
 }
@@ -523,16 +706,44 @@ daoint DString_RFind( DString *self, DString *chs, daoint start )
 }
 daoint DString_FindChar( DString *self, char ch, daoint start )
 {
-	daoint i;
-	for(i=start; i<self->size; i++ ) if( self->chars[i] == ch ) return i;
-	return DAO_NULLPOS;
+	const char *p;
+	if( start < 0 ) start = 0;
+	if( start >= self->size ) return DAO_NULLPOS;
+	p = (const char*) memchr( self->chars + start, ch, self->size - start );
+	return p ? p - self->chars : DAO_NULLPOS;
 }
 daoint DString_RFindChar( DString *self, char ch, daoint start )
 {
-	daoint i;
+	const char *p;
 	if( self->size ==0 ) return DAO_NULLPOS;
 	if( start < 0 || start >= self->size ) start = self->size - 1;
-	for(i=start; i >=0; i-- ) if( self->chars[i] == ch ) return i;
+	p = DString_MemRChr( self->chars, ch, start + 1 );
+	return p ? p - self->chars : DAO_NULLPOS;
+}
+daoint DString_FindCharSet( DString *self, const char *set, daoint n, daoint start )
+{
+	const uchar_t *bytes = (const uchar_t*) self->chars;
+	uint_t bits[8] = {0};
+	daoint i = start < 0 ? 0 : start;
+
+	if( n == 1 ) return DString_FindChar( self, set[0], i );
+#ifdef __SSE2__
+	if( n == 2 || n == 3 ){
+		__m128i key1 = _mm_set1_epi8( set[0] );
+		__m128i key2 = _mm_set1_epi8( set[1] );
+		__m128i key3 = _mm_set1_epi8( set[n-1] );
+		for(; i+16<=self->size; i+=16){
+			__m128i block = _mm_loadu_si128( (const __m128i*) (bytes + i) );
+			__m128i eq = _mm_or_si128( _mm_cmpeq_epi8( block, key1 ), _mm_cmpeq_epi8( block, key2 ) );
+			int mask = _mm_movemask_epi8( _mm_or_si128( eq, _mm_cmpeq_epi8( block, key3 ) ) );
+			if( mask ) return i + DString_LowestBit( mask );
+		}
+	}
+#endif
+	for(n-=1; n>=0; --n) bits[ ((uchar_t)set[n]) >> 5 ] |= 1U << (set[n] & 31);
+	for(; i<self->size; ++i){
+		if( bits[ bytes[i] >> 5 ] & (1U << (bytes[i] & 31)) ) return i;
+	}
 	return DAO_NULLPOS;
 }
 
@@ -591,6 +802,7 @@ void DString_Assign( DString *self, DString *chs )
 		memcpy( self->chars, chs->chars, chs->size*sizeof(char) );
 		self->chars[ self->size ] = 0;
 	}else{
+		self->size = 0; /* No copying of the old content on detaching; */
 		DString_Resize( self, chs->size );
 		memcpy( self->chars, chs->chars, chs->size*sizeof(char) );
 	}
@@ -610,8 +822,28 @@ int DString_EQ( DString *self, DString *chs )
 }
 void DString_Add( DString *self, DString *left, DString *right )
 {
-	DString_Assign( self, left );
-	DString_Append( self, right );
+	daoint size = left->size + right->size;
+
+	if( self == left && self == right ){
+		DString_Reserve( self, size );
+		memcpy( self->chars + left->size, self->chars, left->size*sizeof(char) );
+		self->size = size;
+		self->chars[size] = 0;
+		return;
+	}else if( self == left ){
+		DString_Append( self, right );
+		return;
+	}else if( self == right ){
+		DString_InsertChars( self, left->chars, 0, 0, left->size );
+		return;
+	}
+	/* Reuse the buffer of the previous result without copying its content: */
+	self->size = 0;
+	DString_Reserve( self, size );
+	memcpy( self->chars, left->chars, left->size*sizeof(char) );
+	memcpy( self->chars + left->size, right->chars, right->size*sizeof(char) );
+	self->size = size;
+	self->chars[size] = 0;
 }
 daoint DString_BalancedChar( DString *self, char ch, char lch, char rch,
 		char esc, daoint start, daoint end, int countonly )
@@ -873,13 +1105,7 @@ daoint DString_GetCharCount( DString *self )
 
 int DString_IsASCII( DString *self )
 {
-	daoint i, count = 0;
-	uchar_t *bytes = (uchar_t*) self->chars;
-	uchar_t *end = (uchar_t*) self->chars + self->size;
-	for(; bytes < end; ++bytes){
-		if( U8CodeType( *bytes ) != 0 ) return 0;
-	}
-	return 1;
+	return DString_CountASCII( (uchar_t*) self->chars, self->size ) == self->size;
 }
 
 /*
@@ -895,6 +1121,10 @@ int DString_CheckUTF8( DString *self )
 	while( chs < end ){
 		uchar_t ch = *chs;
 		int len = U8CharSize( ch );
+		if( ch < 0x80 ){
+			chs += DString_CountASCII( chs, end - chs );
+			continue;
+		}
 		if( (chs + len) > end ) goto InvalidByte;
 		switch( U8CodeType( ch ) ){
 		case 0 : break;
@@ -931,36 +1161,42 @@ void DString_Chop( DString *self, int utf8 )
 }
 void DString_Trim( DString *self, int head, int tail, int utf8 )
 {
-	int i, ch;
+	daoint start = 0, end = self->size;
+	char *chars = self->chars;
+	int ch;
 
 	if( self->size == 0 ) return;
 	if( head == 0 && tail == 0 ) return;
-	DString_Detach( self, self->size );
 
+	/* Locate the remaining bytes first, then detach and move them once: */
 	if( head ){
-		for(i=0; i<self->size; ++i){
-			ch = self->chars[i];
+		for(; start<end; ++start){
+			ch = chars[start];
 			if( ch != EOF && ! isspace( ch ) ) break;
 		}
-		DString_Erase( self, 0, i );
 		if( utf8 ){
-			for(i=0; i<self->size; ++i){
-				if( DString_LocateCurrentChar( self, i ) == i ) break;
-			}
-			if( i ) DString_Erase( self, 0, i );
+			daoint i = start;
+			while( i < end && DString_LocateCurrentChar( self, i ) != i ) i += 1;
+			start = i;
 		}
 	}
 	if( tail ){
-		while( self->size > 0 ){
-			ch = self->chars[ self->size-1 ];
+		while( end > start ){
+			ch = chars[end-1];
 			if( ch != EOF && ! isspace( ch ) ) break;
-			self->chars[--self->size] = 0;
+			end -= 1;
 		}
-		if( utf8 == 0 ) return;
-		while( self->size && DString_LocateCurrentChar( self, self->size-1 ) == DAO_NULLPOS ){
-			self->chars[--self->size] = 0;
+		if( utf8 ){
+			while( end > start && DString_LocateCurrentChar( self, end-1 ) == DAO_NULLPOS ) end -= 1;
 		}
 	}
+	if( start == 0 && end == self->size ) return;
+
+	self->size = end; /* No copying of the trimmed tail on detaching; */
+	DString_Detach( self, end - start );
+	if( start ) memmove( self->chars, self->chars + start, (end - start)*sizeof(char) );
+	self->size = end - start;
+	self->chars[self->size] = '\0';
 }
 
 int DString_CompareUTF8( DString *self, DString *chs )
@@ -1180,3 +1416,284 @@ void DString_AppendUInt32( DString *bytecodes, uint_t value )
 	bytes[3] = value & 0xFF;
 	DString_AppendBytes( bytecodes, (char*) bytes, 4 );
 }
+
+
+
+/*
+// Number formatting and parsing.
+//
+// The results are exactly the same as the ones from the C library calls
+// they replace. Only the common cases take the fast paths, which do exact
+// integer arithmetic (on 128 bits for the floats); everything else falls
+// back to the library calls.
+*/
+static const char dao_digit_pairs[] =
+	"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+	"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+static const double dao_exact_powers[] =
+{
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static char* Dao_WriteDigits( char *end, unsigned long long value )
+{
+	const char *pair;
+	while( value >= 100 ){
+		pair = dao_digit_pairs + 2*(value % 100);
+		value /= 100;
+		*--end = pair[1];
+		*--end = pair[0];
+	}
+	if( value >= 10 ){
+		pair = dao_digit_pairs + 2*value;
+		*--end = pair[1];
+		*--end = pair[0];
+	}else{
+		*--end = '0' + value;
+	}
+	return end;
+}
+
+/* Same as sprintf( buffer, "%lli", value ); */
+int Dao_FormatInteger( char *buffer, dao_integer value )
+{
+	char digits[32];
+	char *end = digits + sizeof(digits);
+	char *start = Dao_WriteDigits( end, value < 0 ? - (unsigned long long) value : value );
+	int count;
+
+	if( value < 0 ) *--start = '-';
+	count = end - start;
+	memcpy( buffer, start, count );
+	buffer[count] = '\0';
+	return count;
+}
+
+#ifdef __SIZEOF_INT128__
+
+typedef unsigned __int128  dao_uint128;
+
+static const unsigned long long dao_integer_powers[] =
+{
+	1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+	10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL
+};
+
+/* Divide and round to nearest, ties to even, as the printf() functions do: */
+static unsigned long long Dao_RoundDivide( dao_uint128 num, dao_uint128 den )
+{
+	dao_uint128 quot = num / den;
+	dao_uint128 rem2 = 2*(num - quot*den);
+	if( rem2 > den || (rem2 == den && (quot & 1)) ) quot += 1;
+	return quot;
+}
+static unsigned long long Dao_RoundShift( dao_uint128 num, int shift )
+{
+	dao_uint128 quot = num >> shift;
+	dao_uint128 rem = num - (quot << shift);
+	dao_uint128 half = (dao_uint128)1 << (shift - 1);
+	if( rem > half || (rem == half && (quot & 1)) ) quot += 1;
+	return quot;
+}
+
+/* Same as sprintf( buffer, "%f", value ) for |value| < 2^63 and not tiny: */
+static int Dao_FormatFixed( char *buffer, unsigned long long mantissa, int exp, int neg )
+{
+	unsigned long long ipart = 0, fpart = 0;
+	char digits[40];
+	char *end = digits + sizeof(digits);
+	char *start = end;
+	int i, count;
+
+	if( exp >= 0 ){
+		if( exp > 10 ) return -1;
+		ipart = mantissa << exp;
+	}else if( -exp <= 100 ){
+		int shift = -exp;
+		dao_uint128 frac = mantissa;
+		if( shift < 64 ){
+			ipart = mantissa >> shift;
+			frac = mantissa & ((1ULL << shift) - 1);
+		}
+		fpart = Dao_RoundShift( frac * 1000000, shift );
+		if( fpart == 1000000 ){
+			ipart += 1;
+			fpart = 0;
+		}
+	}else{
+		return -1;
+	}
+	for(i=0; i<6; ++i, fpart /= 10) *--start = '0' + fpart % 10;
+	*--start = '.';
+	start = Dao_WriteDigits( start, ipart );
+	if( neg ) *--start = '-';
+	count = end - start;
+	memcpy( buffer, start, count );
+	buffer[count] = '\0';
+	return count;
+}
+
+/* Same as sprintf( buffer, "%g", value ) for 1e-5 <= |value| < 1e15: */
+static int Dao_FormatGeneral( char *buffer, double value, unsigned long long mantissa, int exp, int neg )
+{
+	unsigned long long digits;
+	char *p = buffer;
+	char chars[8];
+	int i, k, ndigit, expo10;
+
+	/* The first significant digit and the rounding to 6 digits: */
+	expo10 = (int) floor( log10( value ) );
+	while(1){
+		k = 5 - expo10;
+		if( k > 10 || k < -10 ) return -1;
+		if( k >= 0 ){
+			digits = Dao_RoundShift( (dao_uint128) mantissa * dao_integer_powers[k], -exp );
+		}else{
+			digits = Dao_RoundDivide( mantissa, (dao_uint128) dao_integer_powers[-k] << -exp );
+		}
+		if( digits >= 1000000 ){
+			expo10 += 1;
+		}else if( digits < 100000 ){
+			expo10 -= 1;
+		}else{
+			break;
+		}
+	}
+	for(i=5; i>=0; --i, digits /= 10) chars[i] = '0' + digits % 10;
+	for(ndigit=6; ndigit>1 && chars[ndigit-1] == '0'; --ndigit);
+
+	if( neg ) *p++ = '-';
+	if( expo10 < -4 || expo10 >= 6 ){
+		*p++ = chars[0];
+		if( ndigit > 1 ) *p++ = '.';
+		for(i=1; i<ndigit; ++i) *p++ = chars[i];
+		*p++ = 'e';
+		*p++ = expo10 < 0 ? '-' : '+';
+		if( expo10 < 0 ) expo10 = - expo10;
+		*p++ = '0' + expo10 / 10;
+		*p++ = '0' + expo10 % 10;
+	}else if( expo10 >= 0 ){
+		for(i=0; i<=expo10; ++i) *p++ = chars[i];
+		if( ndigit > expo10 + 1 ) *p++ = '.';
+		for(i=expo10+1; i<ndigit; ++i) *p++ = chars[i];
+	}else{
+		*p++ = '0';
+		*p++ = '.';
+		for(i=expo10+1; i<0; ++i) *p++ = '0';
+		for(i=0; i<ndigit; ++i) *p++ = chars[i];
+	}
+	*p = '\0';
+	return p - buffer;
+}
+
+#endif
+
+/*
+// Same as sprintf( buffer, "%f", value ) (format = 'f'),
+// or sprintf( buffer, "%g", value ) (format = 'g');
+*/
+int Dao_FormatFloat( char *buffer, double value, char format )
+{
+#ifdef __SIZEOF_INT128__
+	unsigned long long bits, mantissa;
+	int exp, count = -1, neg;
+
+	memcpy( & bits, & value, sizeof(double) );
+	neg = (bits >> 63) != 0;
+	exp = (bits >> 52) & 0x7FF;
+	mantissa = bits & ((1ULL << 52) - 1);
+	if( exp == 0 && mantissa == 0 ){
+		count = format == 'f' ? 8 : 1;
+		if( neg ) *buffer++ = '-';
+		memcpy( buffer, format == 'f' ? "0.000000" : "0", count + 1 );
+		return count + neg;
+	}
+	if( exp != 0 && exp != 0x7FF ){
+		mantissa |= 1ULL << 52;
+		exp -= 1075;
+		if( format == 'f' ){
+			count = Dao_FormatFixed( buffer, mantissa, exp, neg );
+		}else if( fabs( value ) >= 1e-5 && fabs( value ) < 1e15 ){
+			count = Dao_FormatGeneral( buffer, fabs( value ), mantissa, exp, neg );
+		}
+	}
+	if( count >= 0 ) return count;
+#endif
+	return sprintf( buffer, format == 'f' ? "%f" : "%g", value );
+}
+
+/* Same as strtoll( chars, NULL, 0 ); */
+dao_integer Dao_ParseInteger( const char *chars )
+{
+	const char *p = chars;
+	unsigned long long value = 0;
+	int neg = 0, count = 0;
+
+	if( *p == '-' || *p == '+' ) neg = *p++ == '-';
+	if( *p >= '1' && *p <= '9' ){
+		while( *p >= '0' && *p <= '9' && count < 18 ){
+			value = 10*value + (*p++ - '0');
+			count += 1;
+		}
+		if( *p < '0' || *p > '9' ) return neg ? - (dao_integer) value : (dao_integer) value;
+	}
+	return strtoll( chars, NULL, 0 );
+}
+
+/*
+// Same as strtod( chars, NULL ).
+// The fast path handles the decimal numbers of at most 19 significant digits,
+// whose values can be computed with one correctly rounded multiplication or
+// division of two exactly representable doubles (Clinger's fast path).
+*/
+double Dao_ParseFloat( const char *chars )
+{
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+	const char *p = chars;
+	unsigned long long mantissa = 0;
+	int neg = 0, ndigit = 0, ntotal = 0, exp10 = 0;
+	double value;
+
+	if( *p == '-' || *p == '+' ) neg = *p++ == '-';
+	if( p[0] == '0' && (p[1] == 'x' || p[1] == 'X') ) return strtod( chars, NULL );
+	for(; *p >= '0' && *p <= '9'; ++p, ++ntotal){
+		if( mantissa == 0 && *p == '0' ) continue;
+		if( ++ndigit > 19 ) return strtod( chars, NULL );
+		mantissa = 10*mantissa + (*p - '0');
+	}
+	if( *p == '.' ){
+		for(++p; *p >= '0' && *p <= '9'; ++p, ++ntotal){
+			exp10 -= 1;
+			if( mantissa == 0 && *p == '0' ) continue;
+			if( ++ndigit > 19 ) return strtod( chars, NULL );
+			mantissa = 10*mantissa + (*p - '0');
+		}
+	}
+	if( ntotal == 0 ) return strtod( chars, NULL );
+	if( *p == 'e' || *p == 'E' ){
+		const char *q = p + 1;
+		int eneg = 0, expo = 0;
+		if( *q == '-' || *q == '+' ) eneg = *q++ == '-';
+		if( *q >= '0' && *q <= '9' ){
+			for(; *q >= '0' && *q <= '9'; ++q){
+				if( expo > 1000 ) return strtod( chars, NULL );
+				expo = 10*expo + (*q - '0');
+			}
+			exp10 += eneg ? - expo : expo;
+		}
+	}
+	if( mantissa > (1ULL << 53) || exp10 < -22 || exp10 > 22 ) return strtod( chars, NULL );
+	value = (double) mantissa;
+	if( exp10 < 0 ){
+		value /= dao_exact_powers[-exp10];
+	}else{
+		value *= dao_exact_powers[exp10];
+	}
+	return neg ? - value : value;
+#else
+	return strtod( chars, NULL );
+#endif
+}
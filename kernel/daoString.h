@@ -88,6 +88,12 @@ DAO_DLL void DString_AppendBytes( DString *self, const char *chs, daoint n );
 
 DAO_DLL void DString_Replace( DString *self, DString *chs, daoint start, daoint rm );
 DAO_DLL void DString_ReplaceChars( DString *self, const char *chs, daoint start, daoint rm );
+/*
+// Substrings are copied into the buffer of "sub"; there are no views into
+// the buffer of "self", because the chars of DString are used as NUL-ended
+// C strings everywhere. Only copies of whole strings share buffers (see
+// DString_SetSharing()), and "sub" is detached without copying its content.
+*/
 DAO_DLL void DString_SubString( DString *self, DString *sub, daoint from, daoint n );
 
 DAO_DLL daoint DString_Find( DString *self, DString *chs, daoint start );
@@ -96,6 +102,8 @@ DAO_DLL daoint DString_FindChars( DString *self, const char *ch, daoint start );
 DAO_DLL daoint DString_RFindChars( DString *self, const char *ch, daoint start );
 DAO_DLL daoint DString_FindChar( DString *self, char ch, daoint start );
 DAO_DLL daoint DString_RFindChar( DString *self, char ch, daoint start );
+/* Find the first byte that is one of the "n" bytes in "set": */
+DAO_DLL daoint DString_FindCharSet( DString *self, const char *set, daoint n, daoint start );
 
 DAO_DLL int DString_Match( DString *self, const char *pat, daoint *start, daoint *end );
 DAO_DLL int DString_Change( DString *self, const char *pat, const char *target, int index );
@@ -136,4 +144,15 @@ DAO_DLL int DString_CompareUTF8( DString *left, DString *right );
 DAO_DLL void DString_AppendUInt16( DString *bytecodes, int value );
 DAO_DLL void DString_AppendUInt32( DString *bytecodes, uint_t value );
 
+/*
+// Formatting and parsing of numbers, with the same results as:
+// sprintf( buffer, "%lli", value ), sprintf( buffer, "%f" or "%g", value ),
+// strtoll( chars, NULL, 0 ) and strtod( chars, NULL ), respectively.
+// The buffer should have at least 32 bytes for integers and 320 for floats.
+*/
+DAO_DLL int Dao_FormatInteger( char *buffer, dao_integer value );
+DAO_DLL int Dao_FormatFloat( char *buffer, double value, char format );
+DAO_DLL dao_integer Dao_ParseInteger( const char *chars );
+DAO_DLL double Dao_ParseFloat( const char *chars );
+
 #endif
@@ -40,8 +40,18 @@
 #include"daoVmspace.h"
 #include"daoProcess.h"
 #include"daoGC.h"
+#include"daoOptimizer.h"
 #include"daoTasklet.h"
 
+#if defined(LINUX)
+#include<unistd.h>
+#include<sys/epoll.h>
+#define DAO_TASKLET_REACTOR
+#elif defined(UNIX)
+#include<poll.h>
+#define DAO_TASKLET_REACTOR
+#endif
+
 #define MIN_TIME  1E-27
 
 
@@ -51,19 +61,25 @@ enum DaoTaskletEventType
 	DAO_EVENT_WAIT_TASKLET   ,  /* Wait for another tasklet; */
 	DAO_EVENT_WAIT_RECEIVING ,  /* Wait for receiving from a channel; */
 	DAO_EVENT_WAIT_SENDING   ,  /* Wait after sending to a channel; */
-	DAO_EVENT_WAIT_SELECT       /* Wait for multiple futures or channels; */
+	DAO_EVENT_WAIT_SELECT    ,  /* Wait for multiple futures or channels; */
+	DAO_EVENT_WAIT_STREAM       /* Wait for a file descriptor to become ready; */
 };
 enum DaoTaskletEventState
 {
 	DAO_EVENT_WAIT ,
 	DAO_EVENT_RESUME  /* Ensure the processing of timed-out events; */
 };
+enum DaoTaskletEventParking
+{
+	DAO_EVENT_PARK_NONE ,     /* Not parked, in ::events or being handled; */
+	DAO_EVENT_PARK_WAITING ,  /* Parked in DaoTaskletServer::waiting; */
+	DAO_EVENT_PARK_TIMERS     /* Parked in DaoTaskletServer::timers; */
+};
 
 
 
 typedef struct DaoTaskletServer  DaoTaskletServer;
 typedef struct DaoTaskletThread  DaoTaskletThread;
-typedef struct DaoTaskletEvent   DaoTaskletEvent;
 
 
 /*
@@ -99,9 +115,25 @@ typedef struct DaoTaskletEvent   DaoTaskletEvent;
 //        type = DAO_EVENT_WAIT_SELECT;
 //        future = future value for the waiting tasklet;
 //        channel = NULL;
-//        channels = select list of channels;
+//        selects = select group of channels and futures;
+//    };
+//    The event is registered as a waiter in DaoChannel::selectors and
+//    DaoFuture::selectors of each member of the group. A source that becomes
+//    ready claims the event and records itself in DaoTaskletEvent::fired,
+//    so that the event is activated once and checks that source first;
+// 6. Waiting for a file descriptor to become readable or writable:
+//    DaoTaskletEvent {
+//        type = DAO_EVENT_WAIT_STREAM;
+//        future = future value for the waiting tasklet;
+//        channel = NULL;
+//        descriptor = file descriptor of the stream;
 //    };
 //
+// When a waiting event is not ready, it is parked in the timer wheel if it
+// has a timeout, otherwise in the waiting list of the server. The events of
+// the tasklets blocked on channels or future values are also queued in the
+// waiter queues of the channels or the future values, and are resumed from
+// there.
 */
 struct DaoTaskletEvent
 {
@@ -109,13 +141,94 @@ struct DaoTaskletEvent
 	uchar_t      state;
 	uchar_t      timeout;
 	uchar_t      auxiliary;
+	uchar_t      claimed;     /* the select event has been claimed by a source; */
+	uchar_t      parking;     /* DAO_EVENT_PARK_NONE/WAITING/TIMERS; */
+	uchar_t      registered;  /* registered as a waiter in the select group; */
+	short        watching;    /* DAO_STREAM_READABLE or DAO_STREAM_WRITABLE; */
+	int          descriptor;  /* file descriptor for a stream waiting event; */
 	double       expiring;  /* expiring time for a timeout event; */
+	double       since;     /* time when the tasklet started to wait; */
+	daoint       tick;      /* expiring tick in the timer wheel; */
 	DaoFuture   *future;
 	DaoChannel  *channel;
 	DaoValue    *message;
 	DaoValue    *selected;
 	DaoMap      *selects;  /* DHash<DaoFuture*|DaoChannel*,0|1>; */
+	void        *fired;    /* the member of the select group that claimed the event; */
 	DaoVmSpace  *vmspace;
+
+	DaoTaskletEvent   *prev;  /* neighbours in the timer wheel slot or parking list; */
+	DaoTaskletEvent   *next;
+	DaoTaskletEvent  **slot;  /* timer wheel slot or parking list holding the event; */
+
+	DaoTaskletEvent   *before;  /* neighbours in the waiter queue; */
+	DaoTaskletEvent   *after;
+	DaoTaskletQueue   *queue;   /* waiter queue holding the event; */
+};
+
+
+
+/*
+// Hierarchical timer wheel for timed waits.
+//
+// Time is divided into ticks of DAO_TIMER_TICK seconds. The first level
+// of the wheel has one slot per tick for the nearest DAO_TIMER_SLOTS0 ticks,
+// and each higher level has DAO_TIMER_SLOTS slots that each span a whole
+// round of the level below it. Timers in a higher level slot are cascaded
+// down when the current tick enters the span of the slot. Timers beyond
+// the range of the last level are parked in its farthest slot, and are
+// placed again when they are cascaded.
+//
+// Each slot is a doubly linked list of events, so that arming a timer and
+// cancelling it (when the event is resumed before the timeout) are O(1).
+// The wheel is advanced by the tasklet threads in their idle waiting loop,
+// and at the end of each time slice of the tasklets, so that the timeouts
+// are handled in time when all the threads are busy.
+*/
+#define DAO_TIMER_TICK    0.001
+#define DAO_TIMER_BITS0   8
+#define DAO_TIMER_BITS    6
+#define DAO_TIMER_LEVELS  4
+#define DAO_TIMER_SLOTS0  (1<<DAO_TIMER_BITS0)
+#define DAO_TIMER_SLOTS   (1<<DAO_TIMER_BITS)
+#define DAO_TIMER_TOTAL   (DAO_TIMER_SLOTS0 + (DAO_TIMER_LEVELS-1)*DAO_TIMER_SLOTS)
+
+typedef struct DaoTimerWheel DaoTimerWheel;
+
+struct DaoTimerWheel
+{
+	double  start;    /* time of the tick zero; */
+	daoint  current;  /* next tick to be processed; */
+	daoint  count;    /* number of timers in the wheel; */
+
+	DaoTaskletEvent  *slots[DAO_TIMER_TOTAL];
+};
+
+
+
+/*
+// Mailbox of an asynchronous object (actor).
+//
+// The method calls of an asynchronous object are executed one after another.
+// Only the first outstanding call of an actor is scheduled as an event,
+// and the following calls are queued in the mailbox of the actor, linked
+// through DaoTaskletEvent::next. When a call is done, the worker thread
+// takes the next call from the mailbox and runs it directly while it still
+// holds the actor, for up to daoConfig.mailbox calls in a row. After that,
+// the next call is scheduled as a normal event, so that the other tasklets
+// get their turns.
+//
+// A mailbox exists as long as the actor has an outstanding call.
+*/
+typedef struct DaoTaskletMailbox DaoTaskletMailbox;
+
+struct DaoTaskletMailbox
+{
+	daoint  size;  /* number of queued calls; */
+	daoint  peak;  /* maximum number of queued calls; */
+
+	DaoTaskletEvent  *head;
+	DaoTaskletEvent  *tail;
 };
 
 
@@ -123,19 +236,39 @@ struct DaoTaskletEvent
 #ifdef DAO_WITH_CONCURRENT
 
 
+static int DaoValue_CheckCtype( DaoValue *self, DaoType *type )
+{
+	if( self->type < DAO_CSTRUCT || self->type > DAO_CDATA ) return 0;
+	if( self->type != type->tid ) return 0;
+	return self->xCstruct.ctype->core == type->core;
+}
+
 DaoTaskletEvent* DaoTaskletEvent_New( DaoVmSpace *vmspace )
 {
 	DaoTaskletEvent *self = (DaoTaskletEvent*) dao_calloc( 1, sizeof(DaoTaskletEvent) );
 	self->vmspace = vmspace;
 	return self;
 }
+static void DaoTaskletEvent_Unregister( DaoTaskletEvent *self );
+
 void DaoTaskletEvent_Reset( DaoTaskletEvent *self )
 {
 	self->type = 0;
 	self->state = 0;
 	self->timeout = 0;
 	self->auxiliary = 0;
+	self->claimed = 0;
+	self->parking = 0;
+	self->watching = 0;
+	self->descriptor = -1;
 	self->expiring = -1.0;
+	self->tick = 0;
+	self->prev = self->next = NULL;
+	self->before = self->after = NULL;
+	self->slot = NULL;
+	self->queue = NULL;
+	self->fired = NULL;
+	if( self->registered ) DaoTaskletEvent_Unregister( self );
 	GC_DecRC( self->future );
 	GC_DecRC( self->channel );
 	GC_DecRC( self->selected );
@@ -158,6 +291,197 @@ void DaoTaskletEvent_Init( DaoTaskletEvent *self, int T, int S, DaoFuture *F, Da
 	GC_Assign( & self->channel, C );
 	self->type = T;
 	self->state = S;
+	self->since = Dao_GetCurrentTime();
+}
+static DMap** DaoTaskletEvent_GetSelectors( DaoTaskletEvent *self, DaoValue *source )
+{
+	if( DaoValue_CheckCtype( source, self->vmspace->typeChannel ) ){
+		return & ((DaoChannel*) source)->selectors;
+	}
+	return & ((DaoFuture*) source)->selectors;
+}
+/*
+// Register the select event as a waiter on each member of its select group,
+// when the event is parked because none of the members is ready.
+// Lock DaoTaskletServer::mutex before calling this and the next function.
+*/
+static void DaoTaskletEvent_Register( DaoTaskletEvent *self )
+{
+	DNode *it;
+	for(it=DaoMap_First(self->selects); it; it=DaoMap_Next(self->selects,it)){
+		DMap **selectors = DaoTaskletEvent_GetSelectors( self, it->key.pValue );
+		if( *selectors == NULL ) *selectors = DHash_New(0,0);
+		DMap_Insert( *selectors, self, NULL );
+	}
+	self->registered = 1;
+}
+static void DaoTaskletEvent_Unregister( DaoTaskletEvent *self )
+{
+	DNode *it;
+	for(it=DaoMap_First(self->selects); it; it=DaoMap_Next(self->selects,it)){
+		DMap *selectors = *DaoTaskletEvent_GetSelectors( self, it->key.pValue );
+		if( selectors != NULL ) DMap_Erase( selectors, self );
+	}
+	self->registered = 0;
+}
+/*
+// Append the event to a waiter queue, or remove it from the queue holding it.
+// Lock DaoTaskletServer::mutex before calling these functions.
+*/
+static void DaoTaskletEvent_Enqueue( DaoTaskletEvent *self, DaoTaskletQueue *queue )
+{
+	self->queue = queue;
+	self->before = queue->tail;
+	self->after = NULL;
+	if( queue->tail ){
+		queue->tail->after = self;
+	}else{
+		queue->head = self;
+	}
+	queue->tail = self;
+}
+static void DaoTaskletEvent_Dequeue( DaoTaskletEvent *self )
+{
+	DaoTaskletQueue *queue = self->queue;
+	if( queue == NULL ) return;
+	if( self->before ){
+		self->before->after = self->after;
+	}else{
+		queue->head = self->after;
+	}
+	if( self->after ){
+		self->after->before = self->before;
+	}else{
+		queue->tail = self->before;
+	}
+	self->before = self->after = NULL;
+	self->queue = NULL;
+}
+
+
+
+static void DaoTimerWheel_Init( DaoTimerWheel *self )
+{
+	memset( self, 0, sizeof(DaoTimerWheel) );
+	self->start = Dao_GetCurrentTime();
+}
+static void DaoTimerWheel_Place( DaoTimerWheel *self, DaoTaskletEvent *event )
+{
+	DaoTaskletEvent **slot = self->slots;
+	daoint tick = event->tick > self->current ? event->tick : self->current;
+	daoint delta = tick - self->current;
+	int level, shift = DAO_TIMER_BITS0;
+
+	if( delta < DAO_TIMER_SLOTS0 ){
+		slot += tick & (DAO_TIMER_SLOTS0 - 1);
+	}else{
+		slot += DAO_TIMER_SLOTS0;
+		for(level=1; level<DAO_TIMER_LEVELS-1; ++level){
+			if( delta < ((daoint)1 << (shift + DAO_TIMER_BITS)) ) break;
+			slot += DAO_TIMER_SLOTS;
+			shift += DAO_TIMER_BITS;
+		}
+		if( delta >= ((daoint)1 << (shift + DAO_TIMER_BITS)) ){
+			tick = self->current + ((daoint)1 << (shift + DAO_TIMER_BITS)) - 1;
+		}
+		slot += (tick >> shift) & (DAO_TIMER_SLOTS - 1);
+	}
+	event->slot = slot;
+	event->prev = NULL;
+	event->next = *slot;
+	if( *slot ) (*slot)->prev = event;
+	*slot = event;
+}
+static void DaoTimerWheel_Add( DaoTimerWheel *self, DaoTaskletEvent *event )
+{
+	event->tick = (daoint) ceil( (event->expiring - self->start) / DAO_TIMER_TICK );
+	DaoTimerWheel_Place( self, event );
+	self->count += 1;
+}
+static void DaoTimerWheel_Remove( DaoTimerWheel *self, DaoTaskletEvent *event )
+{
+	if( event->prev ){
+		event->prev->next = event->next;
+	}else{
+		*event->slot = event->next;
+	}
+	if( event->next ) event->next->prev = event->prev;
+	event->prev = event->next = NULL;
+	event->slot = NULL;
+	self->count -= 1;
+}
+/*
+// Iterate over the timers in the wheel in no particular order.
+// The next event should be obtained before removing the current one.
+*/
+static DaoTaskletEvent* DaoTimerWheel_Next( DaoTimerWheel *self, DaoTaskletEvent *event )
+{
+	DaoTaskletEvent **slot = self->slots;
+	DaoTaskletEvent **end = self->slots + DAO_TIMER_TOTAL;
+
+	if( event != NULL ){
+		if( event->next ) return event->next;
+		slot = event->slot + 1;
+	}
+	if( self->count == 0 ) return NULL;
+	for(; slot < end; ++slot) if( *slot ) return *slot;
+	return NULL;
+}
+/*
+// Advance the wheel to the time "now", and return the expired timers
+// as a list linked by DaoTaskletEvent::next.
+*/
+static DaoTaskletEvent* DaoTimerWheel_Advance( DaoTimerWheel *self, double now )
+{
+	DaoTaskletEvent *expired = NULL;
+	daoint last = (daoint) floor( (now - self->start) / DAO_TIMER_TICK );
+
+	if( self->count == 0 ){
+		if( last >= self->current ) self->current = last + 1;
+		return NULL;
+	}
+	while( self->current <= last && self->count ){
+		DaoTaskletEvent *event, **slot = self->slots + (self->current & (DAO_TIMER_SLOTS0 - 1));
+		daoint index = self->current & (DAO_TIMER_SLOTS0 - 1);
+		int level, shift = DAO_TIMER_BITS0;
+
+		for(level=1; level<DAO_TIMER_LEVELS && index == 0; ++level){
+			DaoTaskletEvent **upper = self->slots + DAO_TIMER_SLOTS0 + (level-1)*DAO_TIMER_SLOTS;
+			index = (self->current >> shift) & (DAO_TIMER_SLOTS - 1);
+			upper += index;
+			event = *upper;
+			*upper = NULL;
+			while( event ){
+				DaoTaskletEvent *next = event->next;
+				DaoTimerWheel_Place( self, event );
+				event = next;
+			}
+			shift += DAO_TIMER_BITS;
+		}
+		while( (event = *slot) != NULL ){
+			DaoTimerWheel_Remove( self, event );
+			event->next = expired;
+			expired = event;
+		}
+		self->current += 1;
+	}
+	if( self->count == 0 && last >= self->current ) self->current = last + 1;
+	return expired;
+}
+/*
+// Shorten the waiting time "wait" to the next expiring timer:
+*/
+static double DaoTimerWheel_Timeout( DaoTimerWheel *self, double now, double wait )
+{
+	daoint tick, last;
+	if( self->count == 0 ) return wait;
+	last = self->current + (daoint)( wait / DAO_TIMER_TICK );
+	for(tick=self->current; tick<=last; ++tick){
+		if( self->slots[ tick & (DAO_TIMER_SLOTS0 - 1) ] == NULL ) continue;
+		wait = self->start + tick * DAO_TIMER_TICK - now;
+		return wait > 0.0 ? wait : 0.0;
+	}
+	return wait;
 }
 
 
@@ -167,18 +491,41 @@ DaoChannel* DaoChannel_New( DaoVmSpace *vms, DaoType *type, int dtype )
 	DaoChannel *self = (DaoChannel*) dao_calloc( 1, sizeof(DaoChannel) );
 	if( dtype ) type = DaoType_Specialize( vms->typeChannel, & type, type != NULL );
 	DaoCstruct_Init( (DaoCstruct*) self, type );
-	self->buffer = DList_New( DAO_DATA_VALUE );
+	DMutex_Init( & self->mutex );
 	return self;
 }
 
-
-
-
-static int DaoValue_CheckCtype( DaoValue *self, DaoType *type )
+/*
+// Lock DaoChannel::mutex before calling the following functions.
+// The reference count of the data item is increased before pushing,
+// and should be decreased after popping, without holding the mutex.
+*/
+static void DaoChannel_Push( DaoChannel *self, DaoValue *value )
 {
-	if( self->type < DAO_CSTRUCT || self->type > DAO_CDATA ) return 0;
-	if( self->type != type->tid ) return 0;
-	return self->xCstruct.ctype->core == type->core;
+	if( self->size >= self->bufsize ){
+		daoint i, bufsize = 2*self->bufsize;
+		DaoValue **buffer;
+		if( bufsize == 0 ) bufsize = self->cap < 256 ? self->cap + 1 : 256;
+		buffer = (DaoValue**) dao_malloc( bufsize*sizeof(DaoValue*) );
+		for(i=0; i<self->size; ++i){
+			buffer[i] = self->buffer[ (self->head + i) % self->bufsize ];
+		}
+		dao_free( self->buffer );
+		self->buffer = buffer;
+		self->bufsize = bufsize;
+		self->head = 0;
+	}
+	self->buffer[ (self->head + self->size) % self->bufsize ] = value;
+	self->size += 1;
+}
+static DaoValue* DaoChannel_Pop( DaoChannel *self )
+{
+	DaoValue *value;
+	if( self->size == 0 ) return NULL;
+	value = self->buffer[ self->head ];
+	self->head = (self->head + 1) % self->bufsize;
+	self->size -= 1;
+	return value;
 }
 
 
@@ -186,6 +533,7 @@ static int DaoValue_CheckCtype( DaoValue *self, DaoType *type )
 
 
 
+
 struct DaoTaskletThread
 {
 	DaoTaskletServer  *server;
@@ -203,17 +551,17 @@ static void DaoTaskletThread_Run( DaoTaskletThread *self );
 
 struct DaoTaskletServer
 {
-	DThread  timer;
 	DMutex   mutex;
 	DCondVar condv;
-	DCondVar condv2;
 
 	volatile int finishing;
-	volatile int timing;
 	volatile int total;
 	volatile int vacant;  /* Not used; */
 	volatile int idle;    /* Not active; */
 	volatile int stopped;
+	volatile int selecting;  /* Number of unresolved select events; */
+	volatile int polling;    /* A thread is polling the file descriptors; */
+	int          reactor;    /* epoll instance on Linux, otherwise -1; */
 
 	DList  *threads;
 
@@ -221,15 +569,22 @@ struct DaoTaskletServer
 	DList  *parameters; /* list of void* */
 	DList  *owners;     /* list of void* */
 	DList  *events;     /* list of DaoTaskletEvent* */
-	DList  *events2;    /* list of DaoTaskletEvent* */
-	DMap   *waitings;   /* timed waiting: <dao_complex,DaoTaskletEvent*> */
 	DMap   *active;     /* map of DaoObject* or DaoProcess* keys */
-	DMap   *pending;    /* map of pointers from ::parameters, ::events and ::events2 */
+	DList  *iowaits;    /* list of DaoTaskletEvent*, waiting on file descriptors; */
+	DMap   *pending;    /* map of pointers from ::parameters, ::events, ::iowaits and the parked events */
+	DMap   *mailboxes;  /* map of DaoObject* (async actors) to DaoTaskletMailbox*; */
 
 	DList  *caches;
 
-	dao_complex   timestamp;  /* (time,index); */
-	DaoVmSpace   *vmspace;
+	DaoTimerWheel    timers;   /* timed waiting events; */
+	DaoTaskletEvent *waiting;  /* untimed waiting events, linked through ::next; */
+	daoint           parked;   /* number of events in ::waiting; */
+	uint_t           random;   /* state for randomizing the select order; */
+	DaoVmSpace      *vmspace;
+
+	DaoTaskletStats  stats;    /* counters and histograms, see DaoVmSpace_GetTaskletStats(); */
+	volatile int     logging;  /* print the states at the next chance; */
+	double           logtime;  /* time for the next periodic printing; */
 };
 
 static DaoTaskletThread* DaoTaskletThread_New( DaoTaskletServer *server, DThreadTask func, void *param )
@@ -252,35 +607,53 @@ static DaoTaskletServer* DaoTaskletServer_New( DaoVmSpace *vms )
 	DaoTaskletServer *self = (DaoTaskletServer*)dao_malloc( sizeof(DaoTaskletServer) );
 	DMutex_Init( & self->mutex );
 	DCondVar_Init( & self->condv );
-	DCondVar_Init( & self->condv2 );
-	DThread_Init( & self->timer );
 	self->finishing = 0;
-	self->timing = 0;
 	self->total = 0;
 	self->vacant = 0;
 	self->idle = 0;
 	self->stopped = 0;
+	self->selecting = 0;
+	self->polling = 0;
+	self->reactor = -1;
+#ifdef LINUX
+	self->reactor = epoll_create1( EPOLL_CLOEXEC );
+#endif
 	self->threads = DList_New(0);
 	self->functions = DList_New(0);
 	self->parameters = DList_New(0);
 	self->owners = DList_New(0);
 	self->events = DList_New(0);
-	self->events2 = DList_New(0);
-	self->waitings = DMap_New( DAO_DATA_COMPLEX, 0 );
+	self->iowaits = DList_New(0);
 	self->pending = DHash_New(0,0);
 	self->active = DHash_New(0,0);
+	self->mailboxes = DHash_New(0,0);
 	self->caches = DList_New(0);
 	self->vmspace = vms;
-	self->timestamp.real = 0.0;
-	self->timestamp.imag = 0.0;
+	self->waiting = NULL;
+	self->parked = 0;
+	self->random = (uint_t) time( NULL );
+	self->logging = 0;
+	self->logtime = Dao_GetCurrentTime() + daoConfig.tasklog;
+	memset( & self->stats, 0, sizeof(DaoTaskletStats) );
+	DaoTimerWheel_Init( & self->timers );
 	return self;
 }
 static void DaoTaskletServer_Delete( DaoTaskletServer *self )
 {
+	DNode *it;
 	daoint i;
 	for(i=0; i<self->threads->size; i++){
 		DaoTaskletThread_Delete( (DaoTaskletThread*)self->threads->items.pVoid[i] );
 	}
+	for(it=DMap_First(self->mailboxes); it; it=DMap_Next(self->mailboxes,it)){
+		DaoTaskletMailbox *mailbox = (DaoTaskletMailbox*) it->value.pVoid;
+		DaoTaskletEvent *event, *next;
+		for(event=mailbox->head; event; event=next){
+			next = event->next;
+			DaoTaskletEvent_Delete( event );
+		}
+		dao_free( mailbox );
+	}
 	for(i=0; i<self->caches->size; ++i){
 		DaoTaskletEvent_Delete( (DaoTaskletEvent*) self->caches->items.pVoid[i] );
 	}
@@ -289,35 +662,26 @@ static void DaoTaskletServer_Delete( DaoTaskletServer *self )
 	DList_Delete( self->parameters );
 	DList_Delete( self->owners );
 	DList_Delete( self->events );
-	DList_Delete( self->events2 );
+	DList_Delete( self->iowaits );
 	DList_Delete( self->caches );
-	DMap_Delete( self->waitings );
+#ifdef LINUX
+	if( self->reactor >= 0 ) close( self->reactor );
+#endif
 	DMap_Delete( self->pending );
 	DMap_Delete( self->active );
+	DMap_Delete( self->mailboxes );
 	DMutex_Destroy( & self->mutex );
 	DCondVar_Destroy( & self->condv );
-	DCondVar_Destroy( & self->condv2 );
-	DThread_Destroy( & self->timer );
 	dao_free( self );
 }
 
-static void DaoTaskletServer_Timer( DaoTaskletServer *self );
-
 static void DaoTaskletServer_Init( DaoVmSpace *vms )
 {
-	DaoTaskletServer *server;
-
 	DaoCGC_Start();
 
 	if( vms->taskletServer ) return;
 
-	server = DaoTaskletServer_New( vms );
-	/* Set it here, so that DaoVmSpace_StopTasklets() will not stop prematurally: */
-	server->timing = 1;
-	if( DThread_Start( & server->timer, (DThreadTask) DaoTaskletServer_Timer, server ) ==0 ){
-		dao_abort( "failed to create the timer thread" );
-	}
-	vms->taskletServer = server;
+	vms->taskletServer = DaoTaskletServer_New( vms );
 }
 
 static DaoTaskletServer* DaoTaskletServer_TryInit( DaoVmSpace *vms )
@@ -356,7 +720,7 @@ void DaoVmSpace_AddTaskletThread( DaoVmSpace *self, DThreadTask func, void *para
 	server->total += 1;
 	DList_Append( server->threads, taskthd );
 	DMutex_Unlock( & server->mutex );
-	if( DThread_Start( & taskthd->thread, (DThreadTask) DaoTaskletThread_Run, taskthd ) == 0 ){
+	if( DThread_StartPlaced( & taskthd->thread, (DThreadTask) DaoTaskletThread_Run, taskthd ) == 0 ){
 		if( func != NULL || server->total == 0 ){
 			dao_abort( "failed to create a task thread" );
 		}
@@ -385,7 +749,7 @@ static int DaoTaskletEvent_CheckSelect( DaoTaskletEvent *self )
 	for(it=DaoMap_First(self->selects); it; it=DaoMap_Next(self->selects,it)){
 		if( DaoValue_CheckCtype( it->key.pValue, chatype ) ){
 			DaoChannel *chan = (DaoChannel*) it->key.pValue;
-			move = chan->buffer->size > 0;
+			move = chan->size > 0;
 			closed += chan->cap == 0;
 		}else{
 			DaoFuture *fut = (DaoFuture*) it->key.pValue;
@@ -397,48 +761,123 @@ static int DaoTaskletEvent_CheckSelect( DaoTaskletEvent *self )
 	return move;
 }
 
+/*
+// Check if the parked event can be resumed; used to detect deadlocks.
+*/
+static int DaoTaskletEvent_CheckWaiting( DaoTaskletEvent *self )
+{
+	DaoChannel *chan = self->channel;
+	DaoFuture *fut = self->future;
+
+	switch( self->type ){
+	case DAO_EVENT_WAIT_TASKLET :
+		return fut->precond == NULL || fut->precond->state == DAO_TASKLET_FINISHED;
+	case DAO_EVENT_WAIT_RECEIVING :
+		return chan->size > 0 || chan->cap <= 0;
+	case DAO_EVENT_WAIT_SENDING :
+		return chan->size < chan->cap;
+	case DAO_EVENT_WAIT_SELECT :
+		return DaoTaskletEvent_CheckSelect( self );
+	default : break;
+	}
+	return 0;
+}
+
+/*
+// Park a waiting event that is not ready in the timer wheel if it has
+// a timeout, or in the ::waiting list otherwise, and queue it in the waiter
+// queue of the channel or future it is blocked on. Unparking removes it from both,
+// and moves it to ::events to be resumed.
+// Lock self::mutex before calling these functions.
+*/
+static void DaoTaskletServer_Park( DaoTaskletServer *self, DaoTaskletEvent *event )
+{
+	switch( event->type ){
+	case DAO_EVENT_WAIT_TASKLET :
+		if( event->future->precond == NULL ) break;
+		DaoTaskletEvent_Enqueue( event, & event->future->precond->waiters );
+		break;
+	case DAO_EVENT_WAIT_RECEIVING :
+		DaoTaskletEvent_Enqueue( event, & event->channel->receiving );
+		break;
+	case DAO_EVENT_WAIT_SENDING :
+		DaoTaskletEvent_Enqueue( event, & event->channel->sending );
+		break;
+	default : break;
+	}
+	if( event->expiring >= MIN_TIME ){
+		event->parking = DAO_EVENT_PARK_TIMERS;
+		DaoTimerWheel_Add( & self->timers, event );
+		return;
+	}
+	event->parking = DAO_EVENT_PARK_WAITING;
+	event->slot = & self->waiting;
+	event->prev = NULL;
+	event->next = self->waiting;
+	if( self->waiting ) self->waiting->prev = event;
+	self->waiting = event;
+	self->parked += 1;
+}
+static void DaoTaskletServer_Unpark( DaoTaskletServer *self, DaoTaskletEvent *event )
+{
+	DaoTaskletEvent_Dequeue( event );
+	switch( event->parking ){
+	case DAO_EVENT_PARK_WAITING :
+		if( event->prev ){
+			event->prev->next = event->next;
+		}else{
+			self->waiting = event->next;
+		}
+		if( event->next ) event->next->prev = event->prev;
+		event->prev = event->next = NULL;
+		event->slot = NULL;
+		self->parked -= 1;
+		break;
+	case DAO_EVENT_PARK_TIMERS :
+		DaoTimerWheel_Remove( & self->timers, event );
+		break;
+	default : return;
+	}
+	event->parking = DAO_EVENT_PARK_NONE;
+	DList_Append( self->events, event );
+}
+/*
+// Claim the select event for its group member "source" which has become
+// ready, and activate the event if it is parked. Each event is claimed
+// once until it is parked again, so the other ready members do not need
+// to activate it again. Return 1 if the event is claimed by this call.
+// Lock self::mutex before calling this function.
+*/
+static int DaoTaskletServer_ClaimSelect( DaoTaskletServer *self, DaoTaskletEvent *event, void *source )
+{
+	if( event->claimed ) return 0;
+	event->claimed = 1;
+	event->fired = source;
+	DaoTaskletServer_Unpark( self, event );
+	return 1;
+}
+
 static void DaoTaskletServer_ActivateEvents( DaoTaskletServer *self )
 {
+	DaoTaskletEvent *event, *next;
 	char message[128];
-	daoint i, j, count = 0;
+	daoint count = 0;
 
 	if( self->finishing == 0 ) return;
 	if( self->idle != self->total ) return;
 	if( self->events->size != 0 ) return;
-	if( self->events2->size == 0 ) return;
+	if( self->parked == 0 ) return;
 
 #ifdef DEBUG
 	sprintf( message, "WARNING: try activating events (%i,%i,%i,%i)!\n", self->total,
-			self->idle, (int)self->events->size, (int)self->events2->size );
+			self->idle, (int)self->events->size, (int)self->parked );
 	DaoStream_WriteChars( self->vmspace->errorStream, message );
 #endif
-	for(i=0; i<self->events2->size; ++i){
-		DaoTaskletEvent *event = (DaoTaskletEvent*) self->events2->items.pVoid[i];
-		DaoChannel *chan = event->channel;
-		DaoFuture *fut = event->future;
-		int move = 0, closed = 0;
-		switch( event->type ){
-		case DAO_EVENT_WAIT_TASKLET :
-			move = fut->precond == NULL || fut->precond->state == DAO_TASKLET_FINISHED;
-			break;
-		case DAO_EVENT_WAIT_RECEIVING :
-			move = chan->buffer->size > 0;
-			if( chan->cap <= 0 && chan->buffer->size == 0 ) move = 1;
-			break;
-		case DAO_EVENT_WAIT_SENDING :
-			move = chan->buffer->size < chan->cap;
-			break;
-		case DAO_EVENT_WAIT_SELECT :
-			if( event->selects == NULL ) continue;
-			move = DaoTaskletEvent_CheckSelect( event );
-			break;
-		default: break;
-		}
-		if( move ){
-			DList_Append( self->events, event );
-			DList_Erase( self->events2, i, 1 );
+	for(event=self->waiting; event; event=next){
+		next = event->next;
+		if( DaoTaskletEvent_CheckWaiting( event ) ){
+			DaoTaskletServer_Unpark( self, event );
 			count += 1;
-			i -= 1;
 		}
 	}
 	DCondVar_Signal( & self->condv );
@@ -451,48 +890,90 @@ static void DaoTaskletServer_ActivateEvents( DaoTaskletServer *self )
 		exit(1);
 	}
 }
-static void DaoTaskletServer_Timer( DaoTaskletServer *self )
+/* Lock self::mutex before calling this function: */
+static void DaoTaskletServer_ExpireTimers( DaoTaskletServer *self )
 {
-	double time = 0.0;
-	daoint i, timeout;
+	DaoTaskletEvent *event, *next;
+
+	if( self->timers.count == 0 ) return;
+
+	event = DaoTimerWheel_Advance( & self->timers, Dao_GetCurrentTime() );
+	if( event == NULL ) return;
+	for(; event; event=next){
+		next = event->next;
+		event->next = NULL;
+		DaoTaskletEvent_Dequeue( event );
+		event->parking = DAO_EVENT_PARK_NONE;
+		event->state = DAO_EVENT_RESUME;
+		event->timeout = 1;
+		event->expiring = MIN_TIME;
+		DList_Append( self->events, event );
+	}
+	DCondVar_Signal( & self->condv );
+}
+#ifdef DAO_TASKLET_REACTOR
+/* Lock self::mutex before calling this function: */
+static void DaoTaskletServer_ResumeStream( DaoTaskletServer *self, DaoTaskletEvent *event )
+{
+	daoint i;
+	for(i=0; i<self->iowaits->size; ++i){
+		if( self->iowaits->items.pVoid[i] == event ) break;
+	}
+	DList_Erase( self->iowaits, i, 1 );
+	event->state = DAO_EVENT_RESUME;
+	DList_Append( self->events, event );
+}
+/*
+// Wait for the file descriptors of the suspended stream operations,
+// and move the events of the ready ones to ::events for resuming.
+// Lock self::mutex before calling this function. It is unlocked during
+// the waiting, so that the other threads can add and handle events.
+*/
+static void DaoTaskletServer_PollEvents( DaoTaskletServer *self, double wait )
+{
+	int i, count, timeout = (int) ceil( 1E3 * wait );
+#ifdef LINUX
+	struct epoll_event ready[64];
 
-	while( self->finishing == 0 || self->stopped != self->total ){
-		DMutex_Lock( & self->mutex );
-		while( self->waitings->size == 0 ){
-			if( self->idle == self->total && self->events2->size ){
-				DaoTaskletServer_ActivateEvents( self );
-			}
-			if( self->finishing && self->stopped == self->total ) break;
-			DCondVar_TimedWait( & self->condv2, & self->mutex, 0.01 );
-		}
-		if( self->waitings->size ){
-			DNode *node = DMap_First( self->waitings );
-			time = node->key.pComplex->real;
-			time -= Dao_GetCurrentTime();
-			/* wait the right amount of time for the closest arriving timeout: */
-			if( time > 0 ) DCondVar_TimedWait( & self->condv2, & self->mutex, time );
-		}
-		DMutex_Unlock( & self->mutex );
-		if( self->finishing && self->stopped == self->total ) break;
-
-		DMutex_Lock( & self->mutex );
-		if( self->waitings->size ){ /* a new wait timed out: */
-			DNode *node = DMap_First( self->waitings );
-			time = Dao_GetCurrentTime();
-			if( node->key.pComplex->real < time ){
-				DaoTaskletEvent *event = (DaoTaskletEvent*) node->value.pVoid;
-				event->state = DAO_EVENT_RESUME;
-				event->timeout = 1;
-				event->expiring = MIN_TIME;
-				DList_Append( self->events, node->value.pVoid );
-				DMap_EraseNode( self->waitings, node );
-			}
-		}
-		DCondVar_Signal( & self->condv );
-		DMutex_Unlock( & self->mutex );
+	if( timeout < 0 ) timeout = 0;
+	self->polling = 1;
+	DMutex_Unlock( & self->mutex );
+	count = epoll_wait( self->reactor, ready, 64, timeout );
+	DMutex_Lock( & self->mutex );
+	self->polling = 0;
+	for(i=0; i<count; ++i){
+		DaoTaskletEvent *event = (DaoTaskletEvent*) ready[i].data.ptr;
+		epoll_ctl( self->reactor, EPOLL_CTL_DEL, event->descriptor, NULL );
+		DaoTaskletServer_ResumeStream( self, event );
+	}
+#else
+	DaoTaskletEvent **events;
+	struct pollfd *fds;
+	int size = self->iowaits->size;
+
+	if( timeout < 0 ) timeout = 0;
+	fds = (struct pollfd*) dao_malloc( size*(sizeof(struct pollfd) + sizeof(void*)) );
+	events = (DaoTaskletEvent**) (fds + size);
+	for(i=0; i<size; ++i){
+		events[i] = (DaoTaskletEvent*) self->iowaits->items.pVoid[i];
+		fds[i].fd = events[i]->descriptor;
+		fds[i].events = events[i]->watching == DAO_STREAM_WRITABLE ? POLLOUT : POLLIN;
+		fds[i].revents = 0;
 	}
-	self->timing = 0;
+	self->polling = 1;
+	DMutex_Unlock( & self->mutex );
+	count = poll( fds, size, timeout );
+	DMutex_Lock( & self->mutex );
+	self->polling = 0;
+	/* Only this thread removes events from ::iowaits: */
+	for(i=0; i<size && count > 0; ++i){
+		if( fds[i].revents ) DaoTaskletServer_ResumeStream( self, events[i] );
+	}
+	dao_free( fds );
+#endif
+	if( count > 0 ) DCondVar_Signal( & self->condv );
 }
+#endif
 
 void DaoVmSpace_AddTaskletJob( DaoVmSpace *self, DThreadTask func, void *param, void *proc )
 {
@@ -530,6 +1011,38 @@ static void DaoVmSpace_AddEvent( DaoVmSpace *self, DaoTaskletEvent *event )
 	DMutex_Unlock( & server->mutex );
 	DaoVmSpace_TryAddTaskletThread( self, NULL, NULL, server->pending->size );
 }
+/*
+// Queue the call event in the mailbox of its actor, if the actor has
+// another outstanding call. Return zero if the event is not queued,
+// in which case it should be scheduled as a normal event.
+*/
+static int DaoVmSpace_PostMail( DaoVmSpace *self, DaoTaskletEvent *event )
+{
+	DaoTaskletServer *server = DaoTaskletServer_TryInit( self );
+	DaoObject *actor = event->future->actor->rootObject;
+	DaoTaskletMailbox *mailbox;
+	DNode *it;
+
+	DMutex_Lock( & server->mutex );
+	it = DMap_Find( server->mailboxes, actor );
+	if( it == NULL ){
+		mailbox = (DaoTaskletMailbox*) dao_calloc( 1, sizeof(DaoTaskletMailbox) );
+		DMap_Insert( server->mailboxes, actor, mailbox );
+		DMutex_Unlock( & server->mutex );
+		return 0;
+	}
+	mailbox = (DaoTaskletMailbox*) it->value.pVoid;
+	if( mailbox->tail ){
+		mailbox->tail->next = event;
+	}else{
+		mailbox->head = event;
+	}
+	mailbox->tail = event;
+	mailbox->size += 1;
+	if( mailbox->size > mailbox->peak ) mailbox->peak = mailbox->size;
+	DMutex_Unlock( & server->mutex );
+	return 1;
+}
 #endif
 
 void DaoProcess_ReturnFutureValue( DaoProcess *self, DaoFuture *future )
@@ -627,6 +1140,9 @@ void DaoVmSpace_AddTaskletCall( DaoVmSpace *self, DaoProcess *caller )
 	DaoProcess_PopFrame( caller );
 	DaoProcess_PutValue( caller, (DaoValue*) future );
 
+	if( future->actor && future->actor->rootObject->isAsync ){
+		if( DaoVmSpace_PostMail( self, event ) ) return;
+	}
 	DaoVmSpace_AddEvent( self, event );
 #else
 	DaoProcess_PopFrame( caller );
@@ -679,19 +1195,17 @@ void DaoTaskletServer_AddTimedWait( DaoTaskletServer *self, DaoProcess *wait, Da
 	*/
 	DaoProcess_MarkActiveTasklet( wait, 1 );
 
+	/*
+	// The event is checked by the scheduler before it is moved to the
+	// waiting lists, because the channel or future may have become ready
+	// after the waiting tasklet checked it but before the event is added.
+	// Sending and receiving on channels do not lock the server in the
+	// fast paths, so they cannot activate an event that is not added yet.
+	*/
 	DMutex_Lock( & self->mutex );
-	if( timeout >= 1E-27 ){
-		self->timestamp.real = timeout + Dao_GetCurrentTime();
-		self->timestamp.imag += 1;
-		event->expiring = self->timestamp.real;
-		DMap_Insert( self->waitings, & self->timestamp, event );
-		DMap_Insert( self->pending, event, NULL );
-		DCondVar_Signal( & self->condv2 );
-	}else{
-		event->expiring = -1.0;
-		DaoTaskletServer_AddEvent( self, event );
-		DCondVar_Signal( & self->condv );
-	}
+	event->expiring = timeout >= MIN_TIME ? timeout + Dao_GetCurrentTime() : -1.0;
+	DaoTaskletServer_AddEvent( self, event );
+	DCondVar_Signal( & self->condv );
 	DMutex_Unlock( & self->mutex );
 }
 
@@ -710,104 +1224,329 @@ void DaoVmSpace_AddTaskletWait( DaoVmSpace *self, DaoProcess *wait, DaoFuture *p
 	DaoTaskletServer_AddTimedWait( server, wait, event, timeout );
 }
 
-static int DaoTaskletServer_CheckEvent( DaoTaskletEvent *event, DaoFuture *fut, DaoChannel *chan )
-{
-	DaoTaskletEvent event2 = *event;
-	daoint i, move = 0, closed = 0;
-	switch( event->type ){
-	case DAO_EVENT_WAIT_TASKLET :
-		move = event->future->precond == fut;
-		break;
-	case DAO_EVENT_WAIT_RECEIVING :
-		if( event->channel == chan ){
-			move = chan->buffer->size > 0;
-			move |= chan->cap <= 0 && chan->buffer->size == 0;
-		}
-		break;
-	case DAO_EVENT_WAIT_SENDING :
-		move = event->channel == chan && chan->buffer->size < chan->cap;
-		break;
-	case DAO_EVENT_WAIT_SELECT :
-		if( event->selects == NULL ) break;
-		if( fut  ) move |= DMap_Find( event->selects->value, fut ) != NULL;
-		if( chan ) move |= DMap_Find( event->selects->value, chan ) != NULL;
-		//move = DaoTaskletEvent_CheckSelect( event );
-		break;
-	default: break;
-	}
-	return move;
-}
-/*
-// Only activate one event per channel:
-*/
-void DaoChannel_ActivateEvent( DaoChannel *self, int type, DaoTaskletServer *server )
+int DaoVmSpace_AddTaskletPoll( DaoVmSpace *self, DaoProcess *wait, int fd, int mode )
 {
-	DNode *node;
-	daoint i;
+#ifdef DAO_TASKLET_REACTOR
+	DaoTaskletEvent *event;
+	DaoTaskletServer *server;
+	DaoFuture *future;
+	int ok = 1;
 
-	for(i=0; i<server->events2->size; ++i){
-		DaoTaskletEvent *event = (DaoTaskletEvent*) server->events2->items.pVoid[i];
-		if( event->type != type ) continue;
-		if( DaoTaskletServer_CheckEvent( event, NULL, self ) ){
-			DList_Append( server->events, event );
-			DList_Erase( server->events2, i, 1 );
-			return;
-		}
+	/* Nested executions (such as callbacks from C functions) cannot be suspended: */
+	if( fd < 0 || wait->depth > 1 ) return 0;
+
+	server = DaoTaskletServer_TryInit( self );
+#ifdef LINUX
+	if( server->reactor < 0 ) return 0;
+#endif
+
+	future = DaoProcess_GetInitFuture( wait );
+	event = DaoTaskletServer_MakeEvent( server );
+	DaoTaskletEvent_Init( event, DAO_EVENT_WAIT_STREAM, DAO_EVENT_WAIT, future, NULL );
+	event->descriptor = fd;
+	event->watching = mode;
+
+	DMutex_Lock( & server->mutex );
+#ifdef LINUX
+	{
+		struct epoll_event ev;
+		ev.events = (mode == DAO_STREAM_WRITABLE ? EPOLLOUT : EPOLLIN) | EPOLLONESHOT;
+		ev.data.ptr = event;
+		/* Fail for regular files, or descriptors already watched by other tasklets: */
+		ok = epoll_ctl( server->reactor, EPOLL_CTL_ADD, fd, & ev ) == 0;
 	}
-	for(node=DMap_First(server->waitings); node; node=DMap_Next(server->waitings,node)){
-		DaoTaskletEvent *event = (DaoTaskletEvent*) node->value.pValue;
-		if( event->type != type ) continue;
-		if( DaoTaskletServer_CheckEvent( event, NULL, self ) ){
-			DList_Append( server->events, event );
-			DMap_EraseNode( server->waitings, node );
-			return;
+#endif
+	if( ok ){
+		/*
+		// Mark the process as active before the event can be handled by
+		// the polling thread, for the same reason as in AddTimedWait():
+		*/
+		DMap_Insert( server->active, wait, NULL );
+		wait->active = 1;
+		wait->status = DAO_PROCESS_SUSPENDED;
+		wait->pauseType = DAO_PAUSE_STREAM_WAIT;
+		DList_Append( server->iowaits, event );
+		DMap_Insert( server->pending, event, NULL );
+		DCondVar_Signal( & server->condv );
+	}else{
+		DaoTaskletServer_CacheEvent( server, event );
+	}
+	DMutex_Unlock( & server->mutex );
+	return ok;
+#else
+	return 0;
+#endif
+}
+
+/*
+// Activate the first tasklet waiting to receive from (or after sending to)
+// the channel, if the channel is ready for it. Only one event is activated
+// per call, and the waiters are resumed in the order they started waiting.
+// Lock server::mutex before calling this function.
+*/
+void DaoChannel_ActivateEvent( DaoChannel *self, int type, DaoTaskletServer *server )
+{
+	DaoTaskletEvent *event;
+
+	if( type == DAO_EVENT_WAIT_SELECT ){
+		DNode *it;
+		if( self->selectors == NULL ) return;
+		for(it=DMap_First(self->selectors); it; it=DMap_Next(self->selectors,it)){
+			event = (DaoTaskletEvent*) it->key.pVoid;
+			if( DaoTaskletServer_ClaimSelect( server, event, self ) ) return;
 		}
+		return;
+	}
+
+	if( type == DAO_EVENT_WAIT_RECEIVING ){
+		event = self->receiving.head;
+		if( event == NULL || (self->size == 0 && self->cap > 0) ) return;
+	}else{
+		event = self->sending.head;
+		if( event == NULL || self->size >= self->cap ) return;
 	}
+	DaoTaskletServer_Unpark( server, event );
 }
 
+static void DaoTaskletServer_ActivateFuture( DaoTaskletServer *self, DaoFuture *future );
+
 /*
-// Activate all events waiting on a future value:
+// Resolve the continuation "next" after its precondition "pre" is done;
+// Lock self::mutex before calling this function:
 */
-void DaoFuture_ActivateEvent( DaoFuture *self, DaoVmSpace *vmspace )
+static void DaoTaskletServer_ResolveFuture( DaoTaskletServer *self, DaoFuture *next, DaoFuture *pre )
 {
-	DaoTaskletServer *server = DaoTaskletServer_TryInit( vmspace );
-	DList *array = DList_New(0);
-	DNode *node;
+	DaoType *type = next->ctype;
+	DaoTaskletEvent *event;
+	DaoProcess *clone;
+	DaoVmCode *sect;
+	DaoList *list;
 	daoint i;
 
-	DMutex_Lock( & server->mutex );
-	for(i=0; i<server->events2->size; ++i){
-		DaoTaskletEvent *event = (DaoTaskletEvent*) server->events2->items.pVoid[i];
-		if( DaoTaskletServer_CheckEvent( event, self, NULL ) ){
-			event->state = DAO_EVENT_RESUME;
-			DList_Append( server->events, event );
-			DList_Erase( server->events2, i, 1 );
-			i -= 1;
+	if( next->state != DAO_TASKLET_PAUSED ) return;
+
+	type = type && type->args->size ? type->args->items.pType[0] : NULL;
+	switch( next->continuation ){
+	case DAO_FUTURE_THEN :
+		if( pre->state == DAO_TASKLET_ABORTED ) break;
+		/* Pass the value to the code section, and start the tasklet: */
+		clone = next->process;
+		sect = clone->topFrame->codes + clone->topFrame->entry - 1;
+		if( sect->b > 0 ) DaoProcess_SetValue( clone, sect->a, pre->value );
+		event = (DaoTaskletEvent*) DList_PopBack( self->caches );
+		if( event == NULL ) event = DaoTaskletEvent_New( self->vmspace );
+		DaoTaskletEvent_Init( event, DAO_EVENT_RESUME_TASKLET, DAO_EVENT_RESUME, next, NULL );
+		DaoTaskletServer_AddEvent( self, event );
+		return;
+	case DAO_FUTURE_ALL :
+		if( pre->state == DAO_TASKLET_ABORTED ) break;
+		if( (--next->count) > 0 ) return;
+		list = DaoList_New();
+		if( type && type->tid == DAO_LIST ) GC_Assign( & list->ctype, type );
+		for(i=0; i<next->preconds->value->size; ++i){
+			DaoFuture *fut = (DaoFuture*) next->preconds->value->items.pValue[i];
+			DaoList_Append( list, fut->value );
+		}
+		GC_Assign( & next->value, list );
+		next->state = DAO_TASKLET_FINISHED;
+		DaoTaskletServer_ActivateFuture( self, next );
+		return;
+	case DAO_FUTURE_ANY :
+		next->count -= 1;
+		if( pre->state == DAO_TASKLET_FINISHED ){
+			DaoValue_Move( pre->value, & next->value, type );
+			next->state = DAO_TASKLET_FINISHED;
+			DaoTaskletServer_ActivateFuture( self, next );
+			return;
 		}
+		if( next->count > 0 ) return;
+		break;
+	default : return;
+	}
+	next->state = DAO_TASKLET_ABORTED;
+	DaoTaskletServer_ActivateFuture( self, next );
+}
+/*
+// Resolve the continuation "next" now if "pre" is already done,
+// otherwise register it to be resolved when "pre" is done;
+// Lock self::mutex before calling this function:
+*/
+static void DaoTaskletServer_AddContinuation( DaoTaskletServer *self, DaoFuture *pre, DaoFuture *next )
+{
+	if( pre->state == DAO_TASKLET_FINISHED || pre->state == DAO_TASKLET_ABORTED ){
+		DaoTaskletServer_ResolveFuture( self, next, pre );
+		return;
 	}
-	for(node=DMap_First(server->waitings); node; node=DMap_Next(server->waitings,node)){
-		DaoTaskletEvent *event = (DaoTaskletEvent*) node->value.pValue;
-		/* remove from timed waiting list: */
-		if( DaoTaskletServer_CheckEvent( event, self, NULL ) ){
+	/* Not scanned by GC, because it is updated by different threads: */
+	if( pre->nexts == NULL ) pre->nexts = DList_New(0);
+	DList_Append( pre->nexts, next );
+	GC_IncRC( next );
+}
+/*
+// Activate all events waiting on a future value, and resolve its continuations;
+// Lock self::mutex before calling this function:
+*/
+static void DaoTaskletServer_ActivateFuture( DaoTaskletServer *self, DaoFuture *future )
+{
+	DaoTaskletEvent *event;
+	DList *nexts = future->nexts;
+	daoint i;
+
+	if( future->state == DAO_TASKLET_FINISHED ){
+		if( future->selectors ){
+			DNode *it = DMap_First( future->selectors );
+			for(; it; it=DMap_Next(future->selectors,it)){
+				event = (DaoTaskletEvent*) it->key.pVoid;
+				DaoTaskletServer_ClaimSelect( self, event, future );
+			}
+		}
+		while( (event = future->waiters.head) != NULL ){
 			event->state = DAO_EVENT_RESUME;
-			DList_Append( server->events, event );
-			DList_Append( array, node->key.pVoid );
+			DaoTaskletServer_Unpark( self, event );
 		}
 	}
-	for(i=0; i<array->size; i++) DMap_Erase( server->waitings, array->items.pVoid[i] );
+	if( nexts == NULL ) return;
+
+	future->nexts = NULL;
+	for(i=0; i<nexts->size; ++i){
+		DaoFuture *cont = (DaoFuture*) nexts->items.pVoid[i];
+		DaoTaskletServer_ResolveFuture( self, cont, future );
+		GC_DecRC( cont );
+	}
+	DList_Delete( nexts );
+}
+/*
+// Activate all events waiting on a future value, which has finished or aborted:
+*/
+void DaoFuture_ActivateEvent( DaoFuture *self, DaoVmSpace *vmspace )
+{
+	DaoTaskletServer *server = DaoTaskletServer_TryInit( vmspace );
+
+	DMutex_Lock( & server->mutex );
+	DaoTaskletServer_ActivateFuture( server, self );
 	DCondVar_Signal( & server->condv );
 	DMutex_Unlock( & server->mutex );
-	DList_Delete( array );
 }
-static DaoFuture* DaoTaskletServer_GetNextFuture( DaoTaskletServer *self )
+/*
+// When the threads are placed on CPUs, prefer the tasklets that last ran
+// on the current thread, so that they are resumed with warm CPU caches
+// (and memory on the local NUMA node). Only the first few events are
+// checked to keep the scheduling fair and cheap.
+*/
+#define DAO_TASKLET_AFFINITY_SCAN  8
+
+static void DaoTaskletServer_PreferRunner( DaoTaskletServer *self, void *runner )
+{
+	DList *events = self->events;
+	daoint i, n = events->size < DAO_TASKLET_AFFINITY_SCAN ? events->size : DAO_TASKLET_AFFINITY_SCAN;
+
+	for(i=1; i<n; ++i){
+		DaoTaskletEvent *event = (DaoTaskletEvent*) events->items.pVoid[i];
+		if( event->future->runner != runner ) continue;
+		DList_Erase( events, i, 1 );
+		DList_PushFront( events, event );
+		return;
+	}
+}
+/*
+// Index of the histogram bucket for the time span in seconds:
+*/
+static int DaoTasklet_Bucket( double span )
+{
+	double limit = 1E-5;
+	int i = 0;
+	while( i < DAO_TASKLET_HISTOGRAM - 1 && span >= limit ){
+		limit *= 10.0;
+		i += 1;
+	}
+	return i;
+}
+/* Lock self::mutex before calling this function: */
+static DaoFuture* DaoTaskletServer_TakeEvent( DaoTaskletServer *self, DaoTaskletEvent *event )
+{
+	DaoFuture *future = event->future;
+	DaoObject *actor = future->actor;
+	double wait = Dao_GetCurrentTime() - event->since;
+
+	future->waittime += wait;
+	self->stats.waittime += wait;
+	self->stats.waithist[ DaoTasklet_Bucket( wait ) ] += 1;
+
+	if( actor ){
+		void *value = actor->rootObject->isAsync ? future : NULL;
+		DMap_Insert( self->active, actor->rootObject, value );
+	}
+	if( future->process ){
+		DMap_Insert( self->active, future->process, NULL );
+		future->process->active = 1;
+	}
+
+	/*
+	// DaoValue_Move() should be used instead of GC_Assign() for thread safety.
+	// Because using GC_Assign() here, may caused "future->message" of primitive
+	// type being deleted, right after DaoFuture_HandleGC() has retrieved it
+	// for GC scanning.
+	 */
+	DaoValue_Move( event->message, & future->message, NULL );
+	DaoValue_Move( event->selected, & future->selected, NULL );
+	future->aux1 = event->auxiliary;
+	future->timeout = event->timeout;
+
+	GC_IncRC( future ); /* To be decreased at the end of tasklet; */
+	DaoTaskletServer_CacheEvent( self, event );
+	return future;
+}
+/*
+// Take the next call from the mailbox of the actor after its current call
+// is done. The call is returned to be run directly by the current thread,
+// unless "batch" calls have been run in a row, in which case it is scheduled
+// as a normal event. The actor is released if there is no call to run.
+// Lock self::mutex before calling this function.
+*/
+static DaoFuture* DaoTaskletServer_NextMail( DaoTaskletServer *self, DaoObject *actor, int batch )
+{
+	DaoTaskletMailbox *mailbox;
+	DaoTaskletEvent *event;
+	DNode *it = DMap_Find( self->mailboxes, actor );
+	int limit = daoConfig.mailbox > 0 ? daoConfig.mailbox : 1;
+
+	if( it == NULL ){
+		DMap_Erase( self->active, actor );
+		return NULL;
+	}
+	mailbox = (DaoTaskletMailbox*) it->value.pVoid;
+	event = mailbox->head;
+	if( event == NULL ){
+		DMap_Erase( self->mailboxes, actor );
+		DMap_Erase( self->active, actor );
+		dao_free( mailbox );
+		return NULL;
+	}
+	mailbox->head = event->next;
+	if( mailbox->head == NULL ) mailbox->tail = NULL;
+	mailbox->size -= 1;
+	event->next = NULL;
+	if( batch >= limit ){
+		DMap_Erase( self->active, actor );
+		DaoTaskletServer_AddEvent( self, event );
+		DCondVar_Signal( & self->condv );
+		return NULL;
+	}
+	return DaoTaskletServer_TakeEvent( self, event );
+}
+static DaoFuture* DaoTaskletServer_GetNextFuture( DaoTaskletServer *self, void *runner )
 {
 	DaoFuture *first, *future, *precond;
 	DList *events = self->events;
 	DMap *pending = self->pending;
 	DMap *active = self->active;
 	DNode *it;
-	daoint i, j;
+	daoint i, j, count;
 
+	if( events->size > 1 && DThread_GetPlacement() ){
+		DaoTaskletEvent *event = (DaoTaskletEvent*) events->items.pVoid[0];
+		if( event->future->runner != runner ) DaoTaskletServer_PreferRunner( self, runner );
+	}
 	for(i=0; i<events->size; i++){
 		DaoTaskletEvent *event = (DaoTaskletEvent*) events->items.pVoid[i];
 		DaoFuture *future = event->future;
@@ -818,6 +1557,7 @@ static DaoFuture* DaoTaskletServer_GetNextFuture( DaoTaskletServer *self )
 		DaoFuture *futselect = NULL;
 		DaoValue *selected = NULL;
 		DaoValue *message = NULL;
+		DaoValue *popped = NULL;
 		int type = event->type;
 
 		if( event->state == DAO_EVENT_WAIT && future->precond != NULL ){
@@ -825,55 +1565,86 @@ static DaoFuture* DaoTaskletServer_GetNextFuture( DaoTaskletServer *self )
 		}
 		switch( event->type ){
 		case DAO_EVENT_WAIT_SENDING :
-			if( channel->buffer->size >= channel->cap ){
+			if( channel->size >= channel->cap ){
 				if( event->state == DAO_EVENT_WAIT ){
 					DaoChannel_ActivateEvent( channel, DAO_EVENT_WAIT_RECEIVING, self );
 					DaoChannel_ActivateEvent( channel, DAO_EVENT_WAIT_SELECT, self );
 					goto MoveToWaiting;
 				}
 			}
+			DMutex_Lock( & channel->mutex );
+			channel->senders -= 1;
+			DMutex_Unlock( & channel->mutex );
 			event->type = DAO_EVENT_RESUME_TASKLET;
 			break;
 		case DAO_EVENT_WAIT_RECEIVING :
-			if( channel->buffer->size == 0 ){
-				if( channel->cap > 0 && event->state == DAO_EVENT_WAIT ){
-					DaoChannel_ActivateEvent( channel, DAO_EVENT_WAIT_SENDING, self );
-					goto MoveToWaiting;
-				}
-				message = dao_none_value;
-			}else{
-				message = channel->buffer->items.pValue[0];
+			DMutex_Lock( & channel->mutex );
+			if( channel->size == 0 && channel->cap > 0 && event->state == DAO_EVENT_WAIT ){
+				DMutex_Unlock( & channel->mutex );
+				DaoChannel_ActivateEvent( channel, DAO_EVENT_WAIT_SENDING, self );
+				goto MoveToWaiting;
 			}
+			popped = DaoChannel_Pop( channel );
+			channel->receivers -= 1;
+			DMutex_Unlock( & channel->mutex );
+
+			message = popped ? popped : dao_none_value;
 			GC_Assign( & event->message, message );
-			event->auxiliary = channel->cap <= 0 && channel->buffer->size == 0;
+			GC_DecRC( popped );
+			event->auxiliary = channel->cap <= 0 && popped == NULL;
 			event->type = DAO_EVENT_RESUME_TASKLET;
-			DList_PopFront( channel->buffer );
-			if( channel->buffer->size < channel->cap ){
+			/* The data taken by a timed out receiver is not dropped: */
+			if( popped != NULL ) event->timeout = 0;
+			if( channel->senders && channel->size < channel->cap ){
 				DaoChannel_ActivateEvent( channel, DAO_EVENT_WAIT_SENDING, self );
 			}
-			if( channel->buffer->size ){
+			/* Pass on the remaining data, or the closing to the next receiver: */
+			if( channel->receivers && (channel->size || channel->cap <= 0) ){
 				DaoChannel_ActivateEvent( channel, DAO_EVENT_WAIT_RECEIVING, self );
 			}
 			break;
 		case DAO_EVENT_WAIT_SELECT :
+			/*
+			// Check the member that claimed the event first, then the others
+			// from a random position for fairness:
+			*/
 			message = dao_none_value;
-			for(it=DaoMap_First(event->selects); it; it=DaoMap_Next(event->selects,it)){
-				if( DaoValue_CheckCtype( it->key.pValue, self->vmspace->typeChannel ) ){
-					DaoChannel *chan = (DaoChannel*) it->key.pValue;
-					if( chan->buffer->size > 0 ){
+			count = event->selects->value->size;
+			it = DaoMap_First( event->selects );
+			if( count > 1 ){
+				self->random = self->random * 1103515245 + 12345;
+				for(j=(self->random >> 16) % count; j>0; --j) it = DaoMap_Next( event->selects, it );
+			}
+			if( event->fired && DMap_Find( event->selects->value, event->fired ) == NULL ){
+				event->fired = NULL;
+			}
+			for(j=event->fired ? -1 : 0; j<count; ++j){
+				DaoValue *source = (DaoValue*) event->fired;
+				if( j >= 0 ){
+					source = it->key.pValue;
+					it = DaoMap_Next( event->selects, it );
+					if( it == NULL ) it = DaoMap_First( event->selects );
+					if( source == (DaoValue*) event->fired ) continue;
+				}
+				if( DaoValue_CheckCtype( source, self->vmspace->typeChannel ) ){
+					DaoChannel *chan = (DaoChannel*) source;
+					DMutex_Lock( & chan->mutex );
+					popped = DaoChannel_Pop( chan );
+					DMutex_Unlock( & chan->mutex );
+					if( popped != NULL ){
 						chselect = chan;
-						selected = it->key.pValue;
-						message = chan->buffer->items.pValue[0];
+						selected = source;
+						message = popped;
 						closed = NULL;
 						break;
 					}else if( chan->cap == 0 ){
 						closed = chan;
 					}
 				}else{
-					DaoFuture *fut = (DaoFuture*) it->key.pValue;
+					DaoFuture *fut = (DaoFuture*) source;
 					if( fut->state == DAO_TASKLET_FINISHED ){
 						futselect = fut;
-						selected = it->key.pValue;
+						selected = source;
 						message = fut->value;
 						break;
 					}
@@ -883,19 +1654,21 @@ static DaoFuture* DaoTaskletServer_GetNextFuture( DaoTaskletServer *self )
 			if( event->state == DAO_EVENT_WAIT && event->selects->value->size ){
 				if( selected == NULL ) goto MoveToWaiting;
 			}
+			if( event->registered ) DaoTaskletEvent_Unregister( event );
 
 			GC_Assign( & event->message, message );
 			GC_Assign( & event->selected, selected );
+			GC_DecRC( popped );
 			event->auxiliary = event->selects->value->size == 0;
 			event->type = DAO_EVENT_RESUME_TASKLET;
+			self->selecting -= 1;
 			/* change status to not finished: */
 			if( chselect != NULL || futselect != NULL ) event->auxiliary = 0;
 			if( chselect ){
-				DList_PopFront( chselect->buffer );
-				if( chselect->buffer->size < chselect->cap ){
+				if( chselect->senders && chselect->size < chselect->cap ){
 					DaoChannel_ActivateEvent( chselect, DAO_EVENT_WAIT_SENDING, self );
 				}
-				if( chselect->buffer->size ){
+				if( chselect->size ){
 					DaoChannel_ActivateEvent( chselect, DAO_EVENT_WAIT_SELECT, self );
 				}
 			}
@@ -917,57 +1690,281 @@ static DaoFuture* DaoTaskletServer_GetNextFuture( DaoTaskletServer *self )
 		if( future->process && DMap_Find( active, future->process ) ) continue;
 		DList_Erase( events, i, 1 );
 		DMap_Erase( pending, event );
-		if( actor ){
-			void *value = actor->rootObject->isAsync ? future : NULL;
-			DMap_Insert( active, actor->rootObject, value );
-		}
-		if( future->process ){
-			DMap_Insert( active, future->process, NULL );
-			future->process->active = 1;
-		}
-
-		/*
-		// DaoValue_Move() should be used instead of GC_Assign() for thread safety.
-		// Because using GC_Assign() here, may caused "future->message" of primitive
-		// type being deleted, right after DaoFuture_HandleGC() has retrieved it
-		// for GC scanning.
-		 */
-		DaoValue_Move( event->message, & future->message, NULL );
-		DaoValue_Move( event->selected, & future->selected, NULL );
-		future->aux1 = event->auxiliary;
-		future->timeout = event->timeout;
-
-		GC_IncRC( future ); /* To be decreased at the end of tasklet; */
-		DaoTaskletServer_CacheEvent( self, event );
-		return future;
+		return DaoTaskletServer_TakeEvent( self, event );
 MoveToWaiting:
 		if( event->expiring >= 0.0 && event->expiring < MIN_TIME ) continue;
-		if( event->expiring >= MIN_TIME ){
-			dao_complex com = {0.0,0.0};
-			com.real = event->expiring;
-			DMap_Insert( self->waitings, & com, event );
-			DCondVar_Signal( & self->condv2 );
-		}else{
-			DList_Append( self->events2, event );
+		if( event->type == DAO_EVENT_WAIT_SELECT ){
+			event->claimed = 0;
+			event->fired = NULL;
+			if( event->registered == 0 ) DaoTaskletEvent_Register( event );
 		}
+		DaoTaskletServer_Park( self, event );
 		DList_Erase( self->events, i, 1 );
 		i -= 1;
 	}
 	return NULL;
 }
 
+/* Lock self::mutex before calling the following functions: */
+static void DaoTaskletServer_CountRun( DaoTaskletServer *self, DaoFuture *future, double span )
+{
+	DaoProcess *process = future->process;
+
+	future->runtime += span;
+	self->stats.runs += 1;
+	self->stats.runtime += span;
+	self->stats.runhist[ DaoTasklet_Bucket( span ) ] += 1;
+	self->stats.finished += process->status == DAO_PROCESS_FINISHED;
+	self->stats.aborted += process->status == DAO_PROCESS_ABORTED;
+}
+static void DaoTaskletServer_GetStats( DaoTaskletServer *self, DaoTaskletStats *stats )
+{
+	DNode *it;
+
+	*stats = self->stats;
+	stats->threads = self->total;
+	stats->idle = self->idle;
+	stats->vacant = self->vacant;
+	stats->jobs = self->functions->size;
+	stats->ready = self->events->size;
+	stats->waiting = self->parked;
+	stats->timed = self->timers.count;
+	stats->polling = self->iowaits->size;
+	stats->selecting = self->selecting;
+	stats->mailed = 0;
+	for(it=DMap_First(self->mailboxes); it; it=DMap_Next(self->mailboxes,it)){
+		stats->mailed += ((DaoTaskletMailbox*) it->value.pVoid)->size;
+	}
+}
+/*
+// The states are formatted into a string while the server mutex is held,
+// and written to the stream after it is released, since writing to the
+// stream may block or run user code. The type names are appended directly,
+// as they can be arbitrarily long.
+*/
+static void DaoTaskletServer_FormatEvent( DaoTaskletServer *self, DaoTaskletEvent *event, DString *output, double now )
+{
+	DaoFuture *future = event->future;
+	DaoChannel *channel = event->channel;
+	char buffer[128];
+
+	DString_AppendChars( output, "  " );
+	DString_Append( output, future->ctype->name );
+	sprintf( buffer, "[%p]: ", future );
+	DString_AppendChars( output, buffer );
+	switch( event->type ){
+	case DAO_EVENT_WAIT_TASKLET :
+		if( future->precond == NULL ) break;
+		DString_AppendChars( output, "waiting for " );
+		DString_Append( output, future->precond->ctype->name );
+		sprintf( buffer, "[%p]", future->precond );
+		DString_AppendChars( output, buffer );
+		break;
+	case DAO_EVENT_WAIT_RECEIVING :
+	case DAO_EVENT_WAIT_SENDING :
+		if( event->type == DAO_EVENT_WAIT_RECEIVING ){
+			DString_AppendChars( output, "receiving from " );
+		}else{
+			DString_AppendChars( output, "sending to " );
+		}
+		DString_Append( output, channel->ctype->name );
+		sprintf( buffer, "[%p] (size %i, cap %i)", channel, (int) channel->size, (int) channel->cap );
+		DString_AppendChars( output, buffer );
+		break;
+	case DAO_EVENT_WAIT_SELECT :
+		sprintf( buffer, "selecting over %i channels or futures", (int) event->selects->value->size );
+		DString_AppendChars( output, buffer );
+		break;
+	case DAO_EVENT_WAIT_STREAM :
+		sprintf( buffer, "waiting on file descriptor %i", event->descriptor );
+		DString_AppendChars( output, buffer );
+		break;
+	default :
+		DString_AppendChars( output, "ready" );
+		break;
+	}
+	sprintf( buffer, ", for %.3fs", now - event->since );
+	DString_AppendChars( output, buffer );
+	if( event->expiring >= MIN_TIME ){
+		sprintf( buffer, " (timeout in %.3fs)", event->expiring - now );
+		DString_AppendChars( output, buffer );
+	}
+	sprintf( buffer, "; run %.3fs, waited %.3fs;\n", future->runtime, future->waittime );
+	DString_AppendChars( output, buffer );
+}
+static void DaoTaskletServer_Format( DaoTaskletServer *self, DString *output )
+{
+	DaoTaskletStats stats;
+	DaoTaskletEvent *event, *next;
+	double now = Dao_GetCurrentTime();
+	char buffer[256];
+	daoint i;
+
+	DaoTaskletServer_GetStats( self, & stats );
+	sprintf( buffer, "Tasklets: threads %i, idle %i, vacant %i; jobs %i, ready %i, waiting %i, "
+			"timed %i, polling %i, selecting %i, mailed %i;\n", stats.threads, stats.idle,
+			stats.vacant, (int) stats.jobs, (int) stats.ready, (int) stats.waiting,
+			(int) stats.timed, (int) stats.polling, (int) stats.selecting, (int) stats.mailed );
+	DString_AppendChars( output, buffer );
+	sprintf( buffer, "Tasklets: runs %i, finished %i, aborted %i; run %.3fs, waited %.3fs;\n",
+			(int) stats.runs, (int) stats.finished, (int) stats.aborted, stats.runtime, stats.waittime );
+	DString_AppendChars( output, buffer );
+	DString_AppendChars( output, "Histograms (10us,100us,1ms,10ms,100ms,1s,10s,inf): run" );
+	for(i=0; i<DAO_TASKLET_HISTOGRAM; ++i){
+		sprintf( buffer, " %i", (int) stats.runhist[i] );
+		DString_AppendChars( output, buffer );
+	}
+	DString_AppendChars( output, "; wait" );
+	for(i=0; i<DAO_TASKLET_HISTOGRAM; ++i){
+		sprintf( buffer, " %i", (int) stats.waithist[i] );
+		DString_AppendChars( output, buffer );
+	}
+	DString_AppendChars( output, ";\n" );
+	if( stats.waiting + stats.timed + stats.polling == 0 ) return;
+
+	DString_AppendChars( output, "Blocked tasklets:\n" );
+	for(event=self->waiting; event; event=event->next){
+		DaoTaskletServer_FormatEvent( self, event, output, now );
+	}
+	for(event=DaoTimerWheel_Next(&self->timers,NULL); event; event=next){
+		next = DaoTimerWheel_Next( & self->timers, event );
+		DaoTaskletServer_FormatEvent( self, event, output, now );
+	}
+	for(i=0; i<self->iowaits->size; ++i){
+		event = (DaoTaskletEvent*) self->iowaits->items.pVoid[i];
+		DaoTaskletServer_FormatEvent( self, event, output, now );
+	}
+}
+/*
+// Print the states when it is requested by DaoVmSpace_RequestTaskletLog(),
+// or periodically if it is enabled by the "--tasklog" option.
+// Called with the server mutex held, which is released during the writing:
+*/
+static void DaoTaskletServer_CheckLog( DaoTaskletServer *self )
+{
+	DString *output;
+	double now;
+
+	if( self->logging == 0 ){
+		if( daoConfig.tasklog <= 0 ) return;
+		now = Dao_GetCurrentTime();
+		if( now < self->logtime ) return;
+		self->logtime = now + daoConfig.tasklog;
+	}
+	self->logging = 0;
+	output = DString_New();
+	DaoTaskletServer_Format( self, output );
+	DMutex_Unlock( & self->mutex );
+	DaoStream_WriteString( self->vmspace->errorStream, output );
+	DString_Delete( output );
+	DMutex_Lock( & self->mutex );
+}
+
+void DaoVmSpace_GetTaskletStats( DaoVmSpace *self, DaoTaskletStats *stats )
+{
+	DaoTaskletServer *server = (DaoTaskletServer*) self->taskletServer;
+
+	memset( stats, 0, sizeof(DaoTaskletStats) );
+	if( server == NULL ) return;
+
+	DMutex_Lock( & server->mutex );
+	DaoTaskletServer_GetStats( server, stats );
+	DMutex_Unlock( & server->mutex );
+}
+void DaoVmSpace_PrintTasklets( DaoVmSpace *self, DaoStream *stream )
+{
+	DaoTaskletServer *server = (DaoTaskletServer*) self->taskletServer;
+	DString *output;
+
+	if( server == NULL ) return;
+
+	output = DString_New();
+	DMutex_Lock( & server->mutex );
+	DaoTaskletServer_Format( server, output );
+	DMutex_Unlock( & server->mutex );
+	DaoStream_WriteString( stream, output );
+	DString_Delete( output );
+}
+void DaoProcess_CountTaskletRun( DaoProcess *self, double span )
+{
+	DaoTaskletServer *server = (DaoTaskletServer*) self->vmSpace->taskletServer;
+
+	if( server == NULL || self->future == NULL ) return;
+
+	DMutex_Lock( & server->mutex );
+	DaoTaskletServer_CountRun( server, self->future, span );
+	DMutex_Unlock( & server->mutex );
+}
+void DaoVmSpace_RequestTaskletLog( DaoVmSpace *self )
+{
+	DaoTaskletServer *server = (DaoTaskletServer*) self->taskletServer;
+	if( server ) server->logging = 1;
+}
+
+/*
+// Run (or resume) the tasklet of the future value. Return the future value
+// of the next call from the mailbox of the actor, if it is to be run next.
+*/
+static DaoFuture* DaoTaskletThread_RunFuture( DaoTaskletThread *self, DaoFuture *future, int batch )
+{
+	DaoTaskletServer *server = self->server;
+	DaoProcess *process = future->process;
+	DaoFuture *next = NULL;
+	double start, span;
+	daoint count;
+
+	future->runner = self;
+	if( process == NULL ){
+		GC_DecRC( future );
+		return NULL;
+	}
+
+	count = process->exceptions->size;
+	future->state = DAO_TASKLET_RUNNING;
+	DaoProcess_InterceptReturnValue( process );
+	start = Dao_GetCurrentTime();
+	DaoProcess_Start( process );
+	span = Dao_GetCurrentTime() - start;
+	if( process->exceptions->size > count ) DaoProcess_PrintException( process, NULL, 1 );
+	if( process->status <= DAO_PROCESS_ABORTED ) self->taskOwner = NULL;
+
+	if( future->actor ){
+		DaoObject *actor = future->actor->rootObject;
+		DMutex_Lock( & server->mutex );
+		if( actor->isAsync == 0 ){
+			DMap_Erase( server->active, actor );
+		}else if( process->status <= DAO_PROCESS_ABORTED ){
+			next = DaoTaskletServer_NextMail( server, actor, batch );
+		}
+		DMutex_Unlock( & server->mutex );
+	}
+	DMutex_Lock( & server->mutex );
+	DMap_Erase( server->active, process );
+	process->active = 0;
+	DaoTaskletServer_CountRun( server, future, span );
+	DaoTaskletServer_ExpireTimers( server );
+	DMutex_Unlock( & server->mutex );
+
+	DaoProcess_ReturnFutureValue( process, future );
+	if( future->state == DAO_TASKLET_FINISHED || future->state == DAO_TASKLET_ABORTED ){
+		DaoFuture_ActivateEvent( future, server->vmspace );
+	}
+	GC_DecRC( future );
+	return next;
+}
+
 static void DaoTaskletThread_Run( DaoTaskletThread *self )
 {
 	DaoTaskletServer *server = self->server;
 	double wt = 0.001;
-	daoint i, count, timeout;
+	daoint i, timeout;
+	int batch;
 
 	if( self->taskFunc ){
 		self->taskFunc( self->taskParam );
 		self->taskOwner = NULL;
 	}
 	while( server->vmspace->stopit == 0 ){
-		DaoProcess *process = NULL;
 		DaoFuture *future = NULL;
 		DThreadTask function = NULL;
 		void *parameter = NULL;
@@ -976,14 +1973,30 @@ static void DaoTaskletThread_Run( DaoTaskletThread *self )
 		DMutex_Lock( & server->mutex );
 		server->idle += 1;
 		server->vacant += self->taskOwner == NULL;
-		while( server->pending->size == (server->events2->size + server->waitings->size) ){
-			//printf( "%p %i %i %i %i\n", self, server->events->size, server->pending->size, server->events2->size, server->waitings->size );
+		DaoTaskletServer_ExpireTimers( server );
+		DaoTaskletServer_CheckLog( server );
+		while( server->pending->size == (server->parked + server->timers.count + server->iowaits->size) ){
+			daoint waiting = server->parked + server->timers.count + server->iowaits->size;
 			if( server->vmspace->stopit ) break;
 			if( server->finishing && server->vacant == server->total ){
-				if( (server->events2->size + server->waitings->size) == 0 ) break;
+				if( waiting == 0 ) break;
+			}
+			if( server->idle == server->total && waiting == server->parked ){
+				DaoTaskletServer_ActivateEvents( server );
 			}
 			wt = 0.01*(server->idle == server->total) + 0.001;
+			wt = DaoTimerWheel_Timeout( & server->timers, Dao_GetCurrentTime(), wt );
+#ifdef DAO_TASKLET_REACTOR
+			/* One of the idle threads waits on the file descriptors: */
+			if( server->iowaits->size && server->polling == 0 ){
+				DaoTaskletServer_PollEvents( server, wt );
+				DaoTaskletServer_ExpireTimers( server );
+				continue;
+			}
+#endif
 			timeout = DCondVar_TimedWait( & server->condv, & server->mutex, wt );
+			DaoTaskletServer_ExpireTimers( server );
+			DaoTaskletServer_CheckLog( server );
 		}
 		for(i=0; i<server->parameters->size; ++i){
 			void *param = server->parameters->items.pVoid[i];
@@ -1017,43 +2030,13 @@ static void DaoTaskletThread_Run( DaoTaskletThread *self )
 		DMutex_Lock( & server->mutex );
 		server->idle -= 1;
 		server->vacant -= self->taskOwner == NULL;
-		future = DaoTaskletServer_GetNextFuture( server );
-		DMutex_Unlock( & server->mutex );
-
-		if( future == NULL ) continue;
-
-		process = future->process;
-		if( process == NULL ){
-			GC_DecRC( future );
-			continue;
-		}
-
-		count = process->exceptions->size;
-		future->state = DAO_TASKLET_RUNNING;
-		DaoProcess_InterceptReturnValue( process );
-		DaoProcess_Start( process );
-		if( process->exceptions->size > count ) DaoProcess_PrintException( process, NULL, 1 );
-		if( process->status <= DAO_PROCESS_ABORTED ) self->taskOwner = NULL;
-
-		if( future->actor ){
-			int erase = 1;
-			DMutex_Lock( & server->mutex );
-			if( future->actor->rootObject->isAsync ){
-				erase = process->status == DAO_PROCESS_FINISHED;
-			}
-			if( erase ) DMap_Erase( server->active, future->actor->rootObject );
-			DMutex_Unlock( & server->mutex );
-		}
-		DMutex_Lock( & server->mutex );
-		DMap_Erase( server->active, process );
-		process->active = 0;
+		future = DaoTaskletServer_GetNextFuture( server, self );
 		DMutex_Unlock( & server->mutex );
 
-		DaoProcess_ReturnFutureValue( process, future );
-		if( future->state == DAO_TASKLET_FINISHED ){
-			DaoFuture_ActivateEvent( future, server->vmspace );
+		/* Run the tasklet, and the calls taken from the mailbox of its actor: */
+		for(batch=1; future != NULL; ++batch){
+			future = DaoTaskletThread_RunFuture( self, future, batch );
 		}
-		GC_DecRC( future );
 	}
 	DMutex_Lock( & server->mutex );
 	server->stopped += 1;
@@ -1095,7 +2078,7 @@ void DaoVmSpace_StopTasklets( DaoVmSpace *self )
 	DaoTaskletThread_Run( taskthd );  /* process tasks in the main thread; */
 
 	DMutex_Lock( & server->mutex );
-	while( server->stopped != server->total || server->timing ){
+	while( server->stopped != server->total ){
 		DCondVar_TimedWait( & condv, & server->mutex, 0.01 );
 	}
 	DMutex_Unlock( & server->mutex );
@@ -1168,6 +2151,175 @@ static DaoValue* DaoValue_DeepCopy( DaoValue *self )
 }
 
 
+/*
+// Check if the nested containers are referenced only by their parent containers.
+// The top level value is checked by DaoProcess_CheckUniqueArgument(), because it
+// is also referenced by the call and by the registers of the caller.
+*/
+static int DaoValue_CheckUnique( DaoValue *self, int nested )
+{
+	DNode *it;
+	daoint i;
+	if( self->type <= DAO_ENUM ) return 1;
+	if( nested && self->xGC.refCount > 1 ) return 0;
+	switch( self->type ){
+	case DAO_ARRAY :
+		return self->xArray.original == NULL && self->xArray.owner;
+	case DAO_LIST :
+		for(i=0; i<self->xList.value->size; ++i){
+			if( DaoValue_CheckUnique( self->xList.value->items.pValue[i], 1 ) == 0 ) return 0;
+		}
+		return 1;
+	case DAO_MAP :
+		for(it=DMap_First(self->xMap.value); it; it=DMap_Next(self->xMap.value,it)){
+			if( DaoValue_CheckUnique( it->key.pValue, 1 ) == 0 ) return 0;
+			if( DaoValue_CheckUnique( it->value.pValue, 1 ) == 0 ) return 0;
+		}
+		return 1;
+	case DAO_TUPLE :
+		for(i=0; i<self->xTuple.size; ++i){
+			if( DaoValue_CheckUnique( self->xTuple.values[i], 1 ) == 0 ) return 0;
+		}
+		return 1;
+	}
+	return 0;
+}
+static int DaoProcess_IsHolder( DaoValue **locals, int reg, DaoValue *value )
+{
+	return reg != 0xffff && locals[reg] == value;
+}
+/*
+// Check if a value passed to the current native method is uniquely referenced.
+//
+// The value is always referenced by the call itself (the parameter buffer, the
+// native frame and the argument registers), and by the registers that have
+// passed it along in the calling routine (temporaries, the variable and the
+// argument register). So refCount==1 is adapted to: all the references are
+// from the call or the caller's registers, and except the register the value
+// is moved from, these registers are never read other than to pass the value
+// to another one of them. Otherwise the value is aliased by a variable, by an
+// outer frame or by some data structure, and moving it would be observable.
+*/
+static int DaoProcess_CheckUniqueArgument( DaoProcess *self, DaoValue *value )
+{
+	DaoStackFrame *frame = self->topFrame->active;
+	DaoRoutine *routine = frame->routine;
+	DaoVmCode *call = self->activeCode;
+	DaoValue **locals, **stack = self->stackValues;
+	daoint callerBase = frame->stackBase, calleeBase = self->topFrame->stackBase;
+	daoint i, j, count = 0, source = -1, codeCount, callIndex;
+	DaoCnode node;
+
+	if( routine == NULL || routine->body == NULL || frame->process != self ) return 0;
+	if( call == NULL || (call->code != DVM_CALL && call->code != DVM_MCALL) ) return 0;
+	codeCount = routine->body->vmCodes->size;
+	callIndex = call - frame->codes;
+	if( callIndex < 0 || callIndex >= codeCount ) return 0;
+	locals = stack + callerBase;
+
+	for(i=0; i<self->stackSize; ++i){
+		if( stack[i] != value ) continue;
+		count += 1;
+		if( i >= 1 && i <= DAO_MAX_PARAM ) continue; /* Parameter buffer; */
+		if( i >= calleeBase ) continue; /* Native frame and released frames; */
+		if( i >= callerBase && i < callerBase + routine->body->regCount ) continue;
+		return 0;
+	}
+	if( (call->b & DAO_CALL_FAST) && locals[call->a]->xRoutine.overloads == NULL ){
+		/* Fast calls hold an extra reference for each argument: */
+		for(i=1; i<=(call->b & 0xff); ++i) count += locals[call->a+i] == value;
+	}
+	if( value->xGC.refCount != count ) return 0;
+
+	/* Find the register the value is moved from: */
+	for(i=callIndex-1; i>=0 && source < 0; --i){
+		DaoCnode_InitOperands( & node, frame->codes + i );
+		if( node.lvalue < call->a || node.lvalue > call->a + (call->b & 0xff) ) continue;
+		if( DaoProcess_IsHolder( locals, node.lvalue, value ) == 0 ) continue;
+		source = node.lvalue;
+		if( DaoVmCode_GetOpcodeType( frame->codes + i ) != DAO_CODE_MOVE ) break;
+		if( DaoProcess_IsHolder( locals, node.first, value ) ) source = node.first;
+	}
+
+	for(i=0; i<codeCount; ++i){
+		DaoVmCode *vmc = frame->codes + i;
+		int moving = DaoVmCode_GetOpcodeType( vmc ) == DAO_CODE_MOVE;
+		int k = 0, operands[3];
+		if( i == callIndex ) continue;
+		DaoCnode_InitOperands( & node, vmc );
+		/* Passing the value to another holder is not an observation: */
+		if( moving && DaoProcess_IsHolder( locals, node.lvalue, value ) ) continue;
+		switch( node.type ){
+		case DAO_OP_TRIPLE : operands[k++] = node.third;
+		case DAO_OP_PAIR   : operands[k++] = node.second;
+		case DAO_OP_SINGLE : operands[k++] = node.first; break;
+		case DAO_OP_RANGE2 : operands[k++] = node.third;
+		case DAO_OP_RANGE  :
+			for(j=node.first; j<node.second; ++j){
+				if( j != source && locals[j] == value ) return 0;
+			}
+			break;
+		}
+		for(j=0; j<k; ++j){
+			if( operands[j] != source && locals[operands[j]] == value ) return 0;
+		}
+	}
+	return 1;
+}
+/*
+// Move the data of a uniquely referenced value to a new value without copying.
+// The original value is left empty (tuples keep the emptied nested items).
+*/
+static DaoValue* DaoValue_MoveData( DaoValue *self )
+{
+	daoint i;
+	if( self->type <= DAO_ENUM ) return self;
+	if( self->type == DAO_ARRAY ){
+		DaoArray *array = (DaoArray*) self;
+		DaoArray *copy = DaoArray_New( array->etype );
+		DaoArray tmp = *copy;
+		DaoGC_LockData();
+		copy->owner = array->owner;
+		copy->ndim = array->ndim;
+		copy->size = array->size;
+		copy->dims = array->dims;
+		copy->data = array->data;
+		array->owner = tmp.owner;
+		array->ndim = tmp.ndim;
+		array->size = tmp.size;
+		array->dims = tmp.dims;
+		array->data = tmp.data;
+		DaoGC_UnlockData();
+		return (DaoValue*) copy;
+	}else if( self->type == DAO_LIST ){
+		DaoList *list = (DaoList*) self;
+		DaoList *copy = DaoList_New();
+		GC_Assign( & copy->ctype, list->ctype );
+		DList_Swap( copy->value, list->value );
+		return (DaoValue*) copy;
+	}else if( self->type == DAO_MAP ){
+		DaoMap *map = (DaoMap*) self;
+		DaoMap *copy = DaoMap_New( map->value->hashing );
+		DMap *value = copy->value;
+		GC_Assign( & copy->ctype, map->ctype );
+		DaoGC_LockData();
+		copy->value = map->value;
+		map->value = value;
+		DaoGC_UnlockData();
+		return (DaoValue*) copy;
+	}else if( self->type == DAO_TUPLE ){
+		DaoTuple *tuple = (DaoTuple*) self;
+		DaoTuple *copy = DaoTuple_New( tuple->size );
+		GC_Assign( & copy->ctype, tuple->ctype );
+		for(i=0; i<tuple->size; ++i){
+			DaoValue *value = DaoValue_MoveData( tuple->values[i] );
+			DaoTuple_SetItem( copy, value, i );
+		}
+		return (DaoValue*) copy;
+	}
+	return NULL;
+}
+
 static void CHANNEL_SetCap( DaoChannel *self, DaoValue *value, DaoProcess *proc )
 {
 	self->cap = value->xInteger.value;
@@ -1194,7 +2346,7 @@ static void CHANNEL_New( DaoProcess *proc, DaoValue *par[], int N )
 static void CHANNEL_Buffer( DaoProcess *proc, DaoValue *par[], int N )
 {
 	DaoChannel *self = (DaoChannel*) par[0];
-	DaoProcess_PutInteger( proc, self->buffer->size );
+	DaoProcess_PutInteger( proc, self->size );
 }
 static void CHANNEL_Cap( DaoProcess *proc, DaoValue *par[], int N )
 {
@@ -1207,7 +2359,9 @@ static void CHANNEL_Cap( DaoProcess *proc, DaoValue *par[], int N )
 
 	/* Closing the channel: */
 	DMutex_Lock( & server->mutex );
+	DMutex_Lock( & self->mutex );
 	self->cap = par[1]->xInteger.value;
+	DMutex_Unlock( & self->mutex );
 	if( self->cap == 0 ){
 		DaoChannel_ActivateEvent( self, DAO_EVENT_WAIT_RECEIVING, server );
 		DaoChannel_ActivateEvent( self, DAO_EVENT_WAIT_SELECT, server );
@@ -1215,22 +2369,49 @@ static void CHANNEL_Cap( DaoProcess *proc, DaoValue *par[], int N )
 	}
 	DMutex_Unlock( & server->mutex );
 }
-void DaoChannel_Send( DaoChannel *self, DaoValue *data, DaoTaskletServer *server )
+/*
+// Return 1 if the sender should wait until the buffer size drops below the cap.
+// The tasklet server is locked only if there are tasklets waiting for data.
+*/
+int DaoChannel_Send( DaoChannel *self, DaoValue *data, DaoTaskletServer *server )
 {
-	DMutex_Lock( & server->mutex );
-	DList_Append( self->buffer, data );
-	DaoChannel_ActivateEvent( self, DAO_EVENT_WAIT_RECEIVING, server );
-	DaoChannel_ActivateEvent( self, DAO_EVENT_WAIT_SELECT, server );
-	DCondVar_Signal( & server->condv );
-	DMutex_Unlock( & server->mutex );
+	int receivers, block;
+
+	data = DaoValue_SimpleCopy( data );
+	GC_IncRC( data );
+
+	DMutex_Lock( & self->mutex );
+	DaoChannel_Push( self, data );
+	block = self->size >= self->cap;
+	self->senders += block;
+	receivers = self->receivers;
+	DMutex_Unlock( & self->mutex );
+
+	if( receivers || server->selecting ){
+		DMutex_Lock( & server->mutex );
+		DaoChannel_ActivateEvent( self, DAO_EVENT_WAIT_RECEIVING, server );
+		DaoChannel_ActivateEvent( self, DAO_EVENT_WAIT_SELECT, server );
+		DCondVar_Signal( & server->condv );
+		DMutex_Unlock( & server->mutex );
+	}
+	return block;
 }
+/*
+// Data sent to a channel is copied, except for the following cases:
+// 1. The channel data type is invar, so the data can be shared between tasklets.
+//    The sender should not modify the data through other (non-invar) references;
+// 2. The data is sent with $move, and neither the sent value nor its nested
+//    containers are shared. The data is moved out of the sent value without
+//    copying, and the sent value will become empty. Shared data is copied.
+*/
 static void CHANNEL_Send( DaoProcess *proc, DaoValue *par[], int N )
 {
 	DaoValue *data;
 	DaoTaskletServer *server = DaoTaskletServer_TryInit( proc->vmSpace );
-	DaoFuture *future = DaoProcess_GetInitFuture( proc );
 	DaoChannel *self = (DaoChannel*) par[0];
-	float timeout = par[2]->xFloat.value;
+	DaoType *type = self->ctype->args->size ? self->ctype->args->items.pType[0] : NULL;
+	int move = par[2]->type == DAO_ENUM && par[2]->xEnum.value;
+	float timeout = par[N-1]->xFloat.value;
 
 	DaoProcess_PutBoolean( proc, 1 );
 	if( self->cap <= 0 ){
@@ -1238,16 +2419,22 @@ static void CHANNEL_Send( DaoProcess *proc, DaoValue *par[], int N )
 		return;
 	}
 
-	data = DaoValue_DeepCopy( par[1] );
+	if( type != NULL && type->invar ){
+		data = par[1];
+	}else if( move && DaoProcess_CheckUniqueArgument( proc, par[1] )
+			&& DaoValue_CheckUnique( par[1], 0 ) ){
+		data = DaoValue_MoveData( par[1] );
+	}else{
+		data = DaoValue_DeepCopy( par[1] );
+	}
 	if( data == NULL ){
 		DaoProcess_RaiseError( proc, "Param", "invalid data for the channel" );
 		return;
 	}
 
 	//printf( "CHANNEL_Send: %p\n", event );
-	DaoChannel_Send( self, data, server );
-
-	if( self->buffer->size >= self->cap ){
+	if( DaoChannel_Send( self, data, server ) ){
+		DaoFuture *future = DaoProcess_GetInitFuture( proc );
 		DaoTaskletEvent *event = DaoTaskletServer_MakeEvent( server );
 		DaoTaskletEvent_Init( event, DAO_EVENT_WAIT_SENDING, DAO_EVENT_WAIT, future, self );
 		proc->status = DAO_PROCESS_SUSPENDED;
@@ -1259,10 +2446,43 @@ static void CHANNEL_Receive( DaoProcess *proc, DaoValue *par[], int N )
 {
 	DaoTaskletEvent *event = NULL;
 	DaoTaskletServer *server = DaoTaskletServer_TryInit( proc->vmSpace );
-	DaoFuture *future = DaoProcess_GetInitFuture( proc );
 	DaoChannel *self = (DaoChannel*) par[0];
 	float timeout = par[1]->xFloat.value;
+	DaoValue *data = NULL;
+	DaoFuture *future;
+	DaoTuple *tuple;
+	int closed, received, senders = 0;
+
+	/*
+	// Receive without suspending the tasklet, if there is data in the buffer
+	// and no other tasklet is waiting to receive from the channel:
+	*/
+	DMutex_Lock( & self->mutex );
+	closed = self->cap <= 0 && self->size == 0;
+	received = self->receivers == 0 && (self->size || closed);
+	if( received ){
+		data = DaoChannel_Pop( self );
+		senders = self->senders && self->size < self->cap;
+	}else{
+		self->receivers += 1;
+	}
+	DMutex_Unlock( & self->mutex );
+
+	if( received ){
+		tuple = DaoProcess_PutTuple( proc, 2 );
+		DaoTuple_SetItem( tuple, data ? data : dao_none_value, 0 );
+		tuple->values[1]->xEnum.value = closed ? 2 : 0;
+		GC_DecRC( data );
+		if( senders ){
+			DMutex_Lock( & server->mutex );
+			DaoChannel_ActivateEvent( self, DAO_EVENT_WAIT_SENDING, server );
+			DCondVar_Signal( & server->condv );
+			DMutex_Unlock( & server->mutex );
+		}
+		return;
+	}
 
+	future = DaoProcess_GetInitFuture( proc );
 	event = DaoTaskletServer_MakeEvent( server );
 	DaoTaskletEvent_Init( event, DAO_EVENT_WAIT_RECEIVING, DAO_EVENT_WAIT, future, self );
 	proc->status = DAO_PROCESS_SUSPENDED;
@@ -1270,7 +2490,7 @@ static void CHANNEL_Receive( DaoProcess *proc, DaoValue *par[], int N )
 	DaoTaskletServer_AddTimedWait( server, proc, event, timeout );
 
 	/* Message may have been sent before this call: */
-	if( self->buffer->size ){
+	if( self->size ){
 		DMutex_Lock( & server->mutex );
 		DaoChannel_ActivateEvent( self, DAO_EVENT_WAIT_RECEIVING, server );
 		DCondVar_Signal( & server->condv );
@@ -1285,23 +2505,27 @@ static DaoFunctionEntry daoChannelMeths[] =
 	{ CHANNEL_Cap,      "cap( self: Channel<@V> ) => int" },
 	{ CHANNEL_Cap,      "cap( self: Channel<@V>, cap: int ) => int" },
 	{ CHANNEL_Send,     "send( self: Channel<@V>, data: @V, timeout: float = -1 ) => bool" },
+	{ CHANNEL_Send,     "send( self: Channel<@V>, data: @V, mode: enum<copy,move>, timeout: float = -1 ) => bool" },
 	{ CHANNEL_Receive,  "receive( self: Channel<@V>, timeout: float = -1 ) => tuple<data: @V|none, status: enum<received,timeout,finished>>" },
 	{ NULL, NULL }
 };
 
+/*
+// The buffer can only hold data of primitive types, which cannot form
+// cyclic references. So it is not scanned by the GC, and the data items
+// are released when the channel is deleted.
+*/
 static void DaoChannel_Delete( DaoChannel *self )
 {
+	DaoValue *value;
 	DaoCstruct_Free( (DaoCstruct*) self );
-	DList_Delete( self->buffer );
+	while( (value = DaoChannel_Pop( self )) != NULL ) GC_DecRC( value );
+	if( self->selectors ) DMap_Delete( self->selectors );
+	DMutex_Destroy( & self->mutex );
+	dao_free( self->buffer );
 	dao_free( self );
 }
 
-static void DaoChannel_HandleGC( DaoValue *p, DList *vs, DList *lists, DList *ms, int rm )
-{
-	DaoChannel *self = (DaoChannel*) p;
-	DList_Append( lists, self->buffer );
-}
-
 
 DaoTypeCore daoChannelCore =
 {
@@ -1326,7 +2550,7 @@ DaoTypeCore daoChannelCore =
 	NULL,                                              /* Create */
 	NULL,                                              /* Copy */
 	(DaoDeleteFunction) DaoChannel_Delete,             /* Delete */
-	DaoChannel_HandleGC                                /* HandleGC */
+	NULL                                               /* HandleGC */
 };
 
 
@@ -1355,16 +2579,144 @@ void DaoMT_Select( DaoProcess *proc, DaoValue *par[], int n )
 	event = DaoTaskletServer_MakeEvent( server );
 	DaoTaskletEvent_Init( event, DAO_EVENT_WAIT_SELECT, DAO_EVENT_WAIT, future, NULL );
 	GC_Assign( & event->selects, selects );
+
+	DMutex_Lock( & server->mutex );
+	server->selecting += 1;
+	DMutex_Unlock( & server->mutex );
+
+	/*
+	// The event is registered on the members of the group when it is parked
+	// by the scheduler, after checking all the members under the lock.
+	// Messages sent before that will be found by the checking, and those
+	// sent after that will claim the event, since ::selecting is non-zero.
+	*/
 	proc->status = DAO_PROCESS_SUSPENDED;
 	proc->pauseType = DAO_PAUSE_CHANFUT_SELECT;
 	DaoTaskletServer_AddTimedWait( server, proc, event, timeout );
+}
+
+/*
+// The returning type of a dynamic call may not be the future type:
+*/
+static DaoType* DaoProcess_GetFutureType( DaoProcess *self )
+{
+	DaoType *type = DaoProcess_GetReturnType( self );
+	if( type == NULL || type->core != self->vmSpace->typeFuture->core ){
+		type = (DaoType*) self->topFrame->routine->routType->aux;
+	}
+	return type;
+}
+static void DaoMT_Combine( DaoProcess *proc, DaoValue *p[], int kind )
+{
+	DaoTaskletServer *server = DaoTaskletServer_TryInit( proc->vmSpace );
+	DaoType *type = DaoProcess_GetFutureType( proc );
+	DaoFuture *future = DaoFuture_New( proc->vmSpace, type, 0 );
+	DaoList *list = (DaoList*) p[0];
+	daoint i;
+
+	DaoProcess_PutValue( proc, (DaoValue*) future );
+	future->continuation = kind;
+	future->count = list->value->size;
+	if( kind == DAO_FUTURE_ALL ){
+		future->preconds = DaoList_Copy( list, NULL );
+		GC_IncRC( future->preconds );
+		if( list->value->size == 0 ){
+			type = type->args->items.pType[0];
+			GC_Assign( & future->value, DaoList_New() );
+			GC_Assign( & future->value->xList.ctype, type );
+			future->state = DAO_TASKLET_FINISHED;
+			return;
+		}
+	}else if( list->value->size == 0 ){
+		DaoProcess_RaiseError( proc, "Param", "empty list of future values" );
+		return;
+	}
 
-	/* Message may have been sent before this call: */
 	DMutex_Lock( & server->mutex );
-	DaoChannel_ActivateEvent( NULL, DAO_EVENT_WAIT_SELECT, server );
+	for(i=0; i<list->value->size; ++i){
+		DaoFuture *pre = (DaoFuture*) list->value->items.pValue[i];
+		DaoTaskletServer_AddContinuation( server, pre, future );
+	}
 	DCondVar_Signal( & server->condv );
 	DMutex_Unlock( & server->mutex );
 }
+void DaoMT_All( DaoProcess *proc, DaoValue *p[], int n )
+{
+	DaoMT_Combine( proc, p, DAO_FUTURE_ALL );
+}
+void DaoMT_Any( DaoProcess *proc, DaoValue *p[], int n )
+{
+	DaoMT_Combine( proc, p, DAO_FUTURE_ANY );
+}
+void DaoMT_Stats( DaoProcess *proc, DaoValue *p[], int n )
+{
+	DaoTaskletStats stats;
+	DaoInteger integer = {DAO_INTEGER,0,0,0,0,0};
+	DaoTuple *tuple = DaoProcess_PutTuple( proc, 17 );
+	DaoList *runs, *waits;
+	DaoType *type;
+	int i;
+
+	if( tuple == NULL ) return;
+
+	DaoVmSpace_GetTaskletStats( proc->vmSpace, & stats );
+	tuple->values[0]->xInteger.value = stats.threads;
+	tuple->values[1]->xInteger.value = stats.idle;
+	tuple->values[2]->xInteger.value = stats.vacant;
+	tuple->values[3]->xInteger.value = stats.jobs;
+	tuple->values[4]->xInteger.value = stats.ready;
+	tuple->values[5]->xInteger.value = stats.waiting;
+	tuple->values[6]->xInteger.value = stats.timed;
+	tuple->values[7]->xInteger.value = stats.polling;
+	tuple->values[8]->xInteger.value = stats.selecting;
+	tuple->values[9]->xInteger.value = stats.mailed;
+	tuple->values[10]->xInteger.value = stats.runs;
+	tuple->values[11]->xInteger.value = stats.finished;
+	tuple->values[12]->xInteger.value = stats.aborted;
+	tuple->values[13]->xFloat.value = stats.runtime;
+	tuple->values[14]->xFloat.value = stats.waittime;
+	type = (DaoType*) tuple->ctype->args->items.pType[15]->aux;
+	runs = DaoList_New();
+	waits = DaoList_New();
+	GC_Assign( & runs->ctype, type );
+	GC_Assign( & waits->ctype, type );
+	for(i=0; i<DAO_TASKLET_HISTOGRAM; ++i){
+		integer.value = stats.runhist[i];
+		DaoList_Append( runs, (DaoValue*) & integer );
+		integer.value = stats.waithist[i];
+		DaoList_Append( waits, (DaoValue*) & integer );
+	}
+	DaoTuple_SetItem( tuple, (DaoValue*) runs, 15 );
+	DaoTuple_SetItem( tuple, (DaoValue*) waits, 16 );
+}
+void DaoMT_Log( DaoProcess *proc, DaoValue *p[], int n )
+{
+	DaoStream *stream = proc->stdioStream ? proc->stdioStream : proc->vmSpace->stdioStream;
+	if( p[0]->type != DAO_NONE ) stream = (DaoStream*) p[0];
+	DaoVmSpace_PrintTasklets( proc->vmSpace, stream );
+}
+void DaoMT_Mailbox( DaoProcess *proc, DaoValue *p[], int n )
+{
+	DaoTaskletServer *server = (DaoTaskletServer*) proc->vmSpace->taskletServer;
+	DaoTuple *tuple = DaoProcess_PutTuple( proc, 2 );
+	DaoObject *actor = (DaoObject*) p[0];
+	DNode *it;
+
+	if( actor->type != DAO_OBJECT || actor->rootObject->isAsync == 0 ){
+		DaoProcess_RaiseError( proc, "Param", "not an asynchronous object" );
+		return;
+	}
+	if( tuple == NULL || server == NULL ) return;
+
+	DMutex_Lock( & server->mutex );
+	it = DMap_Find( server->mailboxes, actor->rootObject );
+	if( it != NULL ){
+		DaoTaskletMailbox *mailbox = (DaoTaskletMailbox*) it->value.pVoid;
+		tuple->values[0]->xInteger.value = mailbox->size;
+		tuple->values[1]->xInteger.value = mailbox->peak;
+	}
+	DMutex_Unlock( & server->mutex );
+}
 
 #endif
 
@@ -1384,6 +2736,12 @@ DaoFuture* DaoFuture_New( DaoVmSpace *vms, DaoType *type, int vatype )
 }
 static void DaoFuture_Delete( DaoFuture *self )
 {
+	daoint i;
+	if( self->nexts ){
+		for(i=0; i<self->nexts->size; ++i) GC_DecRC( self->nexts->items.pValue[i] );
+		DList_Delete( self->nexts );
+	}
+	if( self->selectors ) DMap_Delete( self->selectors );
 	DaoCstruct_Free( (DaoCstruct*) self );
 	GC_DecRC( self->value );
 	GC_DecRC( self->actor );
@@ -1391,6 +2749,7 @@ static void DaoFuture_Delete( DaoFuture *self )
 	GC_DecRC( self->selected );
 	GC_DecRC( self->process );
 	GC_DecRC( self->precond );
+	GC_DecRC( self->preconds );
 	dao_free( self );
 }
 
@@ -1424,10 +2783,39 @@ static void FUTURE_Wait( DaoProcess *proc, DaoValue *par[], int N )
 	DaoProcess_RaiseError( proc, NULL, "Invalid future value" );
 #endif
 }
+#ifdef DAO_WITH_CONCURRENT
+DaoProcess* DaoMT_CloneSection( DaoProcess *proc, DaoFuture *future, int argcount );
+#endif
+/*
+// Start the code section as a tasklet with the value of this future,
+// once it has finished, without suspending any tasklet to wait for it:
+*/
+static void FUTURE_Then( DaoProcess *proc, DaoValue *par[], int N )
+{
+	DaoFuture *self = (DaoFuture*) par[0];
+#ifdef DAO_WITH_CONCURRENT
+	DaoType *type = DaoProcess_GetFutureType( proc );
+	DaoFuture *future = DaoFuture_New( proc->vmSpace, type, 0 );
+	DaoTaskletServer *server = DaoTaskletServer_TryInit( proc->vmSpace );
+
+	DaoProcess_PutValue( proc, (DaoValue*) future );
+	if( DaoMT_CloneSection( proc, future, 1 ) == NULL ) return;
+	future->continuation = DAO_FUTURE_THEN;
+
+	DMutex_Lock( & server->mutex );
+	DaoTaskletServer_AddContinuation( server, self, future );
+	DCondVar_Signal( & server->condv );
+	DMutex_Unlock( & server->mutex );
+	DaoVmSpace_TryAddTaskletThread( proc->vmSpace, NULL, NULL, server->pending->size );
+#else
+	DaoProcess_RaiseError( proc, NULL, "Invalid future value" );
+#endif
+}
 static DaoFunctionEntry daoFutureMeths[] =
 {
 	{ FUTURE_Value,   "value( self: Future<@V> )=>@V" },
 	{ FUTURE_Wait,    "wait( self: Future<@V>, timeout: float = -1 ) => bool" },
+	{ FUTURE_Then,    "then( self: Future<@V> ) [value: @V => @T|none] => Future<@T>" },
 	{ NULL, NULL }
 };
 
@@ -1440,6 +2828,7 @@ static void DaoFuture_HandleGC( DaoValue *p, DList *values, DList *lists, DList
 	if( self->selected ) DList_Append( values, self->selected );
 	if( self->process ) DList_Append( values, self->process );
 	if( self->precond ) DList_Append( values, self->precond );
+	if( self->preconds ) DList_Append( values, self->preconds );
 	if( remove ){
 		self->value = NULL;
 		self->actor = NULL;
@@ -1447,6 +2836,7 @@ static void DaoFuture_HandleGC( DaoValue *p, DList *values, DList *lists, DList
 		self->selected = NULL;
 		self->process = NULL;
 		self->precond = NULL;
+		self->preconds = NULL;
 	}
 }
 
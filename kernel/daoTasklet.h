@@ -40,6 +40,32 @@ enum DaoTaskletStatus
 	DAO_TASKLET_ABORTED
 };
 
+enum DaoFutureContinuation
+{
+	DAO_FUTURE_NONE ,
+	DAO_FUTURE_THEN ,  /* Future::then(); */
+	DAO_FUTURE_ALL  ,  /* mt::all(); */
+	DAO_FUTURE_ANY     /* mt::any(); */
+};
+
+
+/*
+// FIFO queue of the tasklet events waiting on a channel or a future value.
+//
+// The events are linked through their own fields, so that an event can be
+// removed from its queue in constant time, when it is resumed by a timeout
+// instead of the channel or the future value.
+*/
+typedef struct DaoTaskletEvent  DaoTaskletEvent;
+typedef struct DaoTaskletQueue  DaoTaskletQueue;
+
+struct DaoTaskletQueue
+{
+	DaoTaskletEvent  *head;
+	DaoTaskletEvent  *tail;
+};
+
+
 
 /*
 // Channel for synchronous and asynchronous communication between tasklet.
@@ -55,13 +81,34 @@ enum DaoTaskletStatus
 //
 // If the buffer cap is zero, it will effectively block any sender,
 // which is unblock only when the data item it sent has been read out.
+//
+// The buffer is a ring buffer protected by the channel's own mutex,
+// so sending and receiving do not need to lock the tasklet server,
+// unless there are tasklets waiting on the channel to be resumed.
+//
+// The tasklets blocked on the channel are queued in the "receiving" and
+// "sending" queues in the order they started waiting, and are resumed from
+// the queue heads. The counters "receivers" and "senders" are protected by
+// the channel mutex, and are checked by the fast paths, while the queues and
+// the selectors map are protected by the mutex of the tasklet server.
 */
 struct DaoChannel
 {
 	DAO_CSTRUCT_COMMON;
 
-	daoint   cap;     /* capacity limit of the channel; */
-	DList   *buffer;  /* DList<DaoValue*>; */
+	daoint      cap;        /* capacity limit of the channel; */
+	daoint      head;       /* index of the first data item in the buffer; */
+	daoint      size;       /* number of data items in the buffer; */
+	daoint      bufsize;    /* allocated size of the buffer; */
+	DaoValue  **buffer;     /* ring buffer of data items; */
+	int         receivers;  /* number of tasklets waiting to receive; */
+	int         senders;    /* number of tasklets waiting after sending; */
+	DMap       *selectors;  /* select events waiting on the channel; */
+
+	DaoTaskletQueue  receiving;  /* events of the tasklets waiting to receive; */
+	DaoTaskletQueue  sending;    /* events of the tasklets waiting after sending; */
+
+	DMutex      mutex;
 };
 
 
@@ -70,6 +117,15 @@ struct DaoChannel
 // Future value for tasklet.
 //
 // Each tasklet is represented by a future value.
+//
+// A future value can also be a continuation of other future values,
+// created by Future::then(), mt::all() or mt::any(). A continuation is
+// registered in the "nexts" list of each of its preconditions, and is
+// resolved directly when the preconditions are done, without scheduling
+// waiting events.
+//
+// The tasklets blocked on a future value are queued in its "waiters" queue,
+// which is protected by the mutex of the tasklet server.
 */
 struct DaoFuture
 {
@@ -79,17 +135,61 @@ struct DaoFuture
 	uchar_t      timeout;
 	uchar_t      aux1;
 	uchar_t      aux2;
+	uchar_t      continuation; /* DAO_FUTURE_THEN/ALL/ANY for continuations; */
+	daoint       count;    /* number of unresolved preconditions for mt::all/any(); */
 	DaoValue    *value;
 	DaoValue    *message;
 	DaoValue    *selected;
 	DaoObject   *actor;
 	DaoProcess  *process;
-	DaoFuture   *precond; /* the future value on which this one waits; */
+	DaoFuture   *precond;  /* the future value on which this one waits; */
+	DaoList     *preconds; /* the future values of mt::all(); */
+	DList       *nexts;    /* continuations to be resolved when this one is done; */
+	DMap        *selectors; /* select events waiting on this future value; */
+	DaoTaskletQueue  waiters; /* events of the tasklets waiting on this one; */
+	void        *runner;   /* the tasklet thread that last ran this tasklet; */
+	double       runtime;  /* total running time of the tasklet in seconds; */
+	double       waittime; /* total time of the tasklet waiting to be resumed; */
 };
 
 DAO_DLL DaoFuture*  DaoFuture_New( DaoVmSpace *vms, DaoType *type, int vatype );
 
 
+
+/*
+// Statistics of the tasklet server.
+//
+// The histograms count the time slices that tasklets have run, and the
+// times that tasklets have waited before being resumed (including the
+// time blocked on futures, channels or streams), in decimal buckets:
+// [0,10us), [10us,100us), [100us,1ms), ..., [1s,10s), [10s,inf).
+*/
+#define DAO_TASKLET_HISTOGRAM  8
+
+typedef struct DaoTaskletStats  DaoTaskletStats;
+
+struct DaoTaskletStats
+{
+	int     threads;    /* number of tasklet threads; */
+	int     idle;       /* number of idle threads; */
+	int     vacant;     /* number of threads not owned by tasklets; */
+	daoint  jobs;       /* number of queued thread jobs; */
+	daoint  ready;      /* number of events ready to be handled; */
+	daoint  waiting;    /* number of events waiting on futures or channels; */
+	daoint  timed;      /* number of events with timeout; */
+	daoint  polling;    /* number of events waiting on streams; */
+	daoint  selecting;  /* number of unresolved select events; */
+	daoint  mailed;     /* number of calls queued in the mailboxes of actors; */
+	daoint  runs;       /* number of time slices that tasklets have run; */
+	daoint  finished;   /* number of finished tasklets; */
+	daoint  aborted;    /* number of aborted tasklets; */
+	double  runtime;    /* total running time of the tasklets; */
+	double  waittime;   /* total waiting time of the tasklets; */
+	daoint  runhist[DAO_TASKLET_HISTOGRAM];   /* histogram of the running time; */
+	daoint  waithist[DAO_TASKLET_HISTOGRAM];  /* histogram of the waiting time; */
+};
+
+
 DAO_DLL void DaoVmSpace_AddTaskletCall( DaoVmSpace *self, DaoProcess *call );
 
 #ifdef DAO_WITH_CONCURRENT
@@ -102,7 +202,21 @@ DAO_DLL void DaoProcess_MarkActiveTasklet( DaoProcess *self, int active );
 
 DAO_DLL void DaoProcess_ReturnFutureValue( DaoProcess *self, DaoFuture *future );
 
+/* Count a time slice of the tasklet in the statistics of the tasklet server: */
+DAO_DLL void DaoProcess_CountTaskletRun( DaoProcess *self, double span );
+
 DAO_DLL int  DaoVmSpace_GetThreadCount( DaoVmSpace *self );
+
+/*
+// Get the statistics of the tasklet server (all zeros if there is none);
+// Print the statistics and the blocked tasklets to the stream;
+// Request printing them to the error stream of the vmspace by a tasklet
+// thread, this function only sets a flag, so it can be called in signal
+// handlers;
+*/
+DAO_DLL void DaoVmSpace_GetTaskletStats( DaoVmSpace *self, DaoTaskletStats *stats );
+DAO_DLL void DaoVmSpace_PrintTasklets( DaoVmSpace *self, DaoStream *stream );
+DAO_DLL void DaoVmSpace_RequestTaskletLog( DaoVmSpace *self );
 DAO_DLL void DaoVmSpace_JoinTasklets( DaoVmSpace *self );
 DAO_DLL void DaoVmSpace_StopTasklets( DaoVmSpace *self );
 
@@ -118,6 +232,15 @@ DAO_DLL void DaoVmSpace_AddTaskletThread( DaoVmSpace *self, DThreadTask func, vo
 DAO_DLL void DaoVmSpace_AddTaskletJob( DaoVmSpace *self, DThreadTask func, void *param, void *proc );
 DAO_DLL void DaoVmSpace_AddTaskletWait( DaoVmSpace *self, DaoProcess *wait, DaoFuture *future, double timeout );
 
+/*
+// Suspend the tasklet "wait" until the file descriptor "fd" becomes
+// readable (mode = DAO_STREAM_READABLE) or writable (DAO_STREAM_WRITABLE).
+// The current call of "wait" will be made again after it is resumed.
+// Return zero if the tasklet cannot be suspended for the descriptor,
+// in which case the caller should block as usual.
+*/
+DAO_DLL int DaoVmSpace_AddTaskletPoll( DaoVmSpace *self, DaoProcess *wait, int fd, int mode );
+
 #endif
 
 #endif
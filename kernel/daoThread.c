@@ -26,7 +26,14 @@
 // OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#ifdef LINUX
+#define _GNU_SOURCE  /* For pthread_attr_setaffinity_np(); */
+#endif
+
 #include<string.h>
+#include<stdlib.h>
+#include<ctype.h>
+#include<limits.h>
 #include<math.h>
 
 #include"daoThread.h"
@@ -56,6 +63,59 @@ struct DThreadData
 };
 
 
+/*
+// CPUs on which the threads started by DThread_StartPlaced() are placed,
+// in round-robin order. The threads are not placed if it is empty.
+*/
+#define DAO_MAX_PLACEMENT  256
+
+static DMutex placementMutex;
+static int    placementCPUs[DAO_MAX_PLACEMENT];
+static int    placementCount = 0;
+static int    placementNext = 0;
+
+int DThread_SetPlacement( const char *cpus )
+{
+	int list[DAO_MAX_PLACEMENT];
+	char *end = NULL;
+	int count = 0;
+	long i, first, last;
+
+	while( *cpus ){
+		while( isspace( (unsigned char) *cpus ) || *cpus == ',' ) cpus += 1;
+		if( *cpus == '\0' ) break;
+		if( ! isdigit( (unsigned char) *cpus ) ) return -1;
+		first = last = strtol( cpus, & end, 10 );
+		cpus = end;
+		if( *cpus == '-' ){
+			if( ! isdigit( (unsigned char) cpus[1] ) ) return -1;
+			last = strtol( cpus + 1, & end, 10 );
+			cpus = end;
+		}
+		if( last < first || last > INT_MAX ) return -1;
+		for(i=first; i<=last && count<DAO_MAX_PLACEMENT; ++i) list[count++] = i;
+	}
+	memcpy( placementCPUs, list, count*sizeof(int) );
+	placementCount = count;
+	placementNext = 0;
+	return count;
+}
+int DThread_GetPlacement()
+{
+	return placementCount;
+}
+static int DThread_NextPlacement()
+{
+	int cpu;
+	if( placementCount == 0 ) return -1;
+	DMutex_Lock( & placementMutex );
+	cpu = placementCPUs[ placementNext % placementCount ];
+	placementNext += 1;
+	DMutex_Unlock( & placementMutex );
+	return cpu;
+}
+
+
 #ifdef UNIX
 
 void DMutex_Init( DMutex *self )
@@ -142,7 +202,10 @@ void DThread_Destroy( DThread *self )
 {
 	DMutex_Destroy( & self->mutex );
 	DCondVar_Destroy( & self->condv );
-	pthread_setspecific( thdSpecKey, NULL );
+	/* The data of other threads are freed by the key destructor on exiting: */
+	if( self->thdSpecData && self->thdSpecData == pthread_getspecific( thdSpecKey ) ){
+		pthread_setspecific( thdSpecKey, NULL );
+	}
 }
 
 static DThreadData* DThreadData_New()
@@ -183,6 +246,35 @@ int DThread_Start( DThread *self, DThreadTask task, void *arg )
 	return pthread_create( & self->myThread, NULL, & DThread_Wrapper, (void*)self ) == 0;
 }
 
+int DThread_StartPlaced( DThread *self, DThreadTask task, void *arg )
+{
+	pthread_attr_t attr;
+	int cpu = DThread_NextPlacement();
+	int ret;
+
+	if( cpu < 0 ) return DThread_Start( self, task, arg );
+	self->taskFunc = task;
+	self->taskArg = arg;
+	pthread_attr_init( & attr );
+#ifdef LINUX
+	{
+		cpu_set_t *cpuset = CPU_ALLOC( cpu + 1 );
+		size_t size = CPU_ALLOC_SIZE( cpu + 1 );
+		if( cpuset != NULL ){
+			CPU_ZERO_S( size, cpuset );
+			CPU_SET_S( cpu, size, cpuset );
+			pthread_attr_setaffinity_np( & attr, size, cpuset );
+			CPU_FREE( cpuset );
+		}
+	}
+#endif
+	ret = pthread_create( & self->myThread, & attr, & DThread_Wrapper, (void*)self );
+	pthread_attr_destroy( & attr );
+	if( ret == 0 ) return 1;
+	/* The CPU may not be available to this process, start without placement: */
+	return DThread_Start( self, task, arg );
+}
+
 void DThread_Join( DThread *self )
 {
 	pthread_join( self->myThread, NULL );
@@ -377,6 +469,16 @@ int DThread_Start( DThread *self, DThreadTask task, void *arg )
 	return (self->myThread != 0);
 }
 
+int DThread_StartPlaced( DThread *self, DThreadTask task, void *arg )
+{
+	int cpu = DThread_NextPlacement();
+	if( DThread_Start( self, task, arg ) == 0 ) return 0;
+	if( cpu >= 0 && cpu < 8*sizeof(DWORD_PTR) ){
+		SetThreadAffinityMask( self->myThread, ((DWORD_PTR)1) << cpu );
+	}
+	return 1;
+}
+
 void DThread_Join( DThread *self )
 {
 	if( self->running ) DCondVar_Wait( & self->condv, NULL );
@@ -415,12 +517,14 @@ static void DaoThread_SysQuit()
 
 void DaoInitThread()
 {
+	DMutex_Init( & placementMutex );
 	DaoThread_SysInit();
 }
 
 void DaoQuitThread()
 {
 	DaoThread_SysQuit();
+	DMutex_Destroy( & placementMutex );
 }
 
 DThread* DThread_GetCurrent()
@@ -494,14 +598,53 @@ struct DaoTaskData
 
 	uint_t   funct; /* type of functional; */
 	uint_t   entry; /* entry code; */
-	uint_t   first; /* first index; */
-	uint_t   step; /* index step; */
+	uint_t   first; /* thread index; */
 	uint_t   status; /* execution status; */
+	daoint   size; /* number of items to process; */
+	daoint   chunk; /* number of items per chunk; */
+	daoint  *next; /* start of the next unclaimed chunk; */
 	daoint  *joined; /* number of joined threads; */
 	daoint  *index; /* smallest index found by all threads; */
-	DNode  **node; /* smallest key found by all threads; */
+	DNode  **nodes; /* map nodes in iteration order; */
+	DList  **buffers; /* per-chunk results for select, collect and reduce; */
 };
 
+/*
+// Work is handed out in chunks of contiguous items claimed from a cursor
+// shared by all the threads of the call, so that faster threads take more
+// chunks and each thread touches neighbouring items. The per-chunk result
+// buffers are merged in chunk order by the calling thread after joining.
+*/
+static daoint DaoMT_NextChunk( DaoTaskData *self, daoint *start, daoint *end )
+{
+	daoint first;
+
+	DMutex_Lock( self->mutex );
+	first = *self->next;
+	if( first < self->size ) *self->next += self->chunk;
+	DMutex_Unlock( self->mutex );
+	if( first >= self->size ) return -1;
+
+	*start = first;
+	*end = first + self->chunk < self->size ? first + self->chunk : self->size;
+	return first / self->chunk;
+}
+static void DaoMT_StopChunks( DaoTaskData *self )
+{
+	DMutex_Lock( self->mutex );
+	*self->next = self->size;
+	DMutex_Unlock( self->mutex );
+}
+static DList* DaoMT_ChunkBuffer( DaoTaskData *self, daoint chunk )
+{
+	switch( self->funct ){
+	case DVM_FUNCT_SELECT  : return self->buffers[chunk] = DList_New(0);
+	case DVM_FUNCT_COLLECT :
+	case DVM_FUNCT_FOLD    : return self->buffers[chunk] = DList_New( DAO_DATA_VALUE );
+	}
+	return NULL;
+}
+
 static void DaoMT_InitProcess( DaoProcess *proto, DaoProcess *clone, int argcount )
 {
 	DaoProcess_PushRoutine( clone, proto->activeRoutine, proto->activeObject );
@@ -522,17 +665,19 @@ static void DaoMT_RunIterateFunctional( void *p )
 	DaoTaskData *self = (DaoTaskData*)p;
 	DaoProcess *clone = self->clone;
 	DaoVmCode *sect = self->sect;
-	daoint i, n = self->param->xInteger.value;
+	daoint i, start, end;
 
 	DaoMT_InitProcess( self->proto, clone, 2 );
 	tidint.value = self->first;
-	for(i=self->first; i<n; i+=self->step){
-		idint.value = i;
-		if( sect->b >0 ) DaoProcess_SetValue( clone, sect->a, index );
-		if( sect->b >1 ) DaoProcess_SetValue( clone, sect->a+1, threadid );
-		clone->topFrame->entry = self->entry;
-		DaoProcess_Execute( clone );
-		if( clone->status != DAO_PROCESS_FINISHED ) break;
+	while( DaoMT_NextChunk( self, & start, & end ) >= 0 ){
+		for(i=start; i<end; ++i){
+			idint.value = i;
+			if( sect->b >0 ) DaoProcess_SetValue( clone, sect->a, index );
+			if( sect->b >1 ) DaoProcess_SetValue( clone, sect->a+1, threadid );
+			clone->topFrame->entry = self->entry;
+			DaoProcess_Execute( clone );
+			if( clone->status != DAO_PROCESS_FINISHED ) return;
+		}
 	}
 }
 static void DaoMT_RunListFunctional( void *p )
@@ -548,29 +693,56 @@ static void DaoMT_RunListFunctional( void *p )
 	DaoProcess *clone = self->clone;
 	DaoVmCode *sect = self->sect;
 	DaoValue **items = list->value->items.pValue;
-	daoint i, n = list->value->size;
+	DList *buffer;
+	daoint i, chunk, start, end;
 
 	DaoMT_InitProcess( self->proto, clone, 3 );
 	tidint.value = self->first;
-	for(i=self->first; i<n; i+=self->step){
-		idint.value = i;
-		if( sect->b >0 ) DaoProcess_SetValue( clone, sect->a, items[i] );
-		if( sect->b >1 ) DaoProcess_SetValue( clone, sect->a+1, index );
-		if( sect->b >2 ) DaoProcess_SetValue( clone, sect->a+2, threadid );
-		clone->topFrame->entry = self->entry;
-		DaoProcess_Execute( clone );
-		if( clone->status != DAO_PROCESS_FINISHED ) break;
-		res = clone->stackValues[0];
-		if( self->funct == DVM_FUNCT_MAP ){
-			self->status |= DaoList_SetItem( list2, res, i );
-		}else if( self->funct == DVM_FUNCT_APPLY ){
-			self->status |= DaoList_SetItem( list, res, i );
-		}else if( self->funct == DVM_FUNCT_FIND ){
-			if( *self->index >= 0 && *self->index < i ) break;
-			if( res->xInteger.value ){
-				DMutex_Lock( self->mutex );
-				if( *self->index < 0 || i < *self->index ) *self->index = i;
-				DMutex_Unlock( self->mutex );
+	while( (chunk = DaoMT_NextChunk( self, & start, & end )) >= 0 ){
+		buffer = DaoMT_ChunkBuffer( self, chunk );
+		for(i=start; i<end; ++i){
+			if( self->funct == DVM_FUNCT_FIND ){
+				if( *self->index >= 0 && *self->index < i ) return;
+			}else if( self->funct == DVM_FUNCT_FOLD && i == start ){
+				DList_Append( buffer, items[i] );
+				continue;
+			}
+			idint.value = i;
+			if( sect->b >0 ) DaoProcess_SetValue( clone, sect->a, items[i] );
+			if( self->funct == DVM_FUNCT_FOLD ){
+				if( sect->b >1 ) DaoProcess_SetValue( clone, sect->a+1, buffer->items.pValue[0] );
+			}else{
+				if( sect->b >1 ) DaoProcess_SetValue( clone, sect->a+1, index );
+			}
+			if( sect->b >2 ) DaoProcess_SetValue( clone, sect->a+2, threadid );
+			clone->topFrame->entry = self->entry;
+			DaoProcess_Execute( clone );
+			if( clone->status != DAO_PROCESS_FINISHED ) return;
+			res = clone->stackValues[0];
+			switch( self->funct ){
+			case DVM_FUNCT_MAP :
+				self->status |= DaoList_SetItem( list2, res, i );
+				break;
+			case DVM_FUNCT_APPLY :
+				self->status |= DaoList_SetItem( list, res, i );
+				break;
+			case DVM_FUNCT_SELECT :
+				if( res->xBoolean.value ) DList_Append( buffer, (void*) i );
+				break;
+			case DVM_FUNCT_COLLECT :
+				if( res->type != DAO_NONE ) DList_Append( buffer, res );
+				break;
+			case DVM_FUNCT_FOLD :
+				DList_PopBack( buffer );
+				DList_Append( buffer, res );
+				break;
+			case DVM_FUNCT_FIND :
+				if( res->xInteger.value ){
+					DMutex_Lock( self->mutex );
+					if( *self->index < 0 || i < *self->index ) *self->index = i;
+					DMutex_Unlock( self->mutex );
+					return;
+				}
 				break;
 			}
 		}
@@ -588,32 +760,43 @@ static void DaoMT_RunMapFunctional( void *p )
 	DaoVmCode *sect = self->sect;
 	DaoType *type = map->ctype;
 	DNode *node = NULL;
-	daoint i = 0;
+	DList *buffer;
+	daoint i, chunk, start, end;
 
 	DaoMT_InitProcess( self->proto, clone, 3 );
 	tidint.value = self->first;
 	type = type && type->args->size > 1 ? type->args->items.pType[1] : NULL;
-	for(node=DMap_First( map->value ); node; node=DMap_Next(map->value, node) ){
-		if( (i++) % self->step != self->first ) continue;
-		if( sect->b >0 ) DaoProcess_SetValue( clone, sect->a, node->key.pValue );
-		if( sect->b >1 ) DaoProcess_SetValue( clone, sect->a+1, node->value.pValue );
-		if( sect->b >2 ) DaoProcess_SetValue( clone, sect->a+2, threadid );
-		clone->topFrame->entry = self->entry;
-		DaoProcess_Execute( clone );
-		if( clone->status != DAO_PROCESS_FINISHED ) break;
-		res = clone->stackValues[0];
-		if( self->funct == DVM_FUNCT_MAP ){
-			self->status |= DaoList_SetItem( list2, res, i-1 );
-		}else if( self->funct == DVM_FUNCT_APPLY ){
-			self->status |= DaoValue_Move( res, & node->value.pValue, type ) == 0;
-		}else if( self->funct == DVM_FUNCT_FIND ){
-			DNode **p = self->node;
-			/* XXX: 2014-11-11 */
-			if( *p && DaoValue_Compare( (*p)->key.pValue, node->key.pValue ) < 0 ) break;
-			if( res->xInteger.value ){
-				DMutex_Lock( self->mutex );
-				if( *p == NULL || DaoValue_Compare( (*p)->key.pValue, node->key.pValue ) >0 ) *p = node;
-				DMutex_Unlock( self->mutex );
+	while( (chunk = DaoMT_NextChunk( self, & start, & end )) >= 0 ){
+		buffer = DaoMT_ChunkBuffer( self, chunk );
+		for(i=start; i<end; ++i){
+			if( self->funct == DVM_FUNCT_FIND ){
+				if( *self->index >= 0 && *self->index < i ) return;
+			}
+			node = self->nodes[i];
+			if( sect->b >0 ) DaoProcess_SetValue( clone, sect->a, node->key.pValue );
+			if( sect->b >1 ) DaoProcess_SetValue( clone, sect->a+1, node->value.pValue );
+			if( sect->b >2 ) DaoProcess_SetValue( clone, sect->a+2, threadid );
+			clone->topFrame->entry = self->entry;
+			DaoProcess_Execute( clone );
+			if( clone->status != DAO_PROCESS_FINISHED ) return;
+			res = clone->stackValues[0];
+			switch( self->funct ){
+			case DVM_FUNCT_MAP :
+				self->status |= DaoList_SetItem( list2, res, i );
+				break;
+			case DVM_FUNCT_APPLY :
+				self->status |= DaoValue_Move( res, & node->value.pValue, type ) == 0;
+				break;
+			case DVM_FUNCT_COLLECT :
+				if( res->type != DAO_NONE ) DList_Append( buffer, res );
+				break;
+			case DVM_FUNCT_FIND :
+				if( res->xInteger.value ){
+					DMutex_Lock( self->mutex );
+					if( *self->index < 0 || i < *self->index ) *self->index = i;
+					DMutex_Unlock( self->mutex );
+					return;
+				}
 				break;
 			}
 		}
@@ -639,12 +822,11 @@ static void DaoMT_RunArrayFunctional( void *p )
 	DaoArray *param = (DaoArray*) self->param;
 	DaoArray *result = (DaoArray*) self->result;
 	DaoArray *array = DaoArray_GetWorkArray( param );
-	daoint size = DaoArray_GetWorkSize( param );
 	daoint start = DaoArray_GetWorkStart( param );
 	daoint len = DaoArray_GetWorkIntervalSize( param );
 	daoint step = DaoArray_GetWorkStep( param );
 	daoint *dims = param->dims;
-	daoint i, id, id2, n = size;
+	daoint i, id, id2, first, end;
 	int j, D = array->ndim;
 	int isvec = (D == 2 && (dims[0] ==1 || dims[1] == 1));
 	int stackBase, vdim = sect->b - 1;
@@ -655,35 +837,37 @@ static void DaoMT_RunArrayFunctional( void *p )
 	stackBase = clone->topFrame->active->stackBase;
 	idval = clone->activeValues + sect->a + 1;
 	for(j=0; j<vdim; j++) idval[j]->xInteger.value = 0;
-	for(i=self->first; i<n; i+=self->step){
-		idval = clone->stackValues + stackBase + sect->a + 1;
-		id = id2 = start + (i / len) * step + (i % len);
-		if( isvec ){
-			if( vdim >0 ) idval[0]->xInteger.value = id2;
-			if( vdim >1 ) idval[1]->xInteger.value = id2;
-		}else{
-			for( j=D-1; j>=0; j--){
-				int k = id2 % dims[j];
-				id2 /= dims[j];
-				if( j < vdim ) idval[j]->xInteger.value = k;
+	while( DaoMT_NextChunk( self, & first, & end ) >= 0 ){
+		for(i=first; i<end; ++i){
+			idval = clone->stackValues + stackBase + sect->a + 1;
+			id = id2 = start + (i / len) * step + (i % len);
+			if( isvec ){
+				if( vdim >0 ) idval[0]->xInteger.value = id2;
+				if( vdim >1 ) idval[1]->xInteger.value = id2;
+			}else{
+				for( j=D-1; j>=0; j--){
+					int k = id2 % dims[j];
+					id2 /= dims[j];
+					if( j < vdim ) idval[j]->xInteger.value = k;
+				}
+			}
+			elem = clone->stackValues[ stackBase + sect->a ];
+			if( elem == NULL || elem->type != array->etype ){
+				elem = (DaoValue*)&com;
+				elem->type = array->etype;
+				elem = DaoProcess_SetValue( clone, sect->a, elem );
+			}
+			DaoArray_GetValue( array, id, elem );
+			if( sect->b > 6 ) DaoProcess_SetValue( clone, sect->a+6, threadid );
+			clone->topFrame->entry = self->entry;
+			DaoProcess_Execute( clone );
+			if( clone->status != DAO_PROCESS_FINISHED ) return;
+			res = clone->stackValues[0];
+			if( self->funct == DVM_FUNCT_MAP ){
+				DaoArray_SetValue( result, i, res );
+			}else if( self->funct == DVM_FUNCT_APPLY ){
+				DaoArray_SetValue( array, id, res );
 			}
-		}
-		elem = clone->stackValues[ stackBase + sect->a ];
-		if( elem == NULL || elem->type != array->etype ){
-			elem = (DaoValue*)&com;
-			elem->type = array->etype;
-			elem = DaoProcess_SetValue( clone, sect->a, elem );
-		}
-		DaoArray_GetValue( array, id, elem );
-		if( sect->b > 6 ) DaoProcess_SetValue( clone, sect->a+6, threadid );
-		clone->topFrame->entry = self->entry;
-		DaoProcess_Execute( clone );
-		if( clone->status != DAO_PROCESS_FINISHED ) break;
-		res = clone->stackValues[0];
-		if( self->funct == DVM_FUNCT_MAP ){
-			DaoArray_SetValue( result, i, res );
-		}else if( self->funct == DVM_FUNCT_APPLY ){
-			DaoArray_SetValue( array, id, res );
 		}
 	}
 }
@@ -700,13 +884,49 @@ static void DaoMT_RunFunctional( void *p )
 	case DAO_ARRAY : DaoMT_RunArrayFunctional( p ); break;
 #endif
 	}
-	self->status |= clone->status != DAO_PROCESS_FINISHED;
+	/* The status remains stacked if the thread has got no chunk to run: */
+	if( clone->status != DAO_PROCESS_STACKED ){
+		self->status |= clone->status != DAO_PROCESS_FINISHED;
+	}
+	if( self->status ) DaoMT_StopChunks( self );
 	DMutex_Lock( self->mutex );
 	*self->joined += 1;
 	if( clone->exceptions->size ) DaoProcess_PrintException( clone, NULL, 1 );
 	DCondVar_Signal( self->condv );
 	DMutex_Unlock( self->mutex );
 }
+/*
+// Fold the partial results of the chunks in chunk order, starting from
+// the initial value. The code section is run by the clone of the first
+// task, which still has the code section frame set up. The merging is
+// only correct if the operation of the code section is associative.
+*/
+static int DaoMT_MergeFolds( DaoTaskData *task, DaoValue *init, DList **buffers, daoint count )
+{
+	DaoInteger tidint = {DAO_INTEGER,0,0,0,0,0};
+	DaoValue *threadid = (DaoValue*)(void*)&tidint;
+	DaoProcess *clone = task->clone;
+	DaoVmCode *sect = task->sect;
+	DList *value = DList_New( DAO_DATA_VALUE );
+	daoint i;
+
+	DList_Append( value, init );
+	for(i=0; i<count; ++i){
+		if( buffers[i] == NULL || buffers[i]->size == 0 ) continue;
+		if( sect->b >0 ) DaoProcess_SetValue( clone, sect->a, buffers[i]->items.pValue[0] );
+		if( sect->b >1 ) DaoProcess_SetValue( clone, sect->a+1, value->items.pValue[0] );
+		if( sect->b >2 ) DaoProcess_SetValue( clone, sect->a+2, threadid );
+		clone->topFrame->entry = task->entry;
+		DaoProcess_Execute( clone );
+		if( clone->status != DAO_PROCESS_FINISHED ) break;
+		DList_PopBack( value );
+		DList_Append( value, clone->stackValues[0] );
+	}
+	DaoProcess_PutValue( task->proto, value->items.pValue[0] );
+	DList_Delete( value );
+	if( clone->exceptions->size ) DaoProcess_PrintException( clone, NULL, 1 );
+	return i < count;
+}
 static void DaoMT_Functional( DaoProcess *proc, DaoValue *P[], int N, int F )
 {
 	DMutex mutex;
@@ -718,9 +938,11 @@ static void DaoMT_Functional( DaoProcess *proc, DaoValue *P[], int N, int F )
 	DaoArray *array = NULL;
 	DaoVmCode *sect = NULL;
 	DaoStackFrame *frame = DaoProcess_FindSectionFrame( proc );
-	int i, entry, threads = P[1]->xInteger.value;
-	daoint index = -1, status = 0, joined = 0;
-	DNode *node = NULL;
+	DNode *it, **nodes = NULL;
+	DList **buffers = NULL;
+	daoint index = -1, status = 0, joined = 0, next = 0;
+	daoint j, size = 0, chunk, chunks;
+	int i, entry, threads = P[F == DVM_FUNCT_FOLD ? 2 : 1]->xInteger.value;
 
 	switch( F ){
 	case DVM_FUNCT_MAP :
@@ -732,6 +954,9 @@ static void DaoMT_Functional( DaoProcess *proc, DaoValue *P[], int N, int F )
 			result = (DaoValue*) list;
 		}
 		break;
+	case DVM_FUNCT_SELECT :
+	case DVM_FUNCT_COLLECT : list = DaoProcess_PutList( proc ); break;
+	case DVM_FUNCT_FOLD : DaoProcess_PutValue( proc, P[1] ); break;
 	case DVM_FUNCT_FIND : DaoProcess_PutValue( proc, dao_none_value ); break;
 	}
 	if( threads <= 0 ) threads = 2;
@@ -741,16 +966,40 @@ static void DaoMT_Functional( DaoProcess *proc, DaoValue *P[], int N, int F )
 	}
 	sect = DaoProcess_InitCodeSection( proc, 0 );
 	if( sect == NULL ) return;
+	switch( param->type ){
+	case DAO_INTEGER : size = param->xInteger.value; break;
+	case DAO_LIST : size = param->xList.value->size; break;
+	case DAO_MAP  : size = param->xMap.value->size; break;
+#ifdef DAO_WITH_NUMARRAY
+	case DAO_ARRAY : size = DaoArray_GetWorkSize( (DaoArray*) param ); break;
+#endif
+	}
 	if( list ){
 		DList_Clear( list->value );
-		if( param->type == DAO_LIST ) DList_Resize( list->value, param->xList.value->size, NULL );
-		if( param->type == DAO_MAP ) DList_Resize( list->value, param->xMap.value->size, NULL );
+		if( F == DVM_FUNCT_MAP ) DList_Resize( list->value, size, NULL );
 #ifdef DAO_WITH_NUMARRAY
 	}else if( array && F == DVM_FUNCT_MAP ){
 		DaoArray_GetSliceShape( (DaoArray*) param, & array->dims, & array->ndim );
 		DaoArray_ResizeArray( array, array->dims, array->ndim );
 #endif
 	}
+	if( size <= 0 ){
+		DaoProcess_PopFrame( proc );
+		return;
+	}
+
+	/* Several chunks per thread, to balance uneven work among threads: */
+	chunk = size / (8 * threads);
+	if( chunk < 1 ) chunk = 1;
+	chunks = (size + chunk - 1) / chunk;
+	if( F == DVM_FUNCT_SELECT || F == DVM_FUNCT_COLLECT || F == DVM_FUNCT_FOLD ){
+		buffers = (DList**) dao_calloc( chunks, sizeof(DList*) );
+	}
+	if( param->type == DAO_MAP ){
+		DMap *map = param->xMap.value;
+		nodes = (DNode**) dao_malloc( size * sizeof(DNode*) );
+		for(it=DMap_First(map),j=0; it; it=DMap_Next(map,it)) nodes[j++] = it;
+	}
 
 	DMutex_Init( & mutex );
 	DCondVar_Init( & condv );
@@ -766,9 +1015,12 @@ static void DaoMT_Functional( DaoProcess *proc, DaoValue *P[], int N, int F )
 		task->funct = F;
 		task->entry = entry;
 		task->first = i;
-		task->step = threads;
+		task->size = size;
+		task->chunk = chunk;
+		task->next = & next;
 		task->index = & index;
-		task->node = & node;
+		task->nodes = nodes;
+		task->buffers = buffers;
 		task->joined = & joined;
 		task->condv = & condv;
 		task->mutex = & mutex;
@@ -781,56 +1033,83 @@ static void DaoMT_Functional( DaoProcess *proc, DaoValue *P[], int N, int F )
 	while( joined < threads ) DCondVar_TimedWait( & condv, & mutex, 0.01 );
 	DMutex_Unlock( & mutex );
 
+	for(i=0; i<threads; i++) status |= tasks[i].status;
+	if( F == DVM_FUNCT_FOLD && status == 0 ){
+		status |= DaoMT_MergeFolds( tasks, P[1], buffers, chunks );
+	}
 	for(i=0; i<threads; i++){
-		DaoTaskData *task = tasks + i;
-		DaoVmSpace_ReleaseProcess( proc->vmSpace, task->clone );
-		status |= task->status;
+		DaoVmSpace_ReleaseProcess( proc->vmSpace, tasks[i].clone );
 	}
-	if( F == DVM_FUNCT_FIND ){
+	if( F == DVM_FUNCT_FIND && index != -1 ){
 		DaoTuple *tuple = DaoProcess_PutTuple( proc, 2 );
-		if( param->type == DAO_LIST && index != -1 ){
+		if( param->type == DAO_LIST ){
 			DaoValue **items = param->xList.value->items.pValue;
 			GC_Assign( & tuple->values[1], items[index] );
 			tuple->values[0]->xInteger.value = index;
-		}else if( param->type == DAO_MAP && node ){
-			GC_Assign( & tuple->values[0], node->key.pValue );
-			GC_Assign( & tuple->values[1], node->value.pValue );
+		}else if( param->type == DAO_MAP ){
+			GC_Assign( & tuple->values[0], nodes[index]->key.pValue );
+			GC_Assign( & tuple->values[1], nodes[index]->value.pValue );
+		}
+	}
+	if( F == DVM_FUNCT_SELECT || F == DVM_FUNCT_COLLECT ){
+		DaoValue **items = param->type == DAO_LIST ? param->xList.value->items.pValue : NULL;
+		for(j=0; j<chunks && status == 0; ++j){
+			DList *buffer = buffers[j];
+			daoint k;
+			if( buffer == NULL ) continue;
+			for(k=0; k<buffer->size; ++k){
+				if( F == DVM_FUNCT_SELECT ){
+					status |= DaoList_Append( list, items[ buffer->items.pInt[k] ] );
+				}else{
+					status |= DaoList_Append( list, buffer->items.pValue[k] );
+				}
+			}
 		}
 	}
+	if( buffers ){
+		for(j=0; j<chunks; ++j) if( buffers[j] ) DList_Delete( buffers[j] );
+		dao_free( buffers );
+	}
 	if( status ) DaoProcess_RaiseError( proc, NULL, "code section execution failed!" );
 	DMutex_Destroy( & mutex );
 	DCondVar_Destroy( & condv );
+	if( nodes ) dao_free( nodes );
 	dao_free( tasks );
 }
 static void DaoMT_Start0( void *p )
 {
 	DaoProcess *proc = (DaoProcess*)p;
 	int count = proc->exceptions->size;
+	double start = Dao_GetCurrentTime();
 	DaoProcess_Start( proc );
+	DaoProcess_CountTaskletRun( proc, Dao_GetCurrentTime() - start );
 	DaoProcess_ReturnFutureValue( proc, proc->future );
 	if( proc->exceptions->size > count ) DaoProcess_PrintException( proc, NULL, 1 );
-	if( proc->future->state == DAO_TASKLET_FINISHED ){
+	if( proc->future->state == DAO_TASKLET_ABORTED ){
+		DaoFuture_ActivateEvent( proc->future, proc->vmSpace );
+	}else if( proc->future->state == DAO_TASKLET_FINISHED ){
 		DaoFuture_ActivateEvent( proc->future, proc->vmSpace );
 		DaoVmSpace_ReleaseProcess( proc->vmSpace, proc );
 	}
 }
-static void DaoMT_Start( DaoProcess *proc, DaoValue *p[], int n )
+/*
+// Clone the process to run the code section of the current call as a tasklet
+// for "future". The tasklet is not scheduled. Return NULL on error.
+*/
+DaoProcess* DaoMT_CloneSection( DaoProcess *proc, DaoFuture *future, int argcount )
 {
 	DaoProcess *clone;
 	DaoVmCode *vmc, *end, *sect;
-	DaoType *type = DaoProcess_GetReturnType( proc );
-	DaoFuture *future = DaoFuture_New( proc->vmSpace, type, 0 );
 	int entry, nop = proc->activeCode[1].code == DVM_NOP;
 
-	DaoProcess_PutValue( proc, (DaoValue*) future );
-	sect = DaoProcess_InitCodeSection( proc, 0 );
-	if( sect == NULL ) return;
+	sect = DaoProcess_InitCodeSection( proc, argcount );
+	if( sect == NULL ) return NULL;
 
 	entry = proc->topFrame->entry;
 	end = proc->activeRoutine->body->vmCodes->data.codes + proc->activeCode[nop+1].b;
 	clone = DaoVmSpace_AcquireProcess( proc->vmSpace );
 	DaoProcess_PopFrame( proc );
-	DaoMT_InitProcess( proc, clone, 0 );
+	DaoMT_InitProcess( proc, clone, argcount );
 	clone->topFrame->entry = entry;
 	/*
 	// Use the cloned process instead of the parent process, in case that
@@ -840,7 +1119,6 @@ static void DaoMT_Start( DaoProcess *proc, DaoValue *p[], int n )
 	future->process = clone;
 	GC_IncRC( clone );
 	GC_Assign( & clone->future, future );
-	future->state = DAO_TASKLET_RUNNING;
 
 	for(vmc=sect; vmc!=end; vmc++){
 		int i = -1, code = vmc->code;
@@ -851,6 +1129,19 @@ static void DaoMT_Start( DaoProcess *proc, DaoValue *p[], int n )
 		}
 		if( i >= 0 ) DaoValue_Move( proc->activeValues[i], & clone->activeValues[i], NULL );
 	}
+	return clone;
+}
+static void DaoMT_Start( DaoProcess *proc, DaoValue *p[], int n )
+{
+	DaoProcess *clone;
+	DaoType *type = DaoProcess_GetReturnType( proc );
+	DaoFuture *future = DaoFuture_New( proc->vmSpace, type, 0 );
+
+	DaoProcess_PutValue( proc, (DaoValue*) future );
+	clone = DaoMT_CloneSection( proc, future, 0 );
+	if( clone == NULL ) return;
+
+	future->state = DAO_TASKLET_RUNNING;
 	DaoVmSpace_AddTaskletJob( proc->vmSpace, DaoMT_Start0, clone, p[0]->xEnum.value ? clone : NULL );
 }
 static void DaoMT_Iterate( DaoProcess *proc, DaoValue *p[], int n )
@@ -873,6 +1164,18 @@ static void DaoMT_ListFind( DaoProcess *proc, DaoValue *p[], int n )
 {
 	DaoMT_Functional( proc, p, n, DVM_FUNCT_FIND );
 }
+static void DaoMT_ListSelect( DaoProcess *proc, DaoValue *p[], int n )
+{
+	DaoMT_Functional( proc, p, n, DVM_FUNCT_SELECT );
+}
+static void DaoMT_ListCollect( DaoProcess *proc, DaoValue *p[], int n )
+{
+	DaoMT_Functional( proc, p, n, DVM_FUNCT_COLLECT );
+}
+static void DaoMT_ListReduce( DaoProcess *proc, DaoValue *p[], int n )
+{
+	DaoMT_Functional( proc, p, n, DVM_FUNCT_FOLD );
+}
 static void DaoMT_MapIterate( DaoProcess *proc, DaoValue *p[], int n )
 {
 	DaoMT_Functional( proc, p, n, DVM_FUNCT_ITERATE );
@@ -889,6 +1192,10 @@ static void DaoMT_MapFind( DaoProcess *proc, DaoValue *p[], int n )
 {
 	DaoMT_Functional( proc, p, n, DVM_FUNCT_FIND );
 }
+static void DaoMT_MapCollect( DaoProcess *proc, DaoValue *p[], int n )
+{
+	DaoMT_Functional( proc, p, n, DVM_FUNCT_COLLECT );
+}
 static void DaoMT_ArrayIterate( DaoProcess *proc, DaoValue *p[], int n )
 {
 	DaoMT_Functional( proc, p, n, DVM_FUNCT_ITERATE );
@@ -970,6 +1277,11 @@ static void DaoMT_Critical( DaoProcess *proc, DaoValue *p[], int n )
 }
 
 void DaoMT_Select( DaoProcess *proc, DaoValue *p[], int n );
+void DaoMT_All( DaoProcess *proc, DaoValue *p[], int n );
+void DaoMT_Any( DaoProcess *proc, DaoValue *p[], int n );
+void DaoMT_Mailbox( DaoProcess *proc, DaoValue *p[], int n );
+void DaoMT_Stats( DaoProcess *proc, DaoValue *p[], int n );
+void DaoMT_Log( DaoProcess *proc, DaoValue *p[], int n );
 
 DaoFunctionEntry dao_mt_methods[] =
 {
@@ -986,6 +1298,24 @@ DaoFunctionEntry dao_mt_methods[] =
 		"select( invar group: map<@T,int>, timeout = -1.0 )"
 			"=> tuple<selected: none|@T, value: any, status: enum<selected,timeout,finished>>"
 	},
+	{ DaoMT_All,
+		"all( invar futures: list<Future<@T>> ) => Future<list<@T>>"
+	},
+	{ DaoMT_Any,
+		"any( invar futures: list<Future<@T>> ) => Future<@T>"
+	},
+	{ DaoMT_Mailbox,
+		"mailbox( invar actor: any ) => tuple<size: int, peak: int>"
+	},
+	{ DaoMT_Stats,
+		"stats() => tuple<threads: int, idle: int, vacant: int, jobs: int, ready: int,"
+			"waiting: int, timed: int, polling: int, selecting: int, mailed: int,"
+			"runs: int, finished: int, aborted: int, runtime: float, waittime: float,"
+			"runhist: list<int>, waithist: list<int>>"
+	},
+	{ DaoMT_Log,
+		"log( stream: io::Stream|none = none )"
+	},
 
 	{ DaoMT_ListIterate,
 		"iterate( alist: list<@T>, threads = 2 ) [item: @T, index: int, threadid: int]"
@@ -1006,6 +1336,23 @@ DaoFunctionEntry dao_mt_methods[] =
 			"[invar item: @T, index: int, threadid: int => int]"
 			"=> tuple<index: int, item: @T> | none"
 	},
+	{ DaoMT_ListSelect,
+		"select( invar alist: list<@T>, threads = 2 )"
+			"[item: @T, index: int, threadid: int => bool] => list<@T>"
+	},
+	{ DaoMT_ListCollect,
+		"collect( invar alist: list<@T>, threads = 2 )"
+			"[item: @T, index: int, threadid: int => none|@V] => list<@V>"
+	},
+	{ DaoMT_ListReduce,
+		"reduce( invar alist: list<@T>, init: @T, threads = 2 )"
+			"[item: @T, value: @T, threadid: int => @T] => @T"
+		/*
+		// The items are reduced in chunks by the threads, and the partial
+		// results are then reduced in order starting from "init". So the
+		// operation of the code section must be associative.
+		*/
+	},
 
 	{ DaoMT_MapIterate,
 		"iterate( amap: map<@K,@V>, threads = 2 ) [key: @K, value: @V, threadid: int]"
@@ -1026,6 +1373,10 @@ DaoFunctionEntry dao_mt_methods[] =
 			"[invar key: @K, invar value: @V, threadid: int => int]"
 			"=> tuple<key: @K, value: @V>|none"
 	},
+	{ DaoMT_MapCollect,
+		"collect( invar amap: map<@K,@V>, threads = 2 )"
+			"[key: @K, value: @V, threadid: int => none|@T] => list<@T>"
+	},
 
 	{ DaoMT_ArrayIterate,
 		"iterate( invar aarray: array<@T>, threads = 2 )"
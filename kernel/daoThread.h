@@ -135,6 +135,23 @@ DAO_DLL void DThread_Init( DThread *self );
 DAO_DLL void DThread_Destroy( DThread *self );
 
 DAO_DLL int DThread_Start( DThread *self, DThreadTask task, void *arg );
+
+/*
+// Start a thread placed on the next CPU set by DThread_SetPlacement(),
+// or start it as DThread_Start() if no placement is set. It is used for
+// the tasklet threads and the GC thread only.
+*/
+DAO_DLL int DThread_StartPlaced( DThread *self, DThreadTask task, void *arg );
+
+/*
+// Set the CPUs on which the threads started by DThread_StartPlaced() will
+// be placed in round-robin order, as a list of CPU numbers and ranges,
+// such as "0-3,8,10-11". An empty list disables the placement.
+// Return the number of CPUs in the list, or -1 for an invalid list.
+// The placement is only effective for threads started after the call.
+*/
+DAO_DLL int DThread_SetPlacement( const char *cpus );
+DAO_DLL int DThread_GetPlacement();
 DAO_DLL void DThread_Exit( DThread *self );
 DAO_DLL void DThread_Join( DThread *self );
 
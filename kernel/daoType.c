@@ -110,6 +110,7 @@ DaoType* DaoType_Copy( DaoType *other )
 	if( other->bases ) self->bases = DList_Copy( other->bases );
 	if( other->args ) self->args = DList_Copy( other->args );
 	if( other->mapNames ) self->mapNames = DMap_Copy( other->mapNames );
+	if( other->mapSymbols ) self->mapSymbols = DMap_Copy( other->mapSymbols );
 	if( other->interfaces ) self->interfaces = DMap_Copy( other->interfaces );
 	self->aux = other->aux;
 	GC_IncRC( self->aux );
@@ -140,6 +141,7 @@ void DaoType_Delete( DaoType *self )
 	if( self->args ) DList_Delete( self->args );
 	if( self->bases ) DList_Delete( self->bases );
 	if( self->mapNames ) DMap_Delete( self->mapNames );
+	if( self->mapSymbols ) DMap_Delete( self->mapSymbols );
 	if( self->interfaces ) DMap_Delete( self->interfaces );
 	dao_free( self );
 }
@@ -275,9 +277,43 @@ void DaoType_MapNames( DaoType *self )
 	if( self->mapNames == NULL ) self->mapNames = DMap_New( DAO_DATA_STRING, 0 );
 	for(i=0; i<self->args->size; i++){
 		tp = self->args->items.pType[i];
-		if( tp->fname ) MAP_Insert( self->mapNames, tp->fname, i );
+		if( tp->fname ) DaoType_MapName( self, tp->fname, i );
 	}
 }
+/*
+// The field and parameter names of tuple and routine types are also mapped
+// by the buffers of their interned names in DaoType::mapSymbols.
+// Names copied from the interned names share these buffers,
+// and can be found without hashing and comparing their chars.
+*/
+void DaoType_MapName( DaoType *self, DString *name, int index )
+{
+	void *key[2];
+	if( self->mapNames == NULL ) self->mapNames = DMap_New( DAO_DATA_STRING, 0 );
+	if( self->vmspace == NULL ){
+		MAP_Insert( self->mapNames, name, index );
+		return;
+	}
+	if( self->mapSymbols == NULL ) self->mapSymbols = DHash_New( DAO_DATA_VOID2, 0 );
+	name = DaoVmSpace_Intern( self->vmspace, name );
+	key[0] = name->chars;
+	key[1] = IntToPointer( name->size );
+	MAP_Insert( self->mapNames, name, index );
+	MAP_Insert( self->mapSymbols, key, index );
+}
+int DaoType_FindName( DaoType *self, DString *name )
+{
+	DNode *node = NULL;
+	if( self->mapSymbols != NULL ){
+		void *key[2];
+		key[0] = name->chars;
+		key[1] = IntToPointer( name->size );
+		node = MAP_Find( self->mapSymbols, key );
+	}
+	if( node == NULL && self->mapNames != NULL ) node = MAP_Find( self->mapNames, name );
+	if( node == NULL ) return -1;
+	return node->value.pInt;
+}
 DaoType* DaoType_GetItemType( DaoType *self, int i )
 {
 	if( self->args == NULL ) return NULL;
@@ -1422,6 +1458,10 @@ DaoType* DaoType_DefineTypes( DaoType *self, DaoNamespace *ns, DMap *defs )
 		if( copy->mapNames ) DMap_Delete( copy->mapNames );
 		copy->mapNames = DMap_Copy( self->mapNames );
 	}
+	if( self->mapSymbols ){
+		if( copy->mapSymbols ) DMap_Delete( copy->mapSymbols );
+		copy->mapSymbols = DMap_Copy( self->mapSymbols );
+	}
 	if( self->fname ){
 		if( copy->fname == NULL ) copy->fname = DString_New();
 		DString_Assign( copy->fname, self->fname );
@@ -100,6 +100,7 @@ struct DaoType
 	DList    *args;   /* type arguments; */
 	DList    *bases;  /* base types; */
 	DMap     *mapNames;
+	DMap     *mapSymbols; /* field or parameter names by interned names; */
 	DMap     *interfaces;
 
 	/*
@@ -149,6 +150,9 @@ DAO_DLL void DaoType_ExportArguments( DaoType *self, DList *args, int noname );
 
 DAO_DLL DaoType* DaoType_GetVariantItem( DaoType *self, int tid );
 
+DAO_DLL void DaoType_MapName( DaoType *self, DString *name, int index );
+DAO_DLL int DaoType_FindName( DaoType *self, DString *name );
+
 DAO_DLL int DaoType_IsImmutable( DaoType *self );
 DAO_DLL int DaoType_IsPrimitiveOrImmutable( DaoType *self );
 DAO_DLL int DaoType_ChildOf( DaoType *self, DaoType *other );
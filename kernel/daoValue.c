@@ -67,11 +67,11 @@ int DaoValue_IsNumber( DaoValue *self )
 }
 static dao_integer DString_ToInteger( DString *self )
 {
-		return strtoll( self->chars, NULL, 0 );
+		return Dao_ParseInteger( self->chars );
 }
 dao_float DString_ToFloat( DString *self )
 {
-	return strtod( self->chars, 0 );
+	return Dao_ParseFloat( self->chars );
 }
 dao_integer DaoValue_GetInteger( DaoValue *self )
 {
@@ -81,6 +81,35 @@ void DaoVirtualFile_Delete( DaoVirtualFile *self )
 	dao_free( self );
 }
 
+typedef struct DaoModuleSource DaoModuleSource;
+struct DaoModuleSource
+{
+	DString   *path;
+	DString   *source;
+	DString   *cache;
+	DaoLexer  *lexer;
+	int        lines;  /* Zero if not lexed; */
+	int        ready;  /* Set when the prefetching is done; */
+};
+
+static DaoModuleSource* DaoModuleSource_New( DString *path )
+{
+	DaoModuleSource *self = (DaoModuleSource*) dao_calloc( 1, sizeof(DaoModuleSource) );
+	self->path = DString_Copy( path );
+	self->source = DString_New();
+	self->cache = DString_New();
+	self->lexer = DaoLexer_New();
+	return self;
+}
+static void DaoModuleSource_Delete( DaoModuleSource *self )
+{
+	DString_Delete( self->path );
+	DString_Delete( self->source );
+	DString_Delete( self->cache );
+	DaoLexer_Delete( self->lexer );
+	dao_free( self );
+}
+
 
 DaoConfig daoConfig =
 {
@@ -89,6 +118,8 @@ DaoConfig daoConfig =
 	1, /* optimize */
 	0, /* iscgi */
 	8, /* tabspace */
+	16, /* mailbox */
+	0,  /* tasklog */
 };
 
 DaoVmSpace *masterVmSpace = NULL;
@@ -202,7 +233,10 @@ static const char *const cmd_help =
 "   -j, --jit:            enable just-in-time compiling;\n"
 "   -Ox:                  optimization level (x=0 or 1);\n"
 "   --threads=number      minimum number of threads for processing tasklets;\n"
+"   --affinity=cpus       place tasklet and GC threads on the CPUs (e.g. 0-3,8);\n"
+"   --tasklog=seconds     print tasklet states periodically to the error stream;\n"
 "   --path=directory      add module searching path;\n"
+"   --cache=directory     cache compiled modules in the directory;\n"
 "   --module=module       preloading module;\n"
 "   --config=config       use configure file;\n"
 ;
@@ -540,6 +574,7 @@ static void DaoVmSpace_InitPath( DaoVmSpace *self )
 	int i;
 
 	DaoVmSpace_SetPath( self, self->startPath->chars );
+	DaoVmSpace_SetCacheDir( self, getenv( "DAO_CACHE_DIR" ) );
 
 	DString_AppendChars( file, DAO_DIR );
 	DString_AppendChars( path, "lib/dao/modules/" );
@@ -567,6 +602,9 @@ Done:
 
 static void DaoVmSpace_InitCoreTypes( DaoVmSpace *self );
 static void DaoVmSpace_InitStdTypes( DaoVmSpace *self );
+#ifdef DAO_WITH_THREAD
+static void DaoVmSpace_StopPrefetcher( DaoVmSpace *self );
+#endif
 
 
 DaoVmSpace* DaoVmSpace_New()
@@ -577,13 +615,16 @@ DaoVmSpace* DaoVmSpace_New()
 	self->daoBinFile = DString_New();
 	self->daoBinPath = DString_New();
 	self->startPath = DString_New();
+	self->cacheDir = DString_New();
 	self->mainSource = DString_New();
 	self->vfiles = DHash_New( DAO_DATA_STRING, 0 );
+	self->prefetches = DHash_New( DAO_DATA_STRING, 0 );
 	self->vmodules = DHash_New( DAO_DATA_STRING, 0 );
 	self->nsModules = DHash_New( DAO_DATA_STRING, 0 );
 	self->nsPlugins = DHash_New( DAO_DATA_STRING, 0 );
 	self->nsRefs = DHash_New( DAO_DATA_VALUE, 0 );
 	self->cdataWrappers = DHash_New(0,0);
+	self->symbols = DHash_New( DAO_DATA_STRING, 0 );
 	self->typeKernels = DHash_New(0,0);
 	self->spaceData = DHash_New(0,0);
 	self->pathWorking = DString_New();
@@ -607,6 +648,7 @@ DaoVmSpace* DaoVmSpace_New()
 	self->allOptimizers = DMap_New(0,0);
 	self->typeCores = DList_New(0);
 	self->taskletServer = NULL;
+	self->regexCache = DaoRegexCache_New( DAO_REGEX_CACHE );
 
 	GC_IncRC( self );
 
@@ -614,6 +656,7 @@ DaoVmSpace* DaoVmSpace_New()
 	DMutex_Init( & self->moduleMutex );
 	DMutex_Init( & self->cacheMutex );
 	DMutex_Init( & self->miscMutex );
+	DMutex_Init( & self->symbolMutex );
 #endif
 
 	DaoVmSpace_InitCoreTypes( self );
@@ -658,6 +701,7 @@ DaoVmSpace* DaoVmSpace_New()
 		DString_Assign( self->daoBinFile, master->daoBinFile );
 		DString_Assign( self->daoBinPath, master->daoBinPath );
 		DString_Assign( self->startPath, master->startPath );
+		DString_Assign( self->cacheDir, master->cacheDir );
 		DString_Assign( self->pathWorking, master->pathWorking );
 		DList_Assign( self->nameLoading, master->nameLoading );
 		DList_Assign( self->pathLoading, master->pathLoading );
@@ -694,6 +738,9 @@ static void DaoVmSpace_DeleteData( DaoVmSpace *self )
 	for(it=DMap_First(self->vfiles); it; it=DMap_Next(self->vfiles,it)){
 		DaoVirtualFile_Delete( (DaoVirtualFile*) it->value.pVoid );
 	}
+	for(it=DMap_First(self->prefetches); it; it=DMap_Next(self->prefetches,it)){
+		DaoModuleSource_Delete( (DaoModuleSource*) it->value.pVoid );
+	}
 	DaoAux_Delete( self->spaceData );
 	GC_DecRC( self->daoNamespace );
 	GC_DecRC( self->mainNamespace );
@@ -702,6 +749,7 @@ static void DaoVmSpace_DeleteData( DaoVmSpace *self )
 	DString_Delete( self->daoBinFile );
 	DString_Delete( self->daoBinPath );
 	DString_Delete( self->startPath );
+	DString_Delete( self->cacheDir );
 	DString_Delete( self->mainSource );
 	DString_Delete( self->pathWorking );
 	DList_Delete( self->nameLoading );
@@ -719,6 +767,7 @@ static void DaoVmSpace_DeleteData( DaoVmSpace *self )
 	DMap_Delete( self->typeKernels );
 	DMap_Delete( self->nsRefs );
 	DMap_Delete( self->vfiles );
+	DMap_Delete( self->prefetches );
 	DMap_Delete( self->vmodules );
 	DMap_Delete( self->allProcesses );
 	DMap_Delete( self->allRoutines );
@@ -740,10 +789,13 @@ void DaoVmSpace_Delete( DaoVmSpace *self )
 	DMap_Delete( self->nsModules );
 	DMap_Delete( self->nsPlugins );
 	DMap_Delete( self->cdataWrappers );
+	DMap_Delete( self->symbols );
+	DaoRegexCache_Delete( self->regexCache );
 #ifdef DAO_WITH_THREAD
 	DMutex_Destroy( & self->moduleMutex );
 	DMutex_Destroy( & self->cacheMutex );
 	DMutex_Destroy( & self->miscMutex );
+	DMutex_Destroy( & self->symbolMutex );
 #endif
 	dao_free( self );
 }
@@ -759,6 +811,9 @@ void DaoVmSpace_TryDelete( DaoVmSpace *self )
 #ifdef DAO_WITH_CONCURRENT
 	DaoVmSpace_StopTasklets( self );
 #endif
+#ifdef DAO_WITH_THREAD
+	DaoVmSpace_StopPrefetcher( self );
+#endif
 
 	if( (self->options & DAO_OPTION_PROFILE) && self->profiler ){
 		DaoProfiler *profiler = self->profiler;
@@ -961,8 +1016,18 @@ int DaoVmSpace_ParseOptions( DaoVmSpace *self, const char *options )
 				daoConfig.jit = 1;
 			}else if( strstr( token->chars, "--threads=" ) == token->chars ){
 				daoConfig.cpu = strtol( token->chars + 10, 0, 0 );
+			}else if( strstr( token->chars, "--affinity=" ) == token->chars ){
+				if( DaoSetAffinity( token->chars + 11 ) < 0 ){
+					DaoStream_WriteChars( self->errorStream, "Invalid CPU list: " );
+					DaoStream_WriteChars( self->errorStream, token->chars + 11 );
+					DaoStream_WriteChars( self->errorStream, "\n" );
+				}
+			}else if( strstr( token->chars, "--tasklog=" ) == token->chars ){
+				daoConfig.tasklog = strtol( token->chars + 10, 0, 0 );
 			}else if( strstr( token->chars, "--path=" ) == token->chars ){
 				DaoVmSpace_AddPath( self, token->chars + 7 );
+			}else if( strstr( token->chars, "--cache=" ) == token->chars ){
+				DaoVmSpace_SetCacheDir( self, token->chars + 8 );
 			}else if( strstr( token->chars, "--module=" ) == token->chars ){
 				if( (ns = DaoVmSpace_Load( self, token->chars + 9 )) ){
 					DaoVmSpace_AddPlugin( self, ns->name, ns );
@@ -1182,9 +1247,9 @@ static int DaoVmSpace_ConvertArguments( DaoRoutine *routine, DList *argNames, DL
 			break;
 		}
 		if( name->size ){
-			DNode *node = DMap_Find( routype->mapNames, name );
-			if( node ){
-				ito = node->value.pInt;
+			int index = DaoType_FindName( routype, name );
+			if( index >= 0 ){
+				ito = index;
 				name = NULL;
 			}
 		}
@@ -1512,6 +1577,366 @@ void DaoVmSpace_SaveByteCodes( DaoVmSpace *self, DaoByteCoder *coder, DaoNamespa
 	DString_Delete( fname );
 }
 
+/*
+// Bytecode Cache:
+// If a cache directory is set (by --cache=directory or DAO_CACHE_DIR), compiled
+// modules are cached in "<cache-directory>/<key>.dac" files, where the key is
+// computed from the bytecode format hash, the module path and its source content.
+// Each cache file starts with the content hashes of the loaded modules:
+//   <content-hash> <module-path>\n
+// followed by an empty line and the bytecodes.
+*/
+static void DaoVmSpace_HashContent( DString *content, char *buffer )
+{
+	uint_t hash1 = Dao_Hash( content->chars, content->size, 0 );
+	uint_t hash2 = DaoRotatingHash( content );
+	snprintf( buffer, 17, "%08x%08x", hash1, hash2 );
+}
+static int DaoVmSpace_GetCacheFile( DaoVmSpace *self, DString *path, DString *source, DString *file )
+{
+	DaoByteCoder *coder;
+	char key[48];
+
+	if( self->cacheDir->size == 0 ) return 0;
+	if( self->options & (DAO_OPTION_COMP_BC|DAO_OPTION_ARCHIVE) ) return 0;
+
+	coder = DaoVmSpace_AcquireByteCoder( self );
+	snprintf( key, sizeof(key), "%08x", coder->fmthash );
+	DaoVmSpace_ReleaseByteCoder( self, coder );
+	snprintf( key + 8, sizeof(key) - 8, "%08x", Dao_Hash( path->chars, path->size, 0 ) );
+	DaoVmSpace_HashContent( source, key + 16 );
+
+	DString_Assign( file, self->cacheDir );
+	DString_AppendChar( file, '/' );
+	DString_AppendChars( file, key );
+	DString_AppendChars( file, ".dac" );
+	return 1;
+}
+/*
+// Return 1 if the module is built from a valid cache file;
+// Return 0 if there is no valid cache file;
+// Return -1 if the building failed;
+*/
+static int DaoVmSpace_LoadCache( DaoVmSpace *self, DaoNamespace *ns, DString *file )
+{
+	DString *data = DString_New();
+	DString *path = DString_New();
+	DString *source = DString_New();
+	DaoByteCoder *coder;
+	daoint pos = 0, end;
+	char hash[24];
+	int res = 0;
+
+	if( DaoFile_ReadAll( Dao_OpenFile( file->chars, "rb" ), data, 1 ) == 0 ) goto Done;
+	while( pos < data->size && data->chars[pos] != '\n' ){
+		end = DString_FindChar( data, '\n', pos );
+		if( end == DAO_NULLPOS || end <= pos + 17 ) goto Done;
+		DString_SubString( data, path, pos + 17, end - pos - 17 );
+		if( DaoFile_ReadAll( Dao_OpenFile( path->chars, "r" ), source, 1 ) == 0 ) goto Done;
+		DaoVmSpace_HashContent( source, hash );
+		if( strncmp( hash, data->chars + pos, 16 ) != 0 ) goto Done;
+		pos = end + 1;
+	}
+	if( pos >= data->size ) goto Done;
+	DString_Erase( data, 0, pos + 1 );
+
+	coder = DaoVmSpace_AcquireByteCoder( self );
+	DString_Assign( coder->path, ns->name );
+	res = DaoByteCoder_Decode( coder, data );
+	if( res ) res = DaoByteCoder_Build( coder, ns ) ? 1 : -1;
+	DaoVmSpace_ReleaseByteCoder( self, coder );
+Done:
+	DString_Delete( data );
+	DString_Delete( path );
+	DString_Delete( source );
+	return res;
+}
+static void DaoVmSpace_SaveCache( DaoVmSpace *self, DaoByteCoder *coder, DaoNamespace *ns, DString *file )
+{
+	FILE *fout;
+	DList *modules = DList_New(0);
+	DMap *visited = DHash_New(0,0);
+	DString *output = DString_New();
+	DString *source = DString_New();
+	DString *temp = DString_Copy( file );
+	daoint i, j, slen = strlen( DAO_DLL_SUFFIX );
+	char buffer[64];
+
+	/* Also check the modules imported by the loaded modules: */
+	DaoByteCoder_CollectLoads( coder, modules );
+	DMap_Insert( visited, ns, NULL );
+	for(i=0; i<modules->size; ++i){
+		DaoNamespace *mod = modules->items.pNS[i];
+		DString *name = mod->name;
+		if( DMap_Find( visited, mod ) ) continue;
+		DMap_Insert( visited, mod, NULL );
+		for(j=1; j<mod->namespaces->size; ++j) DList_Append( modules, mod->namespaces->items.pNS[j] );
+		if( name->size > slen && DString_FindChars( name, DAO_DLL_SUFFIX, 0 ) == name->size - slen ){
+			continue;
+		}
+		if( DaoFile_ReadAll( Dao_OpenFile( name->chars, "r" ), source, 1 ) == 0 ) continue;
+		DaoVmSpace_HashContent( source, buffer );
+		DString_AppendChars( output, buffer );
+		DString_AppendChar( output, ' ' );
+		DString_Append( output, name );
+		DString_AppendChar( output, '\n' );
+	}
+	DString_AppendChar( output, '\n' );
+	DaoByteCoder_EncodeHeader( coder, ns->name->chars, output );
+	DaoByteCoder_EncodeToString( coder, output );
+
+	/* Write to a temporary file first, and then rename it atomically: */
+	snprintf( buffer, sizeof(buffer), ".%p.%.0f.tmp", ns, 1E6*Dao_GetCurrentTime() );
+	DString_AppendChars( temp, buffer );
+	fout = Dao_OpenFile( temp->chars, "wb" );
+	if( fout != NULL ){
+		DaoFile_WriteString( fout, output );
+		fclose( fout );
+		if( rename( temp->chars, file->chars ) != 0 ){
+			remove( file->chars ); /* Windows; */
+			if( rename( temp->chars, file->chars ) != 0 ) remove( temp->chars );
+		}
+	}
+	DList_Delete( modules );
+	DMap_Delete( visited );
+	DString_Delete( output );
+	DString_Delete( source );
+	DString_Delete( temp );
+}
+
+/*
+// Module Prefetching:
+// When a module is lexed, the Dao source modules loaded by its load statements
+// are read and lexed concurrently before parsing the module. The parsing and
+// type inference of the loaded modules still run sequentially in the order of
+// the load statements, because they register types and values in the shared
+// namespaces and may run constant folding and code sections.
+//
+// The prefetching is done by a pool of worker threads per vmspace, which is
+// started on demand with at most DAO_MAX_PREFETCHERS threads, and stopped when
+// the vmspace is deleted. The loading thread takes part in the prefetching of
+// the queued modules, and then waits for its own ones to be done.
+//
+// The prefetched sources are registered in DaoVmSpace::prefetches, which is
+// guarded by the vmspace lock, since modules may be loaded by different threads.
+*/
+#ifdef DAO_WITH_THREAD
+#define DAO_MAX_PREFETCHERS  16
+
+typedef struct DaoPrefetcher DaoPrefetcher;
+struct DaoPrefetcher
+{
+	DaoVmSpace  *vmspace;
+	DList       *queue;   /* <DaoModuleSource*>: sources to be prefetched; */
+	DThread      threads[DAO_MAX_PREFETCHERS];
+	int          count;   /* Number of started threads; */
+	int          stop;
+	DMutex       mutex;
+	DCondVar     condv;   /* Signaled when sources are queued, or to stop; */
+	DCondVar     condv2;  /* Signaled when sources are prefetched; */
+};
+
+static DaoPrefetcher* DaoPrefetcher_New( DaoVmSpace *vmspace )
+{
+	DaoPrefetcher *self = (DaoPrefetcher*) dao_calloc( 1, sizeof(DaoPrefetcher) );
+	self->vmspace = vmspace;
+	self->queue = DList_New(0);
+	DMutex_Init( & self->mutex );
+	DCondVar_Init( & self->condv );
+	DCondVar_Init( & self->condv2 );
+	return self;
+}
+static void DaoPrefetcher_Delete( DaoPrefetcher *self )
+{
+	int i;
+	DMutex_Lock( & self->mutex );
+	self->stop = 1;
+	DCondVar_BroadCast( & self->condv );
+	DMutex_Unlock( & self->mutex );
+	for(i=0; i<self->count; ++i){
+		DThread_Join( self->threads + i );
+		DThread_Destroy( self->threads + i );
+	}
+	DList_Delete( self->queue );
+	DMutex_Destroy( & self->mutex );
+	DCondVar_Destroy( & self->condv );
+	DCondVar_Destroy( & self->condv2 );
+	dao_free( self );
+}
+
+/* Prefetch the first queued source, with the mutex locked: */
+static void DaoPrefetcher_Fetch( DaoPrefetcher *self )
+{
+	DaoModuleSource *source = (DaoModuleSource*) DList_PopFront( self->queue );
+
+	DMutex_Unlock( & self->mutex );
+	if( DaoFile_ReadAll( Dao_OpenFile( source->path->chars, "r" ), source->source, 1 ) ){
+		/* No need for lexing if it will be loaded from a cache file: */
+		int cached = DaoVmSpace_GetCacheFile( self->vmspace, source->path, source->source, source->cache );
+		if( cached == 0 || Dao_IsFile( source->cache->chars ) == 0 ){
+			source->lines = DaoLexer_Tokenize( source->lexer, source->source->chars, DAO_LEX_ESCAPE );
+		}
+	}
+	DMutex_Lock( & self->mutex );
+	source->ready = 1;
+	DCondVar_BroadCast( & self->condv2 );
+}
+
+static void DaoPrefetcher_Run( void *p )
+{
+	DaoPrefetcher *self = (DaoPrefetcher*) p;
+	DMutex_Lock( & self->mutex );
+	while( self->stop == 0 ){
+		if( self->queue->size ){
+			DaoPrefetcher_Fetch( self );
+		}else{
+			DCondVar_Wait( & self->condv, & self->mutex );
+		}
+	}
+	DMutex_Unlock( & self->mutex );
+}
+
+static void DaoVmSpace_StopPrefetcher( DaoVmSpace *self )
+{
+	if( self->prefetcher == NULL ) return;
+	DaoPrefetcher_Delete( (DaoPrefetcher*) self->prefetcher );
+	self->prefetcher = NULL;
+}
+
+static void DaoVmSpace_Prefetch( DaoVmSpace *self, DList *sources )
+{
+	DaoPrefetcher *prefetcher;
+	int i, max = daoConfig.cpu > 2 ? daoConfig.cpu : 2;
+
+	if( max > DAO_MAX_PREFETCHERS ) max = DAO_MAX_PREFETCHERS;
+
+	DaoVmSpace_Lock( self );
+	if( self->prefetcher == NULL ) self->prefetcher = DaoPrefetcher_New( self );
+	prefetcher = (DaoPrefetcher*) self->prefetcher;
+	DaoVmSpace_Unlock( self );
+
+	DMutex_Lock( & prefetcher->mutex );
+	for(i=0; i<sources->size; ++i) DList_Append( prefetcher->queue, sources->items.pVoid[i] );
+	/* Start more threads if needed, the loading thread is also fetching: */
+	while( prefetcher->count < max && prefetcher->count + 1 < prefetcher->queue->size ){
+		DThread *thread = prefetcher->threads + prefetcher->count;
+		DThread_Init( thread );
+		if( DThread_Start( thread, DaoPrefetcher_Run, prefetcher ) == 0 ){
+			DThread_Destroy( thread );
+			break;
+		}
+		prefetcher->count += 1;
+	}
+	DCondVar_BroadCast( & prefetcher->condv );
+	while( prefetcher->queue->size ) DaoPrefetcher_Fetch( prefetcher );
+	for(i=0; i<sources->size; ++i){
+		DaoModuleSource *source = (DaoModuleSource*) sources->items.pVoid[i];
+		while( source->ready == 0 ) DCondVar_Wait( & prefetcher->condv2, & prefetcher->mutex );
+	}
+	DMutex_Unlock( & prefetcher->mutex );
+}
+
+static void DaoVmSpace_AddPrefetch( DaoVmSpace *self, DString *name, DList *sources )
+{
+	DString *path = DString_Copy( name );
+	if( DaoVmSpace_CompleteModuleName( self, path, 0 ) == DAO_MODULE_DAO ){
+		int found = MAP_Find( self->vfiles, path ) != NULL;
+		found |= DaoVmSpace_FindNamespace( self, path ) != NULL;
+		DaoVmSpace_Lock( self );
+		found |= MAP_Find( self->prefetches, path ) != NULL;
+		if( found == 0 ){
+			DaoModuleSource *source = DaoModuleSource_New( path );
+			MAP_Insert( self->prefetches, path, source );
+			DList_Append( sources, source );
+		}
+		DaoVmSpace_Unlock( self );
+	}
+	DString_Delete( path );
+}
+#endif
+/*
+// Scan the load statements and prefetch the modules in parallel.
+// The paths of the prefetched modules are appended to "paths".
+*/
+static void DaoVmSpace_PrefetchModules( DaoVmSpace *self, DList *tokens, DList *paths )
+{
+#ifdef DAO_WITH_THREAD
+	DList *sources = DList_New(0);
+	DString *path = DString_New();
+	DaoToken **toks = tokens->items.pToken;
+	daoint i, j, k, N = tokens->size;
+
+	for(i=0; i+1<N; ++i){
+		if( toks[i]->name != DKEY_LOAD ) continue;
+		if( i && toks[i-1]->type != DTOK_SEMCO && toks[i-1]->line == toks[i]->line ) continue;
+		j = i + 1;
+		DString_Reset( path, 0 );
+		if( toks[j]->name == DTOK_MBS || toks[j]->name == DTOK_WCS ){
+			DString_SubString( & toks[j]->string, path, 1, toks[j]->string.size-2 );
+			DaoVmSpace_AddPrefetch( self, path, sources );
+			continue;
+		}
+		while( j < N && toks[j]->type == DTOK_IDENTIFIER ){
+			DString_Append( path, & toks[j]->string );
+			j += 1;
+			if( j < N && (toks[j]->type == DTOK_COLON2 || toks[j]->type == DTOK_DOT) ){
+				DString_AppendChars( path, "/" );
+				j += 1;
+			}else break;
+		}
+		if( j < N && toks[j]->type == DTOK_LCB ){
+			for(k=j+1; k<N && toks[k]->type == DTOK_IDENTIFIER; k+=2){
+				daoint size = path->size;
+				DString_Append( path, & toks[k]->string );
+				DaoVmSpace_AddPrefetch( self, path, sources );
+				DString_Erase( path, size, -1 );
+				if( k+1 >= N || toks[k+1]->type != DTOK_COMMA ) break;
+			}
+		}else if( path->size ){
+			DaoVmSpace_AddPrefetch( self, path, sources );
+		}
+	}
+	for(i=0; i<sources->size; ++i){
+		DaoModuleSource *source = (DaoModuleSource*) sources->items.pVoid[i];
+		DList_Append( paths, source->path );
+	}
+	if( sources->size > 1 ){
+		DaoVmSpace_Prefetch( self, sources );
+	}else if( sources->size ){
+		/* Nothing to parallelize, it will be read and lexed when loaded: */
+		DaoModuleSource *source = (DaoModuleSource*) sources->items.pVoid[0];
+		DaoVmSpace_Lock( self );
+		DMap_Erase( self->prefetches, source->path );
+		DaoVmSpace_Unlock( self );
+		DaoModuleSource_Delete( source );
+		DList_PopBack( paths );
+	}
+	DList_Delete( sources );
+	DString_Delete( path );
+#endif
+}
+static DaoModuleSource* DaoVmSpace_TakePrefetch( DaoVmSpace *self, DString *path )
+{
+	DaoModuleSource *source = NULL;
+	DNode *it;
+	DaoVmSpace_Lock( self );
+	it = MAP_Find( self->prefetches, path );
+	if( it != NULL ){
+		source = (DaoModuleSource*) it->value.pVoid;
+		DMap_Erase( self->prefetches, path );
+	}
+	DaoVmSpace_Unlock( self );
+	return source;
+}
+static void DaoVmSpace_ClearPrefetch( DaoVmSpace *self, DList *paths )
+{
+	daoint i;
+	for(i=0; i<paths->size; ++i){
+		DaoModuleSource *source = DaoVmSpace_TakePrefetch( self, paths->items.pString[i] );
+		if( source ) DaoModuleSource_Delete( source );
+	}
+}
+
 /*
 // Archive File Format:
 // -- Header:
@@ -1802,6 +2227,7 @@ int DaoVmSpace_RunMain( DaoVmSpace *self, const char *file )
 		DaoVmSpace_ReleaseByteCoder( self, byteCoder );
 	}else{
 		DaoParser *parser = DaoVmSpace_AcquireParser( self );
+		DList *prefetches = DList_New( DAO_DATA_STRING );
 
 		if( self->options & DAO_OPTION_COMP_BC ){
 			parser->byteCoder = DaoVmSpace_AcquireByteCoder( self );
@@ -1810,7 +2236,9 @@ int DaoVmSpace_RunMain( DaoVmSpace *self, const char *file )
 		parser->nameSpace = ns;
 		DString_Assign( parser->fileName, ns->name );
 		res = res && DaoParser_LexCode( parser, self->mainSource->chars, 1 );
+		if( res ) DaoVmSpace_PrefetchModules( self, parser->tokens, prefetches );
 		res = res && DaoParser_ParseScript( parser );
+		DaoVmSpace_ClearPrefetch( self, prefetches );
 
 		if( res && (self->options & DAO_OPTION_COMP_BC) ){
 			DaoVmSpace_SaveByteCodes( self, parser->byteCoder, ns );
@@ -1820,6 +2248,7 @@ int DaoVmSpace_RunMain( DaoVmSpace *self, const char *file )
 		}
 		if( parser->byteCoder ) DaoVmSpace_ReleaseByteCoder( self, parser->byteCoder );
 		DaoVmSpace_ReleaseParser( self, parser );
+		DList_Delete( prefetches );
 	}
 	if( res && !(self->options & DAO_OPTION_ARCHIVE) ){
 		DString name = DString_WrapChars( "main" );
@@ -1963,7 +2392,10 @@ DaoNamespace* DaoVmSpace_LoadDaoModuleExt( DaoVmSpace *self, DString *libpath, i
 	DString *source = NULL;
 	DaoNamespace *ns = NULL;
 	DaoRoutine *mainRoutine = NULL;
+	DString *cachefile = NULL;
 	DaoParser *parser = NULL;
+	DaoModuleSource *prefetch = NULL;
+	DList *prefetches = NULL;
 	DaoProcess *process;
 	int poppath = 0;
 	size_t tm = 0;
@@ -1979,7 +2411,12 @@ DaoNamespace* DaoVmSpace_LoadDaoModuleExt( DaoVmSpace *self, DString *libpath, i
 	ns = NULL;
 
 	source = DString_New();
-	if( ! DaoVmSpace_ReadFile( self, libpath, source ) ) goto LoadingFailed;
+	prefetch = DaoVmSpace_TakePrefetch( self, libpath );
+	if( prefetch != NULL && prefetch->source->size ){
+		DString_Assign( source, prefetch->source );
+	}else if( ! DaoVmSpace_ReadFile( self, libpath, source ) ){
+		goto LoadingFailed;
+	}
 
 	if( sizeof(dao_integer) != 8 || sizeof(dao_float) != 8 ){
 		int daofile = DString_Match( libpath, "%w %. dao $", 0, 0 );
@@ -2017,12 +2454,29 @@ DaoNamespace* DaoVmSpace_LoadDaoModuleExt( DaoVmSpace *self, DString *libpath, i
 		DaoVmSpace_ReleaseByteCoder( self, byteCoder );
 		if( bl == 0 ) goto LoadingFailed;
 	}else{
+		int cached = 0;
+		cachefile = DString_New();
+		if( DaoVmSpace_GetCacheFile( self, libpath, source, cachefile ) ){
+			cached = DaoVmSpace_LoadCache( self, ns, cachefile );
+			if( cached < 0 ) goto LoadingFailed;
+		}else{
+			DString_Clear( cachefile );
+		}
+		if( cached ) goto ExecuteImplicitMain;
+
 		parser = DaoVmSpace_AcquireParser( self );
 		parser->vmSpace = self;
 		parser->nameSpace = ns;
 		DString_Assign( parser->fileName, libpath );
-		if( ! DaoParser_LexCode( parser, DString_GetData( source ), 1 ) ) goto LoadingFailed;
-		if( self->options & DAO_OPTION_COMP_BC ){
+		if( prefetch != NULL && prefetch->lines > 0 ){
+			DList_Swap( parser->tokens, prefetch->lexer->tokens );
+			parser->lineCount = prefetch->lines;
+		}else if( ! DaoParser_LexCode( parser, DString_GetData( source ), 1 ) ){
+			goto LoadingFailed;
+		}
+		prefetches = DList_New( DAO_DATA_STRING );
+		DaoVmSpace_PrefetchModules( self, parser->tokens, prefetches );
+		if( (self->options & DAO_OPTION_COMP_BC) || cachefile->size ){
 			parser->byteCoder = DaoVmSpace_AcquireByteCoder( self );
 			parser->byteBlock = DaoByteCoder_Init( parser->byteCoder );
 		}
@@ -2030,7 +2484,11 @@ DaoNamespace* DaoVmSpace_LoadDaoModuleExt( DaoVmSpace *self, DString *libpath, i
 		if( ns->mainRoutine == NULL ) goto LoadingFailed;
 		DString_SetChars( ns->mainRoutine->routName, "__main__" );
 		if( parser->byteCoder ){
-			DaoVmSpace_SaveByteCodes( self, parser->byteCoder, ns );
+			if( cachefile->size ){
+				DaoVmSpace_SaveCache( self, parser->byteCoder, ns, cachefile );
+			}else{
+				DaoVmSpace_SaveByteCodes( self, parser->byteCoder, ns );
+			}
 			DaoVmSpace_ReleaseByteCoder( self, parser->byteCoder );
 		}
 		DaoVmSpace_ReleaseParser( self, parser );
@@ -2059,7 +2517,11 @@ ExecuteImplicitMain :
 LoadingDone:
 
 	DaoVmSpace_PopLoadingNamePath( self, poppath );
+	if( prefetches ) DaoVmSpace_ClearPrefetch( self, prefetches );
+	if( prefetches ) DList_Delete( prefetches );
+	if( prefetch ) DaoModuleSource_Delete( prefetch );
 	if( source ) DString_Delete( source );
+	if( cachefile ) DString_Delete( cachefile );
 	return ns;
 
 LoadingFailed :
@@ -2068,7 +2530,11 @@ LoadingFailed :
 	DMap_Erase( self->nsModules, ns->name );
 	DMap_Erase( self->nsRefs, ns );
 	DaoVmSpace_Unlock( self );
+	if( prefetches ) DaoVmSpace_ClearPrefetch( self, prefetches );
+	if( prefetches ) DList_Delete( prefetches );
+	if( prefetch ) DaoModuleSource_Delete( prefetch );
 	if( source ) DString_Delete( source );
+	if( cachefile ) DString_Delete( cachefile );
 	if( parser ) DaoVmSpace_ReleaseParser( self, parser );
 	return NULL;
 }
@@ -2440,6 +2906,23 @@ void DaoVmSpace_AddPath( DaoVmSpace *self, const char *path )
 	   printf( "%s\n", self->pathSearching->items.pString[i]->chars );
 	 */
 }
+void DaoVmSpace_SetCacheDir( DaoVmSpace *self, const char *path )
+{
+	char *p;
+
+	DString_Clear( self->cacheDir );
+	if( path == NULL || path[0] == '\0' ) return;
+
+	DString_SetChars( self->cacheDir, path );
+	while( ( p = strchr( self->cacheDir->chars, '\\') ) !=NULL ) *p = '/';
+
+	DaoVmSpace_MakePath( self, self->cacheDir );
+
+	if( self->cacheDir->chars[self->cacheDir->size-1] == '/' ){
+		DString_Erase( self->cacheDir, self->cacheDir->size-1, 1 );
+	}
+	if( Dao_IsDir( self->cacheDir->chars ) == 0 ) DString_Clear( self->cacheDir );
+}
 void DaoVmSpace_DelPath( DaoVmSpace *self, const char *path )
 {
 	DString *pstr;
@@ -2523,6 +3006,16 @@ static void DaoConfigure_FromFile( const char *name )
 			}else if( strcmp( tk1->string.chars, "optimize" )==0 ){
 				if( yes <0 ) goto InvalidConfigValue;
 				daoConfig.optimize = yes;
+			}else if( strcmp( tk1->string.chars, "mailbox" )==0 ){
+				if( isint == 0 || integer <= 0 ) goto InvalidConfigValue;
+				daoConfig.mailbox = integer;
+			}else if( strcmp( tk1->string.chars, "tasklog" )==0 ){
+				if( isint == 0 || integer < 0 ) goto InvalidConfigValue;
+				daoConfig.tasklog = integer;
+			}else if( strcmp( tk1->string.chars, "affinity" )==0 ){
+				if( tk2->type != DTOK_MBS && tk2->type != DTOK_WCS ) goto InvalidConfigValue;
+				DString_SubString( & tk2->string, mbs, 1, tk2->string.size-2 );
+				if( DaoSetAffinity( mbs->chars ) < 0 ) goto InvalidConfigValue;
 			}else{
 				goto InvalidConfigName;
 			}
@@ -2874,6 +3367,15 @@ void DaoQuit()
 #endif
 }
 
+int DaoSetAffinity( const char *cpus )
+{
+#ifdef DAO_WITH_THREAD
+	return DThread_SetPlacement( cpus );
+#else
+	return 0;
+#endif
+}
+
 void DaoParser_Warn( DaoParser *self, int code, DString *ext );
 
 DaoNamespace* DaoVmSpace_LoadModule( DaoVmSpace *self, DString *fname, DaoParser *parser )
@@ -3059,6 +3561,20 @@ DaoType* DaoVmSpace_MakeExceptionType( DaoVmSpace *self, const char *name )
 	return type;
 }
 
+DString* DaoVmSpace_Intern( DaoVmSpace *self, DString *name )
+{
+	DNode *node;
+#ifdef DAO_WITH_THREAD
+	DMutex_Lock( & self->symbolMutex );
+#endif
+	node = DMap_Find( self->symbols, name );
+	if( node == NULL ) node = DMap_Insert( self->symbols, name, IntToPointer( self->symbols->size ) );
+#ifdef DAO_WITH_THREAD
+	DMutex_Unlock( & self->symbolMutex );
+#endif
+	return node->key.pString;
+}
+
 
 void* DaoVmSpace_SetSpaceData( DaoVmSpace *self, void *key, void *value )
 {
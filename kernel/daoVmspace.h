@@ -37,6 +37,7 @@
 #include"daoInferencer.h"
 #include"daoProcess.h"
 #include"daoBytecode.h"
+#include"daoRegex.h"
 
 enum DaoPathType
 {
@@ -109,6 +110,7 @@ struct DaoVmSpace
 	DString *daoBinFile;
 	DString *daoBinPath;
 	DString *startPath;
+	DString *cacheDir;      /* directory for cached bytecodes of modules; */
 	DString *mainSource;
 	DString *pathWorking;
 	DList   *nameLoading;
@@ -125,6 +127,7 @@ struct DaoVmSpace
 
 	DMap   *vfiles;
 	DMap   *vmodules;
+	DMap   *prefetches; /* Modules read and lexed ahead of loading; */
 
 	/* map full file name (including path and suffix) to module namespace */
 	DMap   *nsModules; /* No GC for this, namespaces should remove themselves from this; */
@@ -135,6 +138,7 @@ struct DaoVmSpace
 	DMap   *spaceData;
 
 	DMap   *cdataWrappers;  /* VM space unique wrappers for Cdata objects; */
+	DMap   *symbols;        /* Interned identifiers, mapped to their ids; */
 
 	DMap   *allProcesses;
 	DMap   *allRoutines;
@@ -190,9 +194,13 @@ struct DaoVmSpace
 	DMutex    moduleMutex;
 	DMutex    cacheMutex;
 	DMutex    miscMutex;
+	DMutex    symbolMutex;
 #endif
 
 	void  *taskletServer;
+	void  *prefetcher;  /* worker threads for prefetching modules; */
+
+	DaoRegexCache  *regexCache;  /* compiled patterns shared by the processes; */
 
 	char* (*ReadLine)( const char *prompt, DString *buffer );
 	int   (*AddHistory)( const char *cmd );
@@ -236,6 +244,7 @@ DAO_DLL int DaoVmSpace_CompleteModuleName( DaoVmSpace *self, DString *fname, int
 
 DAO_DLL void DaoVmSpace_SetPath( DaoVmSpace *self, const char *path );
 DAO_DLL void DaoVmSpace_AddPath( DaoVmSpace *self, const char *path );
+DAO_DLL void DaoVmSpace_SetCacheDir( DaoVmSpace *self, const char *path );
 DAO_DLL void DaoVmSpace_DelPath( DaoVmSpace *self, const char *path );
 
 DAO_DLL const char*const DaoVmSpace_GetCopyNotice();
@@ -247,6 +256,16 @@ DAO_DLL DaoType* DaoVmSpace_GetType( DaoVmSpace *self, DaoTypeCore *core );
 DAO_DLL DaoType* DaoVmSpace_GetCommonType( DaoVmSpace *self, int type, int subtype );
 DAO_DLL DaoType* DaoVmSpace_MakeExceptionType( DaoVmSpace *self, const char *name );
 
+/*
+// Return the unique copy of an identifier held by the vm space.
+// Strings copied or assigned from it share its buffer, so the names
+// of members, fields and parameters are stored only once. The class
+// members and the fields and parameters of tuple and routine types are
+// also indexed by these buffers (DaoClass::symbolTable, DaoType::mapSymbols),
+// so such names are looked up without hashing and comparing the chars.
+*/
+DAO_DLL DString* DaoVmSpace_Intern( DaoVmSpace *self, DString *name );
+
 DAO_DLL DaoRoutine* DaoVmSpace_AcquireRoutine( DaoVmSpace *self );
 DAO_DLL DaoParser* DaoVmSpace_AcquireParser( DaoVmSpace *self );
 DAO_DLL DaoByteCoder* DaoVmSpace_AcquireByteCoder( DaoVmSpace *self );
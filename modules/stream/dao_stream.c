@@ -47,6 +47,9 @@
 #  endif
 
 #else
+#include<unistd.h>
+#include<fcntl.h>
+#include<poll.h>
 #include<sys/wait.h>
 #endif
 
@@ -62,11 +65,11 @@ DaoType* DaoFileStream_Type( DaoVmSpace *vmspace )
 }
 DaoType* DaoStringStream_Type( DaoVmSpace *vmspace )
 {
-	return DaoVmSpace_GetType( vmspace, & daoPipeStreamCore );
+	return DaoVmSpace_GetType( vmspace, & daoStringStreamCore );
 }
 DaoType* DaoPipeStream_Type( DaoVmSpace *vmspace )
 {
-	return DaoVmSpace_GetType( vmspace, & daoStringStreamCore );
+	return DaoVmSpace_GetType( vmspace, & daoPipeStreamCore );
 }
 
 
@@ -107,6 +110,105 @@ static void DaoFileStream_Flush( DaoStream *stream )
 }
 
 
+#ifdef UNIX
+/*
+// Pipes for reading are read from non-blocking file descriptors into
+// base.buffer, so that a tasklet reading from a pipe can be suspended
+// while no data is available, instead of blocking its thread.
+*/
+static int DaoPipeStream_Fill( DaoPipeStream *self )
+{
+	char buf[4096];
+	int count;
+	do{
+		count = read( fileno( self->file ), buf, sizeof(buf) );
+	}while( count < 0 && errno == EINTR );
+	if( count > 0 ){
+		DString_AppendBytes( self->base.buffer, buf, count );
+	}else if( count == 0 || (errno != EAGAIN && errno != EWOULDBLOCK) ){
+		self->ended = 1;
+	}
+	return count;
+}
+static int DaoPipeStream_Ready( DaoPipeStream *self, int count )
+{
+	DString *buffer = self->base.buffer;
+	if( self->ended ) return 1;
+	if( count == -2 ) return 0;
+	if( count == -1 ) return DString_FindChar( buffer, '\n', 0 ) != DAO_NULLPOS;
+	return buffer->size >= count;
+}
+static int DaoPipeStream_Read( DaoStream *stream, DString *data, int count )
+{
+	DaoPipeStream *self = (DaoPipeStream*) stream;
+	DString *buffer = self->base.buffer;
+	daoint size;
+
+	DString_Reset( data, 0 );
+	while( DaoPipeStream_Ready( self, count ) == 0 ){
+		if( DaoPipeStream_Fill( self ) < 0 && self->ended == 0 ){
+			struct pollfd pfd;
+			pfd.fd = fileno( self->file );
+			pfd.events = POLLIN;
+			poll( & pfd, 1, -1 );
+		}
+	}
+	if( buffer->size == 0 ) return -1;
+
+	size = buffer->size;
+	if( count >= 0 && count < size ) size = count;
+	if( count == -1 ){
+		daoint pos = DString_FindChar( buffer, '\n', 0 );
+		if( pos != DAO_NULLPOS ) size = pos + 1;
+	}
+	DString_SubString( buffer, data, 0, size );
+	DString_Erase( buffer, 0, size );
+	return data->size;
+}
+static int DaoPipeStream_AtEnd( DaoStream *stream )
+{
+	DaoPipeStream *self = (DaoPipeStream*) stream;
+	return self->ended && self->base.buffer->size == 0;
+}
+static int DaoPipeStream_Poll( DaoStream *stream, int mode, int count )
+{
+	DaoPipeStream *self = (DaoPipeStream*) stream;
+	struct pollfd pfd;
+
+	if( self->file == NULL ) return -1;
+	if( mode == DAO_STREAM_READABLE ){
+		while( DaoPipeStream_Ready( self, count ) == 0 ){
+			if( DaoPipeStream_Fill( self ) < 0 && self->ended == 0 ) return fileno( self->file );
+		}
+		return -1;
+	}
+	/*
+	// Writing goes through the FILE buffer, a pipe having room for
+	// PIPE_BUF bytes will accept its flushing without much blocking:
+	*/
+	pfd.fd = fileno( self->file );
+	pfd.events = POLLOUT;
+	pfd.revents = 0;
+	if( poll( & pfd, 1, 0 ) == 0 ) return pfd.fd;
+	return -1;
+}
+static void DaoPipeStream_InitCallbacks( DaoPipeStream *self )
+{
+	int fd = fileno( self->file );
+	DaoFileStream_InitCallbacks( self );
+	self->base.Poll = DaoPipeStream_Poll;
+	if( self->base.mode & DAO_STREAM_READABLE ){
+		fcntl( fd, F_SETFL, fcntl( fd, F_GETFL ) | O_NONBLOCK );
+		if( self->base.buffer == NULL ) self->base.buffer = DString_New();
+		self->base.Read = DaoPipeStream_Read;
+		self->base.AtEnd = DaoPipeStream_AtEnd;
+	}
+}
+#else
+#define DaoPipeStream_InitCallbacks DaoFileStream_InitCallbacks
+#endif
+
+
 static int DaoStringStream_Read( DaoStream *stream, DString *data, int count )
 {
 	DaoStringStream *self = (DaoStringStream*) stream;
@@ -236,6 +338,11 @@ int DaoPipeStream_Close( DaoPipeStream *self )
 	self->base.AtEnd = NULL;
 	self->base.Flush = NULL;
 	self->base.SetColor = NULL;
+	self->base.Poll = NULL;
+	if( self->base.buffer ){
+		DString_Delete( self->base.buffer );
+		self->base.buffer = NULL;
+	}
 	if( self->file ){
 		fflush( self->file );
 		ret = pclose( self->file );
@@ -465,7 +572,7 @@ static void PIPE_New( DaoProcess *proc, DaoValue *p[], int N )
 	}
 	if( strstr( mode, "r" ) ) stream->base.mode |= DAO_STREAM_READABLE;
 	if( strstr( mode, "w" ) ) stream->base.mode |= DAO_STREAM_WRITABLE;
-	DaoFileStream_InitCallbacks( stream );
+	DaoPipeStream_InitCallbacks( stream );
 }
 static void PIPE_Close( DaoProcess *proc, DaoValue *p[], int N )
 {
@@ -55,6 +55,7 @@ struct DaoFileStream
 {
 	DaoStream  base;
 	FILE      *file;
+	int        ended;  /* end of a pipe read through base.buffer; */
 };
 
 
@@ -0,0 +1,81 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dao.h"
+#include "daoThread.h"
+
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
+
+/*
+// Helpers for testing the placement of the tasklet and GC threads:
+// affinity() calls DaoSetAffinity(), options() parses command line options,
+// and configure() reads a configuration file with the given content;
+// options() and configure() return the number of CPUs for the placement.
+*/
+
+static int dao_GetPlacement()
+{
+#ifdef DAO_WITH_THREAD
+	return DThread_GetPlacement();
+#else
+	return 0;
+#endif
+}
+static void dao_affinity( DaoProcess *proc, DaoValue *P[], int N )
+{
+	DaoProcess_PutInteger( proc, DaoSetAffinity( DaoValue_TryGetChars( P[0] ) ) );
+}
+static void dao_options( DaoProcess *proc, DaoValue *P[], int N )
+{
+	DaoVmSpace_ParseOptions( DaoProcess_GetVmSpace( proc ), DaoValue_TryGetChars( P[0] ) );
+	DaoProcess_PutInteger( proc, dao_GetPlacement() );
+}
+static void dao_configure( DaoProcess *proc, DaoValue *P[], int N )
+{
+	const char *config = DaoValue_TryGetChars( P[0] );
+	char options[512];
+	char path[512];
+	FILE *fout = NULL;
+#ifdef WIN32
+	char *name = _tempnam( NULL, "daoconf" );
+	if( name != NULL ){
+		snprintf( path, sizeof(path), "%s", name );
+		fout = fopen( path, "w" );
+		free( name );
+	}
+#else
+	const char *tmpdir = getenv( "TMPDIR" );
+	int fd;
+	if( tmpdir == NULL || tmpdir[0] == '\0' ) tmpdir = "/tmp";
+	snprintf( path, sizeof(path), "%s/daoconf.XXXXXX", tmpdir );
+	if( (fd = mkstemp( path )) >= 0 ) fout = fdopen( fd, "w" );
+#endif
+	if( fout == NULL ){
+		DaoProcess_RaiseError( proc, NULL, "failed to create configuration file" );
+		return;
+	}
+	fprintf( fout, "%s", config );
+	fclose( fout );
+	snprintf( options, sizeof(options), "--config=%s", path );
+	DaoVmSpace_ParseOptions( DaoProcess_GetVmSpace( proc ), options );
+	remove( path );
+	DaoProcess_PutInteger( proc, dao_GetPlacement() );
+}
+
+static DaoFunctionEntry affinityMeths[]=
+{
+	{ dao_affinity,   "affinity( cpus : string ) => int" } ,
+	{ dao_options,    "options( options : string ) => int" } ,
+	{ dao_configure,  "configure( config : string ) => int" } ,
+	{ NULL, NULL }
+};
+
+DAO_DLL int DaoOnLoad( DaoVmSpace *vmSpace, DaoNamespace *ns )
+{
+	DaoNamespace_WrapFunctions( ns, affinityMeths );
+	return 0;
+}
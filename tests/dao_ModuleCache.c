@@ -0,0 +1,149 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "dao.h"
+
+#ifdef WIN32
+#include <io.h>
+#include <direct.h>
+#include <sys/utime.h>
+#define utime _utime
+#define utimbuf _utimbuf
+#else
+#include <unistd.h>
+#include <dirent.h>
+#include <utime.h>
+#endif
+
+
+/*
+// Helpers for testing the bytecode cache of modules:
+// setup() creates a temporary directory and uses it as the cache directory;
+// The modules can be written to the same directory, and the cache files are
+// listed by files() and stamped by mtime()/touch() to tell if they are reused.
+*/
+
+static int dao_IsCacheFile( const char *name )
+{
+	size_t size = strlen( name );
+	return size > 4 && strcmp( name + size - 4, ".dac" ) == 0;
+}
+static void dao_setup( DaoProcess *proc, DaoValue *P[], int N )
+{
+	char path[512];
+#ifdef WIN32
+	char *name = _tempnam( NULL, "daocache" );
+	if( name == NULL || _mkdir( name ) != 0 ){
+		DaoProcess_RaiseError( proc, NULL, "failed to create cache directory" );
+		free( name );
+		return;
+	}
+	snprintf( path, sizeof(path), "%s", name );
+	free( name );
+#else
+	const char *tmpdir = getenv( "TMPDIR" );
+	if( tmpdir == NULL || tmpdir[0] == '\0' ) tmpdir = "/tmp";
+	snprintf( path, sizeof(path), "%s/daocache.XXXXXX", tmpdir );
+	if( mkdtemp( path ) == NULL ){
+		DaoProcess_RaiseError( proc, NULL, "failed to create cache directory" );
+		return;
+	}
+#endif
+	DaoVmSpace_SetCacheDir( DaoProcess_GetVmSpace( proc ), path );
+	DaoProcess_PutChars( proc, path );
+}
+static void dao_cleanup( DaoProcess *proc, DaoValue *P[], int N )
+{
+	const char *dir = DaoValue_TryGetChars( P[0] );
+	char path[512];
+#ifdef WIN32
+	struct _finddata_t finfo;
+	intptr_t handle;
+	snprintf( path, sizeof(path), "%s/*", dir );
+	handle = _findfirst( path, & finfo );
+	if( handle != -1 ){
+		do {
+			if( finfo.attrib & _A_SUBDIR ) continue;
+			snprintf( path, sizeof(path), "%s/%s", dir, finfo.name );
+			remove( path );
+		} while( !_findnext( handle, & finfo ) );
+		_findclose( handle );
+	}
+	_rmdir( dir );
+#else
+	struct dirent *finfo;
+	DIR *handle = opendir( dir );
+	if( handle ){
+		while( (finfo = readdir( handle )) ){
+			if( strcmp( finfo->d_name, "." ) == 0 || strcmp( finfo->d_name, ".." ) == 0 ) continue;
+			snprintf( path, sizeof(path), "%s/%s", dir, finfo->d_name );
+			remove( path );
+		}
+		closedir( handle );
+	}
+	rmdir( dir );
+#endif
+	DaoVmSpace_SetCacheDir( DaoProcess_GetVmSpace( proc ), NULL );
+}
+static void dao_files( DaoProcess *proc, DaoValue *P[], int N )
+{
+	const char *dir = DaoValue_TryGetChars( P[0] );
+	DaoList *list = DaoProcess_PutList( proc );
+#ifdef WIN32
+	struct _finddata_t finfo;
+	intptr_t handle;
+	char path[512];
+	snprintf( path, sizeof(path), "%s/*", dir );
+	handle = _findfirst( path, & finfo );
+	if( handle != -1 ){
+		do {
+			if( dao_IsCacheFile( finfo.name ) == 0 ) continue;
+			DaoList_PushBack( list, (DaoValue*) DaoProcess_NewString( proc, finfo.name, -1 ) );
+		} while( !_findnext( handle, & finfo ) );
+		_findclose( handle );
+	}
+#else
+	struct dirent *finfo;
+	DIR *handle = opendir( dir );
+	if( handle ){
+		while( (finfo = readdir( handle )) ){
+			if( dao_IsCacheFile( finfo->d_name ) == 0 ) continue;
+			DaoList_PushBack( list, (DaoValue*) DaoProcess_NewString( proc, finfo->d_name, -1 ) );
+		}
+		closedir( handle );
+	}
+#endif
+}
+static void dao_mtime( DaoProcess *proc, DaoValue *P[], int N )
+{
+	struct stat st;
+	dao_integer time = 0;
+	if( stat( DaoValue_TryGetChars( P[0] ), & st ) == 0 ) time = st.st_mtime;
+	DaoProcess_PutInteger( proc, time );
+}
+static void dao_touch( DaoProcess *proc, DaoValue *P[], int N )
+{
+	struct utimbuf times;
+	times.actime = times.modtime = DaoValue_TryGetInteger( P[1] );
+	if( utime( DaoValue_TryGetChars( P[0] ), & times ) != 0 ){
+		DaoProcess_RaiseError( proc, NULL, "failed to set file time" );
+	}
+}
+
+static DaoFunctionEntry moduleCacheMeths[]=
+{
+	{ dao_setup,    "setup() => string" } ,
+	{ dao_cleanup,  "cleanup( dir : string )" } ,
+	{ dao_files,    "files( dir : string ) => list<string>" } ,
+	{ dao_mtime,    "mtime( file : string ) => int" } ,
+	{ dao_touch,    "touch( file : string, time : int )" } ,
+	{ NULL, NULL }
+};
+
+DAO_DLL int DaoOnLoad( DaoVmSpace *vmSpace, DaoNamespace *ns )
+{
+	DaoNamespace_WrapFunctions( ns, moduleCacheMeths );
+	return 0;
+}